@@ -0,0 +1,62 @@
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "thread_pool.h"
+
+struct ParticleStore;
+
+// 扁平化八叉树节点（32字节，两个节点占一条缓存行）。
+// 节点按深度优先顺序存放：第一个子节点紧跟在父节点之后，next指向跳过整棵子树后的节点，
+// 遍历只需顺序前进或跳转，不需要栈。叶节点满足next == 自身下标 + 1。
+struct BarnesHutNode {
+    float comX, comY, comZ; // 质心
+    float mass;
+    float size;             // 单元格边长，用于张角判据
+    uint32_t next;
+    uint32_t bodyBegin;     // 覆盖的质点在Morton排序数组中的区间
+    uint32_t bodyEnd;
+};
+
+static_assert(sizeof(BarnesHutNode) == 32, "BarnesHutNode should stay 32 bytes");
+
+// Barnes-Hut自引力：每步对存活的正常粒子按Morton码排序后并行建树，
+// 再以张角theta遍历树求每个粒子受到的加速度，整体O(N log N)。
+class BarnesHutTree {
+public:
+    static const int LeafSize = 8;
+
+    // bodyMass为每个质点的质量；只有存活的正常粒子（type 0, life > 0）参与
+    void build(const ParticleStore& particles, float bodyMass, ThreadPool& pool);
+
+    // 写入每个粒子的自引力加速度，非质点粒子为0。softening为引力软化长度。
+    // skipTargets非空时，其中非零的粒子仍作为质量源，但不遍历树求自身受力，加速度为0
+    void computeAccelerations(float theta, float softening, ThreadPool& pool,
+        std::vector<float>& accelX, std::vector<float>& accelY, std::vector<float>& accelZ,
+        const uint8_t* skipTargets) const;
+
+    size_t getNodeCount() const { return nodes.size(); }
+    size_t getBodyCount() const { return bodyIndex.size(); }
+
+private:
+    void buildSubtree(size_t begin, size_t end, int level, float minX, float minY, float minZ, float size,
+        std::vector<BarnesHutNode>& out) const;
+
+    std::vector<BarnesHutNode> nodes;
+
+    // 按Morton码排序后的质点数据
+    std::vector<uint64_t> sortKeys;  // 高32位Morton码，低32位粒子下标
+    std::vector<uint64_t> sortScratch;
+    std::vector<uint32_t> mortonCodes;
+    std::vector<uint32_t> bodyIndex;
+    std::vector<float> bodyX, bodyY, bodyZ;
+    float bodyMass = 0.0f;
+    size_t particleCount = 0;
+
+    // 并行建树时每个深度2单元格的局部节点
+    std::vector<std::vector<BarnesHutNode>> subtrees;
+};
+
+#endif
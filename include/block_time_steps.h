@@ -0,0 +1,58 @@
+#ifndef BLOCK_TIME_STEPS_H
+#define BLOCK_TIME_STEPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "particle_kernels.h"
+#include "thread_pool.h"
+
+struct BlockTimeStepSettings {
+    float blackHoleMass;
+    float accuracy;     // 步长上限 = accuracy * √(r³/M)
+    int maxBin;         // 最细档位，步长为Δt / 2^maxBin
+};
+
+// 分层块时间步：一个步长Δt细分为2^maxBin个节拍，第k档粒子的步长为Δt/2^k，
+// 每2^(maxBin-k)个节拍积分一次。档位按到黑洞的局部动力学时间√(r³/M)选取，
+// 靠近视界的粒子用小步长，盘外缘的粒子一步走完。
+// 每步开始时按档位计数排序，把参与积分的粒子复制到连续的临时数组中，最细的档位排在最前：
+// 每个节拍要积分的各档恰好是数组的一段前缀，每一档也是连续区间。
+class BlockTimeStepper {
+public:
+    static const int MaxTimeBins = 6;
+
+    // 把batch中[0, count)的粒子推进constants.deltaTime，待重生与解析推进的正常粒子不参与，特效粒子固定在第0档。
+    // 湍流噪声按粒子原下标与节拍序号生成，结果与线程数和分块方式无关
+    void integrate(const IntegrationBatch& batch, size_t count, const IntegrationConstants& constants,
+        const BlockTimeStepSettings& settings, IntegrateKernel kernel, ThreadPool& pool);
+
+    // 最近一步的统计
+    size_t getBinCount(int bin) const { return binCounts[bin]; }
+    int getMaxBin() const { return maxBin; }
+    uint64_t getForceEvaluations() const { return forceEvaluations; }
+    // 所有粒子都用最细步长时需要的受力计算次数，用于对比
+    uint64_t getUniformEvaluations() const { return uniformEvaluations; }
+
+private:
+    static const uint8_t Excluded = 0xFF;
+
+    size_t binCounts[MaxTimeBins] = {};
+    size_t binBegin[MaxTimeBins] = {};
+    int maxBin = 0;
+    uint64_t forceEvaluations = 0;
+    uint64_t uniformEvaluations = 0;
+
+    std::vector<uint8_t> binOf;
+    std::vector<uint32_t> order;    // 排序后位置 -> 原粒子下标
+
+    // 按档位重排后的粒子数据
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;
+    std::vector<float> life;
+    std::vector<uint8_t> type;
+    std::vector<float> colorR, colorG, colorB;
+    std::vector<float> accelX, accelY, accelZ;
+};
+
+#endif
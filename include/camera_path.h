@@ -0,0 +1,42 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+class Camera;
+
+// 轨道相机的一个关键帧，角度单位为度
+struct CameraKeyframe {
+    float time;     // 秒，相对路径起点
+    float theta;
+    float phi;
+    float radius;
+    glm::vec3 target;
+};
+
+// 录制的相机路径：关键帧之间线性插值，超出首尾时停在端点。
+// 文件每行一个关键帧：time theta phi radius targetX targetY targetZ，#开头为注释。
+// 载入时把theta展开为连续角度，跨过0/360度的两帧沿较短方向插值
+class CameraPath {
+public:
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+
+    // 时间必须严格递增；不晚于最后一帧的关键帧不加入并返回false
+    bool addKeyframe(const CameraKeyframe& keyframe);
+    bool addKeyframe(float time, const Camera& camera);
+
+    CameraKeyframe sample(float time) const;
+    void apply(Camera& camera, float time) const;
+
+    bool empty() const { return keyframes.empty(); }
+    size_t getKeyframeCount() const { return keyframes.size(); }
+    float getDuration() const { return keyframes.empty() ? 0.0f : keyframes.back().time; }
+
+private:
+    std::vector<CameraKeyframe> keyframes;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <GL/glew.h>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class CaptureOutput {
+    PngSequence,    // 目标为目录，每帧写一个frame_000000.png
+    Pipe            // 目标为外部命令，逐帧写入原始RGB24数据（如ffmpeg -f rawvideo -pix_fmt rgb24）
+};
+
+struct CaptureSettings {
+    CaptureOutput output = CaptureOutput::PngSequence;
+    std::string target;
+    int width = 0;          // 0表示读取默认帧缓冲，否则渲染到该分辨率的离屏帧缓冲
+    int height = 0;
+    bool offline = false;   // 离线模式：写线程跟不上时等待，不丢帧
+};
+
+// 异步帧捕获。每帧用glReadPixels把画面读入环形像素缓冲（PBO）之一并插入栅栏，
+// 之后的帧只在栅栏已经完成时才映射读取，渲染线程不会等待读回；
+// 像素复制到内存池中的帧后交给写线程编码为PNG或写入编码器管道。
+// 内存池用尽时，实时模式丢弃该帧并计数，离线模式等待写线程。
+class FrameCapture {
+public:
+    static const int ReadbackSlots = 3;
+    static const int MaxQueuedFrames = 8;
+
+    FrameCapture(const CaptureSettings& settings, int windowWidth, int windowHeight);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    bool isOpen() const { return open; }
+    bool usesOffscreenTarget() const { return framebuffer != 0; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // 绑定本帧的渲染目标并设置视口，在清屏之前调用
+    void beginFrame();
+    // 场景绘制完成后调用：发出本帧的读回，取回已完成的读回；
+    // 离屏渲染时把画面缩放显示到窗口，之后默认帧缓冲与窗口视口处于绑定状态
+    void endFrame(int windowWidth, int windowHeight);
+    // 取回全部在途的读回并等待写线程写完，须在GL上下文销毁之前调用
+    void finish();
+
+    uint64_t getCapturedFrames() const { return capturedFrames; }
+    uint64_t getDroppedFrames() const { return droppedFrames; }
+    uint64_t getWrittenFrames() const;
+
+private:
+    struct PendingFrame {
+        int buffer;         // 内存池下标
+        uint64_t frame;
+    };
+
+    bool createTarget();
+    // 映射slot的PBO并把像素交给写线程；wait为false且读回尚未完成时返回false
+    bool retrieve(int slot, bool wait);
+    void writerLoop();
+    bool writeFrame(const PendingFrame& pending);
+
+    CaptureSettings settings;
+    int width;
+    int height;
+    bool open;
+
+    // 离屏渲染目标
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+
+    // 读回环
+    GLuint pixelBuffers[ReadbackSlots];
+    GLsync fences[ReadbackSlots];
+    uint64_t slotFrame[ReadbackSlots];
+    int nextSlot;
+    int pendingSlots;
+    uint64_t frameCounter;
+    uint64_t capturedFrames;
+    uint64_t droppedFrames;
+
+    // 写线程：pool中的帧按从下到上的行序存放RGBA
+    std::vector<std::vector<unsigned char>> pool;
+    std::vector<int> freeBuffers;
+    std::deque<PendingFrame> queue;
+    mutable std::mutex mutex;
+    std::condition_variable queueChanged;
+    bool stopRequested;
+    uint64_t writtenFrames;
+    bool writeFailed;
+    FILE* pipe;
+    std::vector<unsigned char> rgb;     // 只由写线程使用
+    std::thread writer;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+class Shader;
+
+// 与着色器中的layout(std140) uniform FrameUniforms逐字节对应：
+// std140下vec3按16字节对齐，其后的标量正好填入第四个分量的位置
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    float lightIntensity;
+    glm::vec3 lightColor;
+    float colorIntensity;
+    glm::vec3 lightPos;
+    int32_t directionalLight;
+    glm::vec3 lightDir;
+    float padding;
+};
+
+static_assert(sizeof(FrameUniforms) == 192, "FrameUniforms must match the std140 block layout");
+static_assert(offsetof(FrameUniforms, viewPos) == 128, "FrameUniforms must match the std140 block layout");
+static_assert(offsetof(FrameUniforms, lightDir) == 176, "FrameUniforms must match the std140 block layout");
+
+// 粒子与黑洞程序共享的每帧参数（相机矩阵与光照），每帧上传一次，
+// 绘制时不再逐个设置uniform
+class FrameUniformBuffer {
+public:
+    static const GLuint BindingPoint = 0;
+    static const char* const BlockName;
+
+    FrameUniformBuffer();
+    ~FrameUniformBuffer();
+
+    FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+    FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+
+    // 程序链接后调用一次，把它的FrameUniforms块连接到BindingPoint
+    void attach(Shader& shader) const;
+    void update(const FrameUniforms& data);
+
+private:
+    GLuint buffer;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef GPU_PARTICLE_SIMULATION_H
+#define GPU_PARTICLE_SIMULATION_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "shader.h"
+#include "particle_simulation.h"
+
+// 显存中的单个粒子状态，变换反馈按此顺序交错输出
+struct GpuParticleState {
+    glm::vec3 position;
+    glm::vec3 velocity;
+    glm::vec3 color;
+    float life;
+    float size;
+    float type;
+};
+
+static_assert(sizeof(GpuParticleState) == 48, "GpuParticleState must match the transform feedback layout");
+
+// GPU端粒子模拟（GL 3.3变换反馈）。
+// 粒子状态常驻两个乒乓缓冲，每个子步用particle_update.vs把一个缓冲积分写入另一个，
+// 渲染直接从结果缓冲读取实例属性，不经过CPU。积分器（半隐式欧拉或蛙跳）与子步数跟随参数，
+// 固定步长、分层时间步、自引力、SPH与开普勒快速路径只在CPU后端实现。
+// 支持GL 4.3时，compactLiveInstances用计算着色器前缀和把存活粒子压缩为ParticleInstance流，
+// 存活数量直接写入间接绘制命令，CPU不需要回读。同一组前缀和也给出每个空闲槽位的序号，
+// 喷流与爆炸粒子按序号只占用空闲槽位，寿命耗尽的特效粒子保持空闲，与CPU后端一致；
+// 不支持GL 4.3时不生成喷流与爆炸粒子。
+class GpuParticleSimulation {
+public:
+    GpuParticleSimulation(int maxParticles);
+    ~GpuParticleSimulation();
+
+    GpuParticleSimulation(const GpuParticleSimulation&) = delete;
+    GpuParticleSimulation& operator=(const GpuParticleSimulation&) = delete;
+
+    // 从CPU模拟的当前状态开始，切换后画面保持连续
+    void upload(const ParticleStore& particles);
+    void update(float deltaTime, const ParticleParameters& params, uint64_t seed);
+    void triggerExplosion() { pendingExplosionParticles += static_cast<int>(ParticleSimulation::ExplosionParticles); }
+
+    // 最近一次update的输出缓冲
+    GLuint getStateBuffer() const { return stateBuffers[current]; }
+    int getParticleCount() const { return maxParticles; }
+
+    bool hasCompaction() const { return compactShader != nullptr; }
+    // 压缩当前状态中的存活粒子。drawCount为间接命令的count字段：
+    // 网格绘制时为索引数，四边形绘制时为4；instanceCount由GPU填写
+    void compactLiveInstances(GLuint drawCount);
+    GLuint getCompactBuffer() const { return compactBuffer; }
+    // 压缩后绘制的存活粒子数，只用于显示：instanceCount复制到读回环，
+    // 几帧之后栅栏就绪时才取回，CPU不等待；还没有结果时返回-1
+    int getLiveCount() const { return liveCount; }
+    GLuint getDrawCommandBuffer() const { return drawCommandBuffer; }
+
+private:
+    void setupVertexArray(int index);
+    void step(float deltaTime, const ParticleParameters& params, uint64_t seed, int explosionCount, int jetCount);
+    // 压缩的前两趟：对当前状态求存活数的组内与组间前缀和，存储缓冲保持绑定
+    void scanLiveParticles();
+    void unbindStorageBuffers();
+
+    Shader updateShader;
+    int maxParticles;
+
+    // particle_update.vs的uniform句柄，构造时取得
+    struct UpdateUniforms {
+        Uniform<float> deltaTime, blackHoleMass, particleLifetime;
+        Uniform<int> leapfrog;
+        Uniform<float> spiralStrength, turbulenceStrength, accretionDiskRadius, particleSize;
+        Uniform<unsigned int> seed, stepIndex;
+        Uniform<int> jetCount;
+        Uniform<float> jetAngle, jetParticleSpeed;
+        Uniform<glm::vec3> jetDirection;
+        Uniform<int> explosionCount;
+        Uniform<float> explosionStrength;
+        Uniform<int> liveOffsets, groupLiveOffsets;
+    } updateUniforms;
+
+    GLuint stateBuffers[2];
+    GLuint updateVAOs[2];
+    int current;
+
+    // 存活粒子压缩（GL 4.3）
+    std::unique_ptr<Shader> compactShader;
+    Uniform<int> compactPassUniform;
+    Uniform<unsigned int> compactParticleCountUniform, compactGroupCountUniform;
+    GLuint compactBuffer;
+    GLuint localOffsetBuffer;
+    GLuint groupOffsetBuffer;
+    GLuint drawCommandBuffer;
+    GLuint compactGroupCount;
+    // 前缀和缓冲的纹理缓冲视图，供变换反馈顶点着色器读取
+    GLuint offsetTextures[2];
+
+    // 存活数读回环：每帧把instanceCount复制到一个槽，同一槽轮换回来且栅栏就绪时才读取
+    static const int CountReadbackSlots = 3;
+    void readBackLiveCount();
+    GLuint countReadbackBuffer;
+    GLsync countFences[CountReadbackSlots];
+    int countSlot;
+    int liveCount;
+
+    uint32_t stepIndex;
+    int pendingExplosionParticles;
+};
+
+#endif
@@ -6,17 +6,23 @@
 #include "particle_system.h"
 #include "script_parser.h"
 #include "camera.h"
+#include "profiler.h"
+#include <string>
 
 class GUI {
 public:
     GUI(GLFWwindow* window, Camera& camera);
     ~GUI() = default;
     
-    void render(ParticleSystem& particleSystem, ScriptParser& scriptParser);
+    void render(ParticleSystem& particleSystem, ScriptParser& scriptParser, Profiler& profiler);
     void cleanup();
 
+    // 最近一次从特效面板应用的特效，脚本热重载后据此重新应用
+    const std::string& getActiveEffect() const { return m_activeEffect; }
+
 private:
     Camera& m_camera;
+    std::string m_activeEffect;
 };
 
 #endif
\ No newline at end of file
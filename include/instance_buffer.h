@@ -0,0 +1,48 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// 每帧更新的实例数据缓冲。
+// 支持GL_ARB_buffer_storage时使用持久一致映射的三段环形缓冲，模拟结果直接写入映射内存，
+// 每段用glFenceSync保护，只有GPU读完该段后才会被再次写入；
+// 否则退回GL 3.3的缓冲孤立（orphaning）+ glBufferSubData。
+class InstanceRingBuffer {
+public:
+    static const int SegmentCount = 3;
+
+    InstanceRingBuffer(size_t segmentBytes, bool allowPersistent = true);
+    ~InstanceRingBuffer();
+
+    InstanceRingBuffer(const InstanceRingBuffer&) = delete;
+    InstanceRingBuffer& operator=(const InstanceRingBuffer&) = delete;
+
+    // 返回本帧可写入的内存，容量为segmentBytes
+    void* beginWrite();
+    // 提交写入的数据，返回其在缓冲对象中的字节偏移
+    size_t endWrite(size_t bytesWritten);
+    // 在使用本帧数据的绘制命令之后调用
+    void fence();
+
+    GLuint getBuffer() const { return buffer; }
+    size_t getSegmentBytes() const { return segmentBytes; }
+    bool isPersistent() const { return mappedMemory != nullptr; }
+
+private:
+    void waitForSegment(int segment);
+
+    GLuint buffer;
+    size_t segmentBytes;
+
+    // 持久映射路径
+    unsigned char* mappedMemory;
+    GLsync fences[SegmentCount];
+    int currentSegment;
+
+    // 孤立路径使用的CPU暂存区
+    std::vector<unsigned char> staging;
+};
+
+#endif
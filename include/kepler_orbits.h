@@ -0,0 +1,92 @@
+#ifndef KEPLER_ORBITS_H
+#define KEPLER_ORBITS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ParticleStore;
+
+struct KeplerSettings {
+    float blackHoleMass;
+    float captureRadius;    // 距离超过此值、轨道为椭圆且近心点在innerRadius之外的正常粒子转为解析推进
+    float innerRadius;      // 解析粒子进入此半径后交还数值积分
+    float maxEccentricity;
+};
+
+// 一段连续的轨道根数，指向外部数据（如映射的快照）或传播器内部的一个分段
+struct KeplerOrbitArrays {
+    size_t count;
+    const uint32_t* slot;
+    const float* meanAnomaly;
+    const float* eccentricAnomaly;
+    const float* cosAnomaly;
+    const float* meanMotion;
+    const float* eccentricity;
+    const float* semiMajor;
+    const float* periX;
+    const float* periY;
+    const float* periZ;
+    const float* normalX;
+    const float* normalY;
+    const float* normalZ;
+};
+
+// 远场粒子的解析开普勒推进：粒子以轨道根数存储，每步推进平近点角并解开普勒方程，
+// 闭式求出位置与速度，不再经过积分内核。等效中心质量取转入时所在半径的引力（含相对论修正），
+// 解析段忽略螺旋、湍流与粒子间相互作用。
+// 轨道根数按粒子块分段存放：粒子[b·blockSize, (b+1)·blockSize)的轨道只在第b段中，
+// 该段从各数组的b·blockSize处开始，容量等于块内粒子数，段内按粒子下标升序排列，推进后写回粒子数组时顺序访问。
+// 捕获、推进与移除都只触碰本块的数据，由模拟更新的分块并行循环逐块调用，不需要额外的串行趟或全局压缩。
+// 每步以上一步的偏近点角为起点，一次sin/cos加固定次数的牛顿修正，求解循环无分支，便于编译器向量化
+class KeplerPropagator {
+public:
+    // 捕获检查的间隔：每步只检查下标满足(i + stepIndex) % CaptureInterval == 0的粒子，
+    // 不满足条件的粒子不会每步重新计算轨道根数
+    static const uint64_t CaptureInterval = 8;
+
+    // 按粒子数与块大小分配分段；两者改变时丢弃所有轨道
+    void prepare(size_t particleCount, size_t blockSize);
+
+    // 推进begin所在块中的解析粒子deltaTime并更新寿命与颜色；
+    // 进入内半径或寿命耗尽的粒子交还数值积分，本块分段原地压缩
+    void propagate(ParticleStore& particles, size_t begin, float deltaTime, const KeplerSettings& settings);
+    // 检查块[begin, end)中本步轮到的正常粒子，满足条件的转为轨道根数，从下一步开始解析推进
+    void capture(const ParticleStore& particles, size_t begin, size_t end, const KeplerSettings& settings,
+        uint64_t stepIndex);
+
+    // 距黑洞radius以内的解析粒子交还数值积分（如受到爆炸冲击）
+    void releaseWithin(const ParticleStore& particles, float radius);
+    void releaseAll();
+
+    // 每个粒子一字节，非零表示由解析轨道推进；没有分配分段时为空
+    const uint8_t* getMask() const { return analytic.empty() ? nullptr : analytic.data(); }
+    size_t getAnalyticCount() const;
+    // begin所在块中的解析粒子数
+    size_t getBlockAnalyticCount(size_t begin) const { return counts.empty() ? 0 : counts[begin / blockSize]; }
+
+    // 保存与恢复：轨道根数与解析集合原样保存，不从当前位置重新拟合，恢复后推进逐位一致。
+    // 按分段顺序依次给出各段；assign接受各段首尾相接的数组，槽位须小于particleCount
+    size_t getSegmentCount() const { return counts.size(); }
+    KeplerOrbitArrays getSegment(size_t segment) const;
+    void assign(const KeplerOrbitArrays& source, size_t particleCount, size_t blockSize);
+
+private:
+    // 把第from项的轨道根数复制到第to项，用于分段内的原地压缩
+    void moveEntry(size_t to, size_t from);
+    // [begin, middle)与[middle, end)各自按下标升序，合并为一段升序
+    void mergeEntries(size_t begin, size_t middle, size_t end);
+
+    size_t blockSize = 0;
+    std::vector<uint8_t> analytic;
+    std::vector<uint32_t> counts;       // 每段的轨道数
+
+    std::vector<uint32_t> slot;
+    std::vector<float> meanAnomaly, meanMotion;
+    std::vector<float> eccentricAnomaly, cosAnomaly; // 上一步的解，作为下一步迭代的起点
+    std::vector<float> eccentricity, semiMajor;
+    std::vector<float> periX, periY, periZ;     // 指向近心点的单位向量P
+    std::vector<float> normalX, normalY, normalZ; // 轨道面内领先P 90度的单位向量Q
+};
+
+#endif
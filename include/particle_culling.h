@@ -0,0 +1,43 @@
+#ifndef PARTICLE_CULLING_H
+#define PARTICLE_CULLING_H
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "particle_simulation.h"
+
+// 球体网格细节层次：0最精细，LodCount-1最粗糙
+static const int ParticleLodCount = 4;
+
+struct CullingView {
+    glm::vec4 frustumPlanes[6];     // 已归一化，法线指向视锥内部
+    glm::vec3 cameraPosition;
+    float pixelsPerUnit;            // 距离为1处单位长度对应的像素数
+    float horizonRadius;            // 黑洞阴影半径，完全落在其后的粒子被剔除；为0时不做阴影剔除
+    float lodMinPixels[ParticleLodCount]; // 各级LOD要求的最小投影半径（像素）
+
+    // 从投影与视图矩阵、视口高度构造
+    static CullingView fromCamera(const glm::mat4& projection, const glm::mat4& view,
+        const glm::vec3& cameraPosition, float viewportHeight, float horizonRadius);
+};
+
+struct CullingStats {
+    size_t deadSkipped;
+    size_t frustumCulled;
+    size_t horizonCulled;
+    size_t drawn[ParticleLodCount];
+    size_t lodOffset[ParticleLodCount]; // 各LOD在输出实例数组中的起始下标
+
+    size_t totalDrawn() const;
+};
+
+// 跳过已死亡的粒子，剔除视锥外和黑洞阴影中的粒子，其余按投影大小分桶打包，
+// 同一LOD的实例在out中连续存放，桶内保持粒子原有顺序。
+// 剔除与打包都使用插值后的渲染位置。
+// lodScratch为每个粒子的分类结果，调用方持有以复用内存。返回写入的实例数
+size_t cullAndPackInstances(const ParticleStore& particles, const RenderInterpolation& interpolation,
+    const CullingView& view,
+    std::vector<uint8_t>& lodScratch, ParticleInstance* out, CullingStats& stats);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef PARTICLE_KERNELS_H
+#define PARTICLE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 积分内核直接读写ParticleStore中的SoA数组
+struct IntegrationBatch {
+    float* posX;
+    float* posY;
+    float* posZ;
+    float* velX;
+    float* velY;
+    float* velZ;
+    float* life;
+    const uint8_t* type;
+    float* colorR;
+    float* colorG;
+    float* colorB;
+
+    // 可选的外部加速度（如自引力），为nullptr时不参与；只作用于正常粒子
+    const float* accelX;
+    const float* accelY;
+    const float* accelZ;
+
+    // 可选的湍流噪声下标：粒子被重排到临时数组中积分时指向其原下标，
+    // 保证随机数与存储位置无关；为nullptr时使用数组下标
+    const uint32_t* noiseIndex;
+
+    // 可选的解析推进掩码：非零的粒子由开普勒轨道推进，内核跳过；为nullptr时全部积分
+    const uint8_t* analytic;
+};
+
+struct IntegrationConstants {
+    float blackHoleMass;
+    float spiralStrength;
+    float turbulenceStrength;
+    float deltaTime;
+
+    // 0为半隐式欧拉（先更新速度再用新速度推进位置）；
+    // 1为漂移-踢-漂移（DKD）蛙跳：力在半步位置处求值，辛积分，每步仍只求一次力
+    uint32_t leapfrog;
+
+    // 湍流噪声：粒子i使用Philox计数器{i, stream低32位, stream高32位, 湍流域}，
+    // 与RandomStream(seed, RandomDomain::Turbulence, stream)的第i块一致
+    uint32_t noiseKey[2];
+    uint32_t noiseStream[2];
+};
+
+enum class KernelISA {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+using IntegrateKernel = void (*)(const IntegrationBatch& batch, const IntegrationConstants& constants,
+    size_t begin, size_t end);
+
+// 各实现结果逐位一致：运算顺序相同，且都不使用FMA与近似倒数
+void integrateParticlesScalar(const IntegrationBatch& batch, const IntegrationConstants& constants,
+    size_t begin, size_t end);
+void integrateParticlesSSE2(const IntegrationBatch& batch, const IntegrationConstants& constants,
+    size_t begin, size_t end);
+void integrateParticlesAVX2(const IntegrationBatch& batch, const IntegrationConstants& constants,
+    size_t begin, size_t end);
+
+// 运行时检测CPU支持的最高指令集
+KernelISA detectKernelISA();
+bool isKernelISASupported(KernelISA isa);
+IntegrateKernel getIntegrateKernel(KernelISA isa);
+const char* getKernelISAName(KernelISA isa);
+
+#endif
@@ -0,0 +1,331 @@
+#ifndef PARTICLE_SIMULATION_H
+#define PARTICLE_SIMULATION_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "particle_effect.h"
+#include "particle_kernels.h"
+#include "thread_pool.h"
+#include "random.h"
+#include "barnes_hut.h"
+#include "spatial_hash_grid.h"
+#include "sph_solver.h"
+#include "block_time_steps.h"
+#include "kepler_orbits.h"
+
+// 只读的SoA粒子数组，可以直接指向快照文件的内存映射
+struct ParticleArrays {
+    size_t count;
+    const float* posX;
+    const float* posY;
+    const float* posZ;
+    const float* velX;
+    const float* velY;
+    const float* velZ;
+    const float* life;
+    const uint8_t* type;
+    const float* colorR;
+    const float* colorG;
+    const float* colorB;
+    const float* size;
+};
+
+// 粒子状态按SoA存储：积分循环只触碰热数据，颜色与大小只在着色和打包时访问
+struct ParticleStore {
+    // 热数据
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;
+    std::vector<float> life;
+    std::vector<uint8_t> type; // 0=正常粒子, 1=喷流粒子, 2=爆炸粒子
+
+    // 冷数据
+    std::vector<float> colorR, colorG, colorB;
+    std::vector<float> size;
+
+    void resize(size_t count);
+    size_t count() const { return life.size(); }
+    ParticleArrays arrays() const;
+    // 整体替换为source中的数据
+    void assign(const ParticleArrays& source);
+
+    glm::vec3 position(size_t i) const { return glm::vec3(posX[i], posY[i], posZ[i]); }
+    glm::vec3 velocity(size_t i) const { return glm::vec3(velX[i], velY[i], velZ[i]); }
+    glm::vec3 color(size_t i) const { return glm::vec3(colorR[i], colorG[i], colorB[i]); }
+    void setPosition(size_t i, const glm::vec3& p) { posX[i] = p.x; posY[i] = p.y; posZ[i] = p.z; }
+    void setVelocity(size_t i, const glm::vec3& v) { velX[i] = v.x; velY[i] = v.y; velZ[i] = v.z; }
+    void setColor(size_t i, const glm::vec3& c) { colorR[i] = c.r; colorG[i] = c.g; colorB[i] = c.b; }
+};
+
+// 两个固定步之间的渲染插值：位置 = previous + (current - previous) * alpha
+struct RenderInterpolation {
+    const float* previousX; // 为nullptr时直接使用当前位置
+    const float* previousY;
+    const float* previousZ;
+    float alpha;
+
+    glm::vec3 position(const ParticleStore& particles, size_t i) const {
+        glm::vec3 current(particles.posX[i], particles.posY[i], particles.posZ[i]);
+        if (!previousX) {
+            return current;
+        }
+        glm::vec3 previous(previousX[i], previousY[i], previousZ[i]);
+        return previous + (current - previous) * alpha;
+    }
+};
+
+enum class IntegratorType {
+    SemiImplicitEuler,
+    Leapfrog            // 漂移-踢-漂移，辛积分，长时间轨道能量不漂移
+};
+
+// 上传给GPU的实例数据，布局与particle.vs中的实例属性一致（28字节）
+struct ParticleInstance {
+    glm::vec3 position;
+    glm::vec3 color;
+    float size;
+};
+static_assert(sizeof(ParticleInstance) == 28, "ParticleInstance must stay tightly packed");
+
+struct ParticleParameters {
+    float blackHoleMass;
+    float particleLifetime;
+    float spiralStrength;
+    float turbulenceStrength;
+    float accretionDiskRadius;
+    float particleSize;
+    float colorIntensity;
+    glm::vec3 lightColor;
+    float lightIntensity;
+    glm::vec3 lightPosition;
+    glm::vec3 lightDirection;
+    bool directionalLight;
+
+    bool enableJet;
+    float jetStrength;
+    float jetAngle;
+    glm::vec3 jetDirection;
+    float jetParticleSpeed;
+
+    bool enableExplosion;
+    float explosionStrength;
+    float explosionDuration;
+    float explosionRadius;
+
+    // Barnes-Hut自引力
+    bool enableSelfGravity;
+    float particleMass;
+    float openingAngle;      // theta，越小越精确
+    float gravitySoftening;
+
+    // SPH压强与黏性（粒子质量与自引力共用particleMass）
+    bool enableSph;
+    float sphSmoothingLength;
+    float sphRestDensity;
+    float sphStiffness;
+    float sphViscosity;
+
+    // 时间步进：advance()以固定步长推进，每步再均分为substeps个子步
+    IntegratorType integrator;
+    float fixedTimeStep;
+    int substeps;
+
+    // 分层块时间步：靠近黑洞的粒子把每个子步再按2的幂细分，最多细分到1/2^maxTimeBin
+    bool adaptiveTimeSteps;
+    float timeStepAccuracy;  // 步长不超过 timeStepAccuracy * √(r³/M)
+    int maxTimeBin;
+
+    // 远场解析开普勒推进。只在开启自引力或SPH时生效：解析粒子省掉的是树遍历与SPH受力，
+    // 单纯的中心引力积分一步比解一次开普勒方程还便宜，没有相互作用时开启只会更慢
+    bool enableKeplerFastPath;
+    float keplerCaptureRadius;
+    float keplerInnerRadius;
+};
+
+// 参数与粒子数组之外需要保存的模拟状态：随机数由种子与计数器完全确定
+struct SimulationState {
+    uint64_t seed;
+    uint64_t stepIndex;
+    uint64_t explosionCount;
+    double timeAccumulator;
+    float explosionTimer;
+    bool explosionActive;
+    bool deterministic;
+};
+
+// 纯CPU粒子模拟，不依赖OpenGL，可在无窗口环境下运行
+class ParticleSimulation {
+private:
+    // 并行更新时每块的粒子数，取向量宽度的整数倍
+    static constexpr size_t UpdateChunkSize = 16384;
+
+    ParticleStore particles;
+    int maxParticles;
+
+    ParticleParameters params;
+
+    float explosionTimer;
+    bool explosionActive;
+
+    KernelISA kernelISA;
+    IntegrateKernel integrateKernel;
+
+    ThreadPool threadPool;
+
+    // 按块划分的待重生列表与空闲列表，每块只由领取它的线程写入
+    std::vector<std::vector<uint32_t>> chunkRespawnLists;
+    std::vector<std::vector<uint32_t>> chunkFreeLists;
+
+    // 空闲槽位表：update()结束时重建，生成粒子时从表尾取出
+    std::vector<uint32_t> freeSlots;
+    size_t freeSlotCount;
+
+    // 粒子间相互作用：自引力与SPH的加速度累加到同一组数组，作为外部项交给积分内核
+    BarnesHutTree gravityTree;
+    SpatialHashGrid neighborGrid;
+    SphSolver sphSolver;
+    std::vector<float> externalAccelX, externalAccelY, externalAccelZ;
+    double treeBuildMs;
+    double treeTraversalMs;
+    double gridBuildMs;
+    double sphMs;
+
+    BlockTimeStepper blockStepper;
+    KeplerPropagator keplerOrbits;
+    std::vector<double> chunkKeplerMs;
+    double keplerMs;
+
+    // 解析粒子较多的块把要积分的粒子收集到所在工作线程的临时数组中，按工作线程下标分配
+    struct IntegrationScratch {
+        std::vector<uint32_t> index;    // 临时数组位置 -> 原粒子下标，也作为湍流噪声下标
+        std::vector<float> posX, posY, posZ;
+        std::vector<float> velX, velY, velZ;
+        std::vector<float> life;
+        std::vector<uint8_t> type;
+        std::vector<float> colorR, colorG, colorB;
+        std::vector<float> accelX, accelY, accelZ;
+    };
+    std::vector<IntegrationScratch> integrationScratch;
+
+    KeplerSettings getKeplerSettings() const;
+    // 积分[begin, end)中不由解析轨道推进的粒子，结果与直接按掩码积分逐位相同
+    void integrateChunk(const IntegrationBatch& batch, const IntegrationConstants& constants,
+        size_t begin, size_t end, IntegrationScratch& scratch);
+
+    // 计算本帧的粒子间加速度，没有启用任何相互作用时返回false
+    bool computeInteractions();
+
+    // 计数器随机数：种子 + 帧序号即可还原任意一帧的随机数
+    uint64_t seed;
+    uint64_t stepIndex;
+    uint64_t explosionCount;
+
+    // 固定步长累积器，单帧最多补MaxStepsPerFrame步，超出的时间直接丢弃以免越积越多
+    static constexpr int MaxStepsPerFrame = 8;
+    double timeAccumulator;
+    float interpolationAlpha;
+    int stepsLastFrame;
+    bool deterministic;
+
+    // 最近一个固定步开始时的位置，用于渲染插值；为空表示还没有按固定步推进过
+    std::vector<float> previousX, previousY, previousZ;
+
+    void initializeParticles();
+    void resetParticle(size_t i, RandomStream& rng);
+    // 粒子被重置到新位置时同步插值起点，避免渲染出从旧位置滑过来的一帧
+    void syncPreviousPosition(size_t i);
+
+    void updateExplosionParticles(float deltaTime);
+
+public:
+    // 连续领取的一批空闲槽位，在下一次claimSlots或update之前有效
+    struct SlotRange {
+        const uint32_t* indices;
+        size_t count;
+    };
+
+    ParticleSimulation(int maxParticles);
+
+    // 按参数中的积分器推进一步，步长由调用方决定
+    void update(float deltaTime);
+    // 把一帧的真实时长累积起来，以固定步长（含子步）推进，返回本帧执行的固定步数。
+    // 确定性模式下忽略frameTime，每次调用恰好推进一个固定步
+    int advance(float frameTime);
+    // 在黑洞中心生成最多ExplosionParticles个爆炸粒子，只使用空闲槽位
+    void triggerExplosion();
+    static constexpr size_t ExplosionParticles = 500;
+    // 在黑洞中心生成最多count个喷流粒子；启用喷流时update每步生成JetParticlesPerStep个
+    void spawnJetParticles(size_t count);
+    static constexpr size_t JetParticlesPerStep = 5;
+    // 把[first, first + count)中存活的粒子当作寿命耗尽的特效粒子放回空闲表，
+    // 供基准测试在粒子全部存活时准备可生成的槽位
+    void retireParticles(size_t first, size_t count);
+
+    // 一次领取最多count个死亡粒子的槽位供批量生成，空闲不足时返回的数量更少
+    SlotRange claimSlots(size_t count);
+    size_t getFreeSlotCount() const { return freeSlotCount; }
+    // 尚未领取的空闲槽位，共getFreeSlotCount()个
+    const uint32_t* getFreeSlots() const { return freeSlots.data(); }
+
+    // 保存与恢复：恢复后按相同输入推进与保存前逐位一致。粒子数改为快照中的数量；
+    // 解析轨道根数随状态一起保存；orbits为空时清空解析集合，开启开普勒快速路径的运行此时不再逐位一致。
+    // 渲染插值起点不保存，在之后的第一步重新建立。调用方负责保证槽位都小于arrays.count
+    SimulationState getState() const;
+    const KeplerPropagator& getKeplerOrbits() const { return keplerOrbits; }
+    void restoreState(const ParticleParameters& parameters, const SimulationState& state,
+        const ParticleArrays& arrays, const uint32_t* slots, size_t slotCount,
+        const KeplerOrbitArrays* orbits);
+
+    void applyEffect(const ParticleEffect& effect);
+
+    ParticleParameters& getParameters() { return params; }
+    const ParticleParameters& getParameters() const { return params; }
+    // 将存活粒子（life > 0）按原顺序打包为GPU实例流，位置按渲染插值计算，返回写入的实例数
+    size_t packInstances(ParticleInstance* out) const;
+
+    RenderInterpolation getRenderInterpolation() const;
+    float getInterpolationAlpha() const { return interpolationAlpha; }
+    int getStepsLastFrame() const { return stepsLastFrame; }
+    uint64_t getStepIndex() const { return stepIndex; }
+
+    // 确定性模式：固定种子 + 每帧一个固定步，相同输入逐位得到相同的粒子状态
+    void setDeterministic(bool enabled);
+    bool isDeterministic() const { return deterministic; }
+
+    const ParticleStore& getParticles() const { return particles; }
+    int getParticleCount() const { return static_cast<int>(particles.count()); }
+    int getMaxParticles() const { return maxParticles; }
+
+    // 不支持的指令集会回退到标量实现
+    void setKernelISA(KernelISA isa);
+    KernelISA getKernelISA() const { return kernelISA; }
+
+    // 线程数包含调用update()的线程
+    void setThreadCount(int threadCount);
+    int getThreadCount() const { return threadPool.getThreadCount(); }
+
+    // 固定种子并重新生成全部粒子，相同种子与输入得到相同的粒子状态
+    void setSeed(uint64_t newSeed);
+    uint64_t getSeed() const { return seed; }
+
+    // 最近一步的自引力耗时，未启用时为0
+    double getTreeBuildMs() const { return treeBuildMs; }
+    double getTreeTraversalMs() const { return treeTraversalMs; }
+    size_t getTreeNodeCount() const { return gravityTree.getNodeCount(); }
+    double getGridBuildMs() const { return gridBuildMs; }
+    double getSphMs() const { return sphMs; }
+    double getAverageNeighbors() const { return sphSolver.getAverageNeighbors(); }
+
+    // 最近一个子步的分档统计，仅在启用分层时间步时有意义
+    const BlockTimeStepper& getBlockTimeStepper() const { return blockStepper; }
+
+    bool isKeplerFastPathActive() const {
+        return params.enableKeplerFastPath && (params.enableSelfGravity || params.enableSph);
+    }
+    // 当前由解析轨道推进的粒子数；最近一步解析推进与捕获在各块上的耗时之和（多线程时大于墙钟时间）
+    size_t getAnalyticParticleCount() const { return keplerOrbits.getAnalyticCount(); }
+    double getKeplerMs() const { return keplerMs; }
+};
+
+#endif
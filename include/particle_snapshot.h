@@ -0,0 +1,164 @@
+#ifndef PARTICLE_SNAPSHOT_H
+#define PARTICLE_SNAPSHOT_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mapped_file.h"
+#include "particle_simulation.h"
+
+// 快照与录制共用一种分块文件格式：64字节文件头（魔数、版本、种类）之后是一串块，
+// 每块为16字节块头（四字符标签、负载字节数）加负载，块与块内数组都按64字节对齐，
+// 映射文件后粒子数组可以直接当作float数组使用。读取时跳过未知标签的块，
+// 已有块的布局改变时递增SnapshotVersion。
+//   状态快照：PARM参数、STAT计数器、PART粒子数组、FREE空闲槽位表、KEPL解析轨道根数
+//   录制：PARM、STAT（开始录制时），之后每帧一个FRAM块，内容为打包好的ParticleInstance流
+enum class SnapshotKind : uint32_t {
+    State = 0,
+    Recording = 1
+};
+
+// 以只读映射打开快照或录制文件，粒子数据不复制，访问时由页缓存按需载入
+class SnapshotFile {
+public:
+    struct Frame {
+        uint64_t stepIndex;
+        const ParticleInstance* instances;
+        size_t count;
+    };
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+
+    SnapshotKind getKind() const { return kind; }
+    const ParticleParameters& getParameters() const { return params; }
+    const SimulationState& getState() const { return state; }
+    // 保存时模拟的粒子数（录制时为最大实例数）
+    size_t getParticleCount() const { return particleCount; }
+    size_t getFileBytes() const { return file.size(); }
+
+    // 状态快照：数组指向映射，恢复时逐段复制进模拟
+    const ParticleArrays& getParticles() const { return arrays; }
+    bool restore(ParticleSimulation& simulation) const;
+
+    // 录制
+    size_t getFrameCount() const { return frames.size(); }
+    const Frame& getFrame(size_t index) const { return frames[index]; }
+
+private:
+    bool parseChunk(uint32_t tag, const unsigned char* payload, size_t bytes);
+    // 粒子数与各槽位下标都在PART的范围内，文件损坏或被改动时不会越界写入
+    bool validateState() const;
+
+    MappedFile file;
+    SnapshotKind kind = SnapshotKind::State;
+    ParticleParameters params = {};
+    SimulationState state = {};
+    size_t particleCount = 0;
+    bool hasParameters = false;
+    bool hasState = false;
+    bool hasParticles = false;
+    ParticleArrays arrays = {};
+    const uint32_t* freeSlots = nullptr;
+    size_t freeSlotCount = 0;
+    KeplerOrbitArrays orbits = {};
+    bool hasOrbits = false;
+    std::vector<Frame> frames;
+};
+
+// 后台写文件：调用线程只负责把数据放进缓冲，写盘在写线程中完成。
+// 积压的任务超过MaxPendingJobs时调用线程等待，内存占用有上限
+class AsyncFileWriter {
+public:
+    static const size_t MaxPendingJobs = 4;
+
+    AsyncFileWriter();
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    // 取一块空缓冲，优先复用已经写完的缓冲
+    std::vector<unsigned char> acquireBuffer();
+
+    // 整个文件：先写临时文件再改名，读者不会看到写了一半的文件
+    void writeFile(const std::string& path, std::vector<unsigned char> data);
+    // 追加流：openStream之后的append按顺序写入同一个文件
+    void openStream(const std::string& path);
+    void append(std::vector<unsigned char> data);
+    void closeStream();
+
+    // 等待所有已提交的任务完成
+    void wait();
+    bool hasFailed() const;
+    uint64_t getBytesWritten() const;
+
+private:
+    enum class JobType { WriteFile, OpenStream, Append, CloseStream };
+    struct Job {
+        JobType type;
+        std::string path;
+        std::vector<unsigned char> data;
+    };
+
+    void submit(Job job);
+    void writerLoop();
+    bool execute(Job& job);
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Job> jobs;
+    std::vector<std::vector<unsigned char>> spareBuffers;
+    bool busy = false;
+    bool stopRequested = false;
+    bool failed = false;
+    uint64_t bytesWritten = 0;
+    FILE* stream = nullptr;         // 只由写线程访问
+    std::string streamPath;
+    std::thread writer;
+};
+
+// 异步保存状态快照：调用线程上只做一次与粒子数据等量的复制
+class SnapshotWriter {
+public:
+    void save(const ParticleSimulation& simulation, const std::string& path);
+    void wait() { io.wait(); }
+    bool hasFailed() const { return io.hasFailed(); }
+    double getLastCopyMs() const { return lastCopyMs; }
+
+private:
+    AsyncFileWriter io;
+    double lastCopyMs = 0.0;
+};
+
+// 流式录制：每帧打包存活粒子为实例流并追加到文件，回放时不需要重新模拟
+class SnapshotRecorder {
+public:
+    ~SnapshotRecorder() { stop(); }
+
+    void start(const std::string& path, const ParticleSimulation& simulation);
+    void recordFrame(const ParticleSimulation& simulation);
+    void stop();
+
+    bool isRecording() const { return recording; }
+    bool hasFailed() const { return io.hasFailed(); }
+    uint64_t getFrameCount() const { return frameCount; }
+    uint64_t getBytesWritten() const { return io.getBytesWritten(); }
+
+private:
+    AsyncFileWriter io;
+    bool recording = false;
+    uint64_t frameCount = 0;
+};
+
+// 把模拟的完整状态编码为状态快照文件的内容
+void serializeSnapshot(const ParticleSimulation& simulation, std::vector<unsigned char>& data);
+
+#endif
@@ -4,95 +4,133 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <vector>
-#include <random>
+#include <memory>
 #include "shader.h"
-#include "particle_effect.h" 
-
-struct Particle {
-    glm::vec3 position;
-    glm::vec3 velocity;
-    glm::vec3 color;
-    float life;
-    float size;
-    float mass;
-    int type; // 0=, 1=, 2=ը
+#include "particle_effect.h"
+#include "particle_simulation.h"
+#include "instance_buffer.h"
+#include "gpu_particle_simulation.h"
+#include "particle_culling.h"
+#include "frame_uniforms.h"
+#include "rewind_buffer.h"
+
+enum class SimulationBackend {
+    CPU,
+    GPU
 };
 
-struct ParticleParameters {
-    float blackHoleMass;
-    float particleLifetime;
-    float spiralStrength;
-    float turbulenceStrength;
-    float accretionDiskRadius;
-    float particleSize;
-    float colorIntensity;
-    glm::vec3 lightColor;
-    float lightIntensity;
-    glm::vec3 lightPosition;
-    glm::vec3 lightDirection;
-    bool directionalLight;
-
-    bool enableJet;
-    float jetStrength;
-    float jetAngle;
-    glm::vec3 jetDirection;
-    float jetParticleSpeed;
-
-    bool enableExplosion;
-    float explosionStrength;
-    float explosionDuration;
-    float explosionRadius;
+// Mesh: 实例化的8x8球体网格；Impostor: 朝向相机的四边形，在片段着色器中重建球面法线与深度
+enum class ParticleRenderMode {
+    Mesh,
+    Impostor
 };
 
+// 基准结果与日志中使用的模式名："mesh"或"impostor"
+const char* getRenderModeName(ParticleRenderMode mode);
+
+// 粒子渲染器：物理计算交给ParticleSimulation，这里只负责GPU缓冲与绘制
 class ParticleSystem {
 private:
-    std::vector<Particle> particles;
+    ParticleSimulation simulation;
     int maxParticles;
 
     GLuint sphereVAO, sphereVBO, sphereEBO;
     std::vector<glm::vec3> sphereVertices;
     std::vector<glm::vec3> sphereNormals;
     std::vector<unsigned int> sphereIndices;
-    int sphereIndexCount;
 
-    GLuint instanceVBO;
+    struct SphereLod {
+        size_t firstIndex;
+        GLsizei indexCount;
+    };
+    SphereLod sphereLods[ParticleLodCount];
+
+    InstanceRingBuffer instanceBuffer;
+    size_t instanceOffset;
+    size_t instanceCount;
+    GLuint boundInstanceBuffer;
+    size_t boundInstanceOffset;
+
+    // 黑洞只绘制为固定20像素的点精灵（不透明部分约4像素），没有与世界尺寸对应的遮挡体，
+    // 按吞噬半径剔除会让本可见的粒子消失。在绘制出同样大小的遮挡体之前不做阴影剔除
+    static constexpr float HorizonCullRadius = 0.0f;
+    bool cullingEnabled;
+    CullingStats cullingStats;
+    std::vector<uint8_t> lodScratch;
+
+    // GPU后端在第一次选择时才创建
+    SimulationBackend backend;
+    std::unique_ptr<GpuParticleSimulation> gpuSimulation;
 
-    ParticleParameters params;
+    ParticleRenderMode renderMode;
 
-    float explosionTimer;
-    bool explosionActive;
+    // 回看：开启后每个模拟步记录一帧；scrubFrame不小于0时暂停模拟，显示重建的该帧
+    RewindBuffer rewind;
+    bool rewindEnabled;
+    int scrubFrame;
 
-    void initializeParticles();
-    void resetParticle(Particle& p, std::mt19937& gen,
-        std::uniform_real_distribution<float>& dist,
-        std::uniform_real_distribution<float>& distColor);
     void setupSphereGeometry();
     void setupBuffers();
-    void updateBuffers();
-
-    void updateJetParticles(float deltaTime);
-    void triggerExplosion();
-    void updateExplosionParticles(float deltaTime);
+    void bindInstanceAttributes(GLuint buffer, size_t baseOffset);
+    void updateBuffers(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos, float viewportHeight);
+    void drawInstances(int lod, size_t baseOffset, GLsizei count);
 
 public:
     ParticleSystem(int maxParticles);
     ~ParticleSystem();
     void update(float deltaTime, const glm::vec3& cameraPosition);
-    void render(Shader& shader, const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos);
-    void applyEffect(const ParticleEffect& effect);
-
-    ParticleParameters& getParameters() { return params; }
-    int getParticleCount() const { return particles.size(); }
-
-    void setLightPosition(const glm::vec3& pos) { params.lightPosition = pos; }
-    void setLightDirection(const glm::vec3& dir) { params.lightDirection = glm::normalize(dir); }
-    void setDirectionalLight(bool directional) { params.directionalLight = directional; }
-
-    void setJetEnabled(bool enabled) { params.enableJet = enabled; }
-    void setJetStrength(float strength) { params.jetStrength = strength; }
-    void triggerExplosionEffect() { triggerExplosion(); }
-    void setExplosionEnabled(bool enabled) { params.enableExplosion = enabled; }
-    void setExplosionStrength(float strength) { params.explosionStrength = strength; }
+    // 剔除并上传本帧的实例数据（GPU后端为存活粒子压缩），在render之前调用。
+    // viewportHeight为绘制目标的像素高度，用于按投影半径选择LOD，由调用方跟踪，不查询GL状态
+    void prepareRender(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos, float viewportHeight);
+    // 回放录制时代替prepareRender：直接上传录好的实例，不模拟也不剔除，只用CPU后端
+    void prepareReplay(const ParticleInstance* instances, size_t count);
+    // shader需与当前渲染模式对应：particle.vs/fs或particle_impostor.vs/fs。
+    // 相机矩阵与光照来自FrameUniforms块，调用前需已上传本帧数据
+    void render(Shader& shader);
+    void applyEffect(const ParticleEffect& effect) { simulation.applyEffect(effect); }
+    // 填写FrameUniforms中的光照与颜色参数
+    void fillLightUniforms(FrameUniforms& frame) const;
+
+    ParticleSimulation& getSimulation() { return simulation; }
+    ParticleParameters& getParameters() { return simulation.getParameters(); }
+    int getParticleCount() const { return simulation.getParticleCount(); }
+    size_t getFreeSlotCount() const { return backend == SimulationBackend::CPU ? simulation.getFreeSlotCount() : 0; }
+    bool isPersistentUpload() const { return instanceBuffer.isPersistent(); }
+    // 本帧上传的实例字节数，只包含存活且未被剔除的粒子
+    size_t getUploadBytes() const { return backend == SimulationBackend::CPU ? instanceCount * sizeof(ParticleInstance) : 0; }
+    bool hasGpuCompaction() const { return gpuSimulation && gpuSimulation->hasCompaction(); }
+    // GPU压缩后绘制的存活粒子数，延迟几帧读回；没有压缩或还没有结果时返回-1
+    int getGpuLiveCount() const { return hasGpuCompaction() ? gpuSimulation->getLiveCount() : -1; }
+
+    void setBackend(SimulationBackend newBackend);
+    SimulationBackend getBackend() const { return backend; }
+
+    void setRenderMode(ParticleRenderMode mode) { renderMode = mode; }
+    ParticleRenderMode getRenderMode() const { return renderMode; }
+
+    // 视锥剔除（黑洞阴影剔除已关闭，见HorizonCullRadius），存活实例按投影大小选择球体LOD
+    void setCullingEnabled(bool enabled) { cullingEnabled = enabled; }
+    bool isCullingEnabled() const { return cullingEnabled; }
+    const CullingStats& getCullingStats() const { return cullingStats; }
+
+    // 回看只支持CPU后端，关闭时丢弃已记录的帧
+    void setRewindEnabled(bool enabled);
+    bool isRewindEnabled() const { return rewindEnabled; }
+    RewindBuffer& getRewindBuffer() { return rewind; }
+    // 定位到第frame帧（0为最旧）并暂停模拟；-1回到实时，模拟从暂停处继续
+    void setScrubFrame(int frame);
+    int getScrubFrame() const { return scrubFrame; }
+    bool isScrubbing() const { return scrubFrame >= 0; }
+
+    void setLightPosition(const glm::vec3& pos) { getParameters().lightPosition = pos; }
+    void setLightDirection(const glm::vec3& dir) { getParameters().lightDirection = glm::normalize(dir); }
+    void setDirectionalLight(bool directional) { getParameters().directionalLight = directional; }
+
+    void setJetEnabled(bool enabled) { getParameters().enableJet = enabled; }
+    void setJetStrength(float strength) { getParameters().jetStrength = strength; }
+    void triggerExplosionEffect();
+    void setExplosionEnabled(bool enabled) { getParameters().enableExplosion = enabled; }
+    void setExplosionStrength(float strength) { getParameters().explosionStrength = strength; }
 };
 
-#endif
\ No newline at end of file
+#endif
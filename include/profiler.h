@@ -0,0 +1,115 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// 逐帧分段计时。每段同时记录CPU耗时（steady_clock）与GPU耗时（GL_TIME_ELAPSED查询），
+// 结果按帧写入环形历史，用于统计最小/平均/p99、绘制曲线和导出Chrome trace。
+// GPU查询按帧轮换QueryFrames（3）组：某组在发出QueryFrames帧之后复用时才读取结果。
+// 只用两组（双缓冲）时结果要在下一帧开始前就绪，驱动通常缓冲2帧以上，大多数帧会缺失。
+// 复用时结果仍未就绪的查询被丢弃，该帧该段的GPU样本记为缺失并计数，从不等待GPU。
+// GL_TIME_ELAPSED不能嵌套，嵌套的段只记录CPU时间（不计为丢弃）。
+class Profiler {
+public:
+    static const int MaxSections = 16;
+    static const int HistoryFrames = 240;
+    static const int QueryFrames = 3;
+
+    struct Stats {
+        float last;
+        float min;
+        float avg;
+        float p99;
+        int samples;
+    };
+
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void beginFrame();
+    void endFrame();
+
+    // 开启后取回GPU结果时等待查询完成，不再丢弃未就绪的帧，用于需要完整数据的基准测试
+    void setWaitForGpuResults(bool enabled) { waitForGpu = enabled; }
+    // 在两帧之间调用：等待GPU完成并取回所有已发出查询的结果
+    void finish();
+
+    // name须为静态字符串，同名的段共用一行历史；返回段编号，段数已满时返回-1
+    int beginSection(const char* name);
+    void endSection(int section);
+
+    int getSectionCount() const { return sectionCount; }
+    const char* getSectionName(int section) const { return sectionNames[section]; }
+
+    // 毫秒。section为-1时统计整帧CPU时间；没有GPU结果的帧不计入
+    Stats getStats(int section, bool gpu) const;
+    // 按时间顺序（最旧在前）写出HistoryFrames个值，缺失的帧为0
+    void copyHistory(int section, bool gpu, float* values) const;
+
+    // 下一帧的序号，即已经结束的帧数
+    uint64_t getFrameIndex() const { return frameIndex; }
+    // 某一已结束帧的单个样本（毫秒），section为-1时为整帧CPU时间；
+    // 缺失或已移出历史时返回负值。GPU结果要在QueryFrames帧之后（或finish之后）才完整
+    float getSample(int section, bool gpu, uint64_t frame) const;
+    // 某帧该段发出了GPU查询，但复用前结果未就绪而被丢弃
+    bool isGpuSampleDropped(int section, uint64_t frame) const;
+    // 启动以来被丢弃的GPU样本总数
+    uint64_t getDroppedGpuSamples() const { return droppedGpuSamples; }
+
+    // 把历史中的全部帧写成Chrome trace JSON（chrome://tracing或Perfetto打开）
+    bool exportChromeTrace(const std::string& path) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int findSection(const char* name);
+    float& cpuSample(int section, uint64_t frame) { return cpuMs[section][frame % HistoryFrames]; }
+    void collectGpuResults(int slot);
+    double microsecondsSince(Clock::time_point time) const;
+
+    int sectionCount;
+    const char* sectionNames[MaxSections];
+
+    uint64_t frameIndex;            // 当前帧序号
+    Clock::time_point epoch;
+    Clock::time_point frameStart;
+    Clock::time_point sectionStart[MaxSections];
+
+    // 历史，负值表示缺失
+    float frameMs[HistoryFrames];
+    double frameStartUs[HistoryFrames];
+    float cpuMs[MaxSections][HistoryFrames];
+    float gpuMs[MaxSections][HistoryFrames];
+    double sectionStartUs[MaxSections][HistoryFrames];
+    bool gpuDropped[MaxSections][HistoryFrames];
+
+    // GPU查询
+    GLuint queries[QueryFrames][MaxSections];
+    bool queryIssued[QueryFrames][MaxSections];
+    uint64_t queryFrame[QueryFrames];
+    int gpuSection;                 // 正在计时的段，-1表示没有
+    uint64_t droppedGpuSamples;
+    bool waitForGpu;
+};
+
+// 作用域计时：构造时开始，析构时结束
+class ProfileScope {
+public:
+    ProfileScope(Profiler& profiler, const char* name) : profiler(profiler), section(profiler.beginSection(name)) {}
+    ~ProfileScope() { profiler.endSection(section); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& profiler;
+    int section;
+};
+
+#endif
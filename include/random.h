@@ -0,0 +1,97 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// Philox4x32-10 计数器随机数（Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"）。
+// 输出只由(key, counter)决定，不需要保存或推进状态，
+// 因此每个粒子、每一帧都可以直接算出自己的随机数，与线程划分无关。
+
+namespace philox {
+
+const uint32_t M0 = 0xD2511F53u;
+const uint32_t M1 = 0xCD9E8D57u;
+const uint32_t W0 = 0x9E3779B9u;
+const uint32_t W1 = 0xBB67AE85u;
+const int Rounds = 10;
+
+inline void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+    uint64_t product = static_cast<uint64_t>(a) * b;
+    hi = static_cast<uint32_t>(product >> 32);
+    lo = static_cast<uint32_t>(product);
+}
+
+// counter原地替换为4个随机数
+inline void generate(uint32_t counter[4], uint32_t key0, uint32_t key1) {
+    for (int round = 0; round < Rounds; ++round) {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulhilo(M0, counter[0], hi0, lo0);
+        mulhilo(M1, counter[2], hi1, lo1);
+
+        uint32_t c0 = hi1 ^ counter[1] ^ key0;
+        uint32_t c2 = hi0 ^ counter[3] ^ key1;
+        counter[0] = c0;
+        counter[1] = lo1;
+        counter[2] = c2;
+        counter[3] = lo0;
+
+        key0 += W0;
+        key1 += W1;
+    }
+}
+
+// 取高24位转换为[0, 1)，结果可被float精确表示
+inline float toUnitFloat(uint32_t x) {
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+}
+
+// 不同用途的随机数放在不同的域里，互不重叠
+enum class RandomDomain : uint32_t {
+    Turbulence = 1,
+    Respawn = 2,
+    Jet = 3,
+    Explosion = 4,
+    Initial = 5
+};
+
+// 计数器布局：{块序号, stream低32位, stream高32位, 域}，每块产生4个数
+class RandomStream {
+public:
+    RandomStream(uint64_t seed, RandomDomain domain, uint64_t stream)
+        : key0(static_cast<uint32_t>(seed)), key1(static_cast<uint32_t>(seed >> 32)),
+          streamLo(static_cast<uint32_t>(stream)), streamHi(static_cast<uint32_t>(stream >> 32)),
+          domainId(static_cast<uint32_t>(domain)), block(0), index(4) {}
+
+    uint32_t nextUInt() {
+        if (index == 4) {
+            refill();
+        }
+        return buffer[index++];
+    }
+
+    // [0, 1)
+    float nextFloat() { return philox::toUnitFloat(nextUInt()); }
+    // [lo, hi)
+    float nextFloat(float lo, float hi) { return lo + nextFloat() * (hi - lo); }
+
+private:
+    void refill() {
+        buffer[0] = block++;
+        buffer[1] = streamLo;
+        buffer[2] = streamHi;
+        buffer[3] = domainId;
+        philox::generate(buffer, key0, key1);
+        index = 0;
+    }
+
+    uint32_t key0, key1;
+    uint32_t streamLo, streamHi;
+    uint32_t domainId;
+    uint32_t block;
+    uint32_t buffer[4];
+    int index;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "particle_simulation.h"
+#include "thread_pool.h"
+
+// 最近若干秒的渲染状态，用于在时间轴上回看。每KeyframeInterval帧一个关键帧，
+// 其余帧只保存相对预测位置（上一帧位置加上一帧位移）的量化残差，
+// 颜色存为fp16，差分帧中再保存为相对上一帧的8位差值。
+// 编码端按解码结果推进预测，误差不随帧数累积：位置误差约为PositionStep/2，颜色与fp16一致。
+// 总内存超过预算时按关键帧分组丢弃最旧的帧。
+// 差分帧中每个存活粒子约为2位模式 + 3字节位置残差 + 3字节颜色差值，原始实例为28字节。
+// 粒子按BlockSize分块独立编码，编码与解码在线程池中并行
+class RewindBuffer {
+public:
+    static constexpr float PositionStep = 1.0f / 1024.0f;
+    static const size_t DefaultBudgetBytes = 512u * 1024u * 1024u;
+    static const int DefaultKeyframeInterval = 30;
+    static const size_t BlockSize = 65536;
+
+    explicit RewindBuffer(size_t budgetBytes = DefaultBudgetBytes, int keyframeInterval = DefaultKeyframeInterval);
+
+    void setBudget(size_t bytes) { budgetBytes = bytes; }
+    size_t getBudget() const { return budgetBytes; }
+    void setKeyframeInterval(int frames) { keyframeInterval = frames > 0 ? frames : 1; }
+    int getKeyframeInterval() const { return keyframeInterval; }
+    void setThreadCount(int threadCount) { threadPool.setThreadCount(threadCount); }
+    int getThreadCount() const { return threadPool.getThreadCount(); }
+
+    void clear();
+    // 记录模拟的当前状态；自上次记录以来没有推进过的状态不重复记录。
+    // 粒子数改变或步数回退（重置、恢复快照）时清空已有的帧
+    void capture(const ParticleSimulation& simulation);
+
+    size_t getFrameCount() const { return frames.size(); }
+    uint64_t getFrameStep(size_t index) const { return frames[index].stepIndex; }
+    // 重建第index帧（0为最旧）的存活粒子实例，顺序与packInstances一致。
+    // 向后逐帧拖动时从上次的结果继续解码，否则从之前最近的关键帧开始
+    const std::vector<ParticleInstance>& reconstruct(size_t index);
+
+    size_t getMemoryBytes() const { return memoryBytes; }
+    // 同样的帧以ParticleInstance数组保存所需的字节数
+    size_t getRawBytes() const { return rawBytes; }
+    double getLastEncodeMs() const { return lastEncodeMs; }
+    double getLastDecodeMs() const { return lastDecodeMs; }
+
+private:
+    // 每个粒子2位：死亡、8位残差、16位残差、原值（新生、大小改变或残差超出范围）
+    enum Mode : uint8_t {
+        Dead = 0,
+        SmallResidual = 1,
+        LargeResidual = 2,
+        Raw = 3
+    };
+
+    // 一块在帧数据中的位置与各段的元素数。块内各段依次为：
+    // 原值位置(float×3)、fp16颜色、原值大小(fp16)、16位残差(×3)、模式(每字节4个粒子)、
+    // 8位残差(×3)、颜色差值(×3，每个残差粒子；-128表示该通道的fp16值在颜色段中)
+    struct Block {
+        size_t offset;
+        uint32_t live;
+        uint32_t raw;
+        uint32_t large;
+        uint32_t small;
+        uint32_t colors;
+    };
+
+    struct EncodedFrame {
+        uint64_t stepIndex;
+        bool keyframe;
+        uint32_t liveCount;
+        std::vector<Block> blocks;
+        std::vector<unsigned char> data;
+
+        size_t bytes() const { return sizeof(EncodedFrame) + blocks.capacity() * sizeof(Block) + data.capacity(); }
+    };
+
+    // 每个粒子的预测状态：上一帧的重建位置、位移与fp16颜色、大小。
+    // 编码端与解码端各持有一份，两边用同样的运算推进，结果逐位一致。
+    // 按粒子连续存放，编解码循环只多一路顺序访问
+    struct Predictor {
+        float x, y, z;
+        float dx, dy, dz;
+        uint16_t r, g, b;
+        uint16_t size;
+        uint8_t alive;
+    };
+
+    void encodeBlock(const ParticleStore& particles, bool keyframe, size_t block, Block& info);
+    void decodeBlock(const EncodedFrame& frame, size_t block, ParticleInstance* out);
+    // out为空时只推进预测，不输出实例
+    void decode(const EncodedFrame& frame, std::vector<ParticleInstance>* out);
+    std::vector<unsigned char> acquireData(size_t bytes);
+    void evict();
+
+    size_t budgetBytes;
+    int keyframeInterval;
+    ThreadPool threadPool;
+
+    std::deque<EncodedFrame> frames;
+    std::vector<std::vector<unsigned char>> spareData;     // 被丢弃帧的缓冲，大小合适时复用
+
+    // 编码时各块先写入按最坏情况分配的暂存区，完成后按实际大小复制进帧
+    std::vector<float> rawScratch;
+    std::vector<uint16_t> colorScratch;
+    std::vector<uint16_t> sizeScratch;
+    std::vector<int16_t> largeScratch;
+    std::vector<uint8_t> modeScratch;
+    std::vector<int8_t> smallScratch;
+    std::vector<int8_t> colorDeltaScratch;
+
+    size_t slotCount;
+    uint64_t firstSerial;       // frames.front()的序号，序号随记录递增
+    uint64_t lastStep;
+    int framesSinceKeyframe;
+    size_t memoryBytes;
+    size_t rawBytes;
+    double lastEncodeMs;
+    double lastDecodeMs;
+
+    std::vector<Predictor> encoder;
+    std::vector<Predictor> decoder;
+    uint64_t decodedSerial;     // 解码端当前停在的帧
+    std::vector<ParticleInstance> decoded;
+};
+
+#endif
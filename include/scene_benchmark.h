@@ -0,0 +1,58 @@
+#ifndef SCENE_BENCHMARK_H
+#define SCENE_BENCHMARK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "profiler.h"
+
+// 写入结果文件的运行配置
+struct SceneBenchmarkInfo {
+    std::string effect;
+    std::string cameraPath;
+    std::string renderer;       // GL_RENDERER
+    std::string backend;
+    std::string renderMode;
+    int width;
+    int height;
+    int particles;
+    int warmupFrames;
+    float deltaTime;
+    uint64_t seed;
+};
+
+// 场景基准的逐帧计时：每帧结束后从Profiler取回GPU结果已经完整的帧，
+// 运行结束后写出逐帧CSV与各段CPU/GPU耗时百分位数的JSON
+class SceneBenchmark {
+public:
+    // 此序号之前的帧（预热）不记录
+    void setFirstFrame(uint64_t frame) { nextFrame = frame; }
+
+    // 每帧endFrame之后调用；final为true时须先调用profiler.finish()，取回剩余的全部帧
+    void collect(const Profiler& profiler, bool final);
+    size_t getFrameCount() const { return samples.size(); }
+
+    bool writeCsv(const std::string& path, const Profiler& profiler, const SceneBenchmarkInfo& info) const;
+    bool writeJson(const std::string& path, const Profiler& profiler, const SceneBenchmarkInfo& info) const;
+
+    // 毫秒，负值表示没有样本。column为-1时是整帧，否则是段编号
+    float getPercentile(int column, bool gpu, float percentile) const;
+
+private:
+    struct FrameSample {
+        float cpuFrameMs;
+        float gpuFrameMs;                   // 各段GPU时间之和，没有任何GPU结果时为负
+        float cpuMs[Profiler::MaxSections];
+        float gpuMs[Profiler::MaxSections];
+        bool gpuDropped[Profiler::MaxSections]; // 查询结果未及时就绪，gpuMs因此缺失
+    };
+
+    void gatherColumn(int column, bool gpu, std::vector<float>& values) const;
+    // column为-1时统计所有段
+    size_t countDropped(int column) const;
+
+    std::vector<FrameSample> samples;
+    uint64_t nextFrame = 0;
+};
+
+#endif
@@ -1,18 +1,92 @@
 #ifndef SCRIPT_PARSER_H
 #define SCRIPT_PARSER_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
+#include "particle_effect.h"
 
-// ǰ
-struct ParticleEffect;
+// 监视线程发布给渲染线程的一次特效变化
+struct EffectUpdate {
+    ParticleEffect effect;
+    bool removed = false;   // 脚本文件被删除，此时只有effect.name有效
+};
+
+// 单生产者单消费者环形队列：监视线程写入，渲染线程读取，两端都不加锁
+class EffectUpdateQueue {
+public:
+    static const size_t Capacity = 64;
+
+    // 队列已满时返回false，update保持不变
+    bool push(EffectUpdate& update);
+    bool pop(EffectUpdate& update);
+
+private:
+    EffectUpdate slots[Capacity];
+    std::atomic<size_t> head{ 0 };  // 下一个读取位置，只由消费者推进
+    std::atomic<size_t> tail{ 0 };  // 下一个写入位置，只由生产者推进
+};
 
+// 特效脚本库。载入时先读目录下的二进制缓存，修改时间与大小都未变的脚本直接使用缓存结果，
+// 只有新增或修改过的脚本重新解析。startWatching后由后台线程监视目录（Linux上使用inotify，
+// 其他平台定时比较修改时间），只重新解析发生变化的文件，校验通过的结果经无锁队列交给渲染线程，
+// 渲染线程每帧调用pollUpdates取用，解析不会阻塞帧循环。
 class ScriptParser {
+public:
+    ScriptParser() = default;
+    ~ScriptParser();
+
+    ScriptParser(const ScriptParser&) = delete;
+    ScriptParser& operator=(const ScriptParser&) = delete;
+
+    void loadScripts(const std::string& directory);
+    // 在loadScripts之后调用；之后目录状态只由监视线程维护
+    void startWatching();
+    void stopWatching();
+    bool isWatching() const { return watcher.joinable(); }
+
+    // 在渲染线程调用：合并监视线程发布的更新，changed返回新增、修改或删除的特效名
+    void pollUpdates(std::vector<std::string>& changed);
+
+    const std::vector<ParticleEffect>& getEffects() const { return effects; }
+    const ParticleEffect* findEffect(const std::string& name) const;
+
+    // 最近一次loadScripts的统计
+    size_t getCachedCount() const { return cachedCount; }
+    size_t getParsedCount() const { return parsedCount; }
+    double getLoadMs() const { return loadMs; }
+    size_t getReloadCount() const { return reloadCount; }
+
 private:
-    std::vector<ParticleEffect> effects;
+    // 一个脚本文件及其解析结果，修改时间与大小用于判断缓存是否仍然有效
+    struct ScriptEntry {
+        int64_t modified;
+        uint64_t size;
+        bool valid;     // 解析或校验失败时为false，effect为上一个有效版本（如果有）
+        ParticleEffect effect;
+    };
+    using Catalog = std::map<std::string, ScriptEntry>; // 文件名 -> 条目
+
+    // 解析并校验一个脚本，失败时返回false且effect无效；不访问成员，可在任意线程调用
+    static bool parseEffectScript(const std::string& filename, ParticleEffect& effect);
+    static bool parseParameter(const std::string& key, const std::string& value, ParticleEffect& effect);
+    static bool validateEffect(const ParticleEffect& effect, std::string& error);
+
+    static bool readCache(const std::string& path, Catalog& catalog);
+    static void writeCache(const std::string& path, const Catalog& catalog);
+
+    void watchLoop();
+    // 比较目录与catalog中的时间戳，没有inotify时使用
+    void findChangedFiles(std::set<std::string>& pending) const;
+    // 监视线程中重新检查一个文件，发布变化；返回目录状态是否改变
+    bool rescanFile(const std::string& filename);
+    void publish(EffectUpdate& update);
 
-    void parseEffectScript(const std::string& filename);
-    void parseParameter(const std::string& key, const std::string& value, ParticleEffect& effect);
     void createDefaultScripts(const std::string& directory);
     void createEffectScript(const std::string& filename,
         const std::string& name,
@@ -22,9 +96,17 @@ private:
         float colorIntensity, bool enableJet, float jetStrength,
         bool enableExplosion, float explosionStrength);
 
-public:
-    void loadScripts(const std::string& directory);
-    const std::vector<ParticleEffect>& getEffects() const { return effects; }
+    std::vector<ParticleEffect> effects;    // 按名字排序，只在渲染线程访问
+    size_t cachedCount = 0;
+    size_t parsedCount = 0;
+    double loadMs = 0.0;
+    size_t reloadCount = 0;
+
+    std::string directory;
+    Catalog catalog;                        // startWatching之后归监视线程所有
+    std::thread watcher;
+    std::atomic<bool> stopRequested{ false };
+    EffectUpdateQueue updates;
 };
 
-#endif
\ No newline at end of file
+#endif
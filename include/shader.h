@@ -3,27 +3,99 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
+// 带类型的uniform句柄，在初始化时按名字取得一次，之后设置时不再查找。
+// 未激活或不存在的uniform位置为-1，glUniform*会忽略
+template <typename T>
+struct Uniform {
+    GLint location = -1;
+};
+
+// 着色器程序。构造时先按源码、驱动厂商与渲染器的哈希查找磁盘上的程序二进制缓存，
+// 命中时用glProgramBinary直接载入；否则提交编译与链接后立即返回，不查询结果。
+// 驱动支持KHR/ARB_parallel_shader_compile时编译在驱动线程上进行，
+// 第一次use()/getUniform()/bindUniformBlock()时等待链接完成、检查错误并写入缓存。
+// 不想阻塞的调用方先用isReady()轮询，就绪后再使用程序（见main.cpp的帧循环）。
 class Shader {
 public:
     unsigned int ID;
 
     Shader(const char* vertexPath, const char* fragmentPath);
+    // 只有顶点着色器的变换反馈程序，varyings按交错方式写入同一个缓冲
+    Shader(const char* vertexPath, const char* const* feedbackVaryings, int varyingCount);
+    // 计算着色器程序（GL 4.3）
+    explicit Shader(const char* computePath);
+
+    // 在glewInit之后、创建任何程序之前调用：设置二进制缓存目录（为空则不缓存），
+    // 并让驱动使用全部编译线程
+    static void initialize(const std::string& cacheDirectory);
 
     void use();
 
+    // 不阻塞地查询链接是否完成；驱动不支持并行编译时总是返回true
+    bool isReady() const;
+    // 等待链接完成，检查错误，成功时写入二进制缓存
+    void finishLink();
+    bool isFromBinaryCache() const { return fromBinaryCache; }
+
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
+    void setUInt(const std::string& name, unsigned int value) const;
     void setFloat(const std::string& name, float value) const;
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
+    // 位置来自链接时建立的反射表，不调用glGetUniformLocation
+    template <typename T>
+    Uniform<T> getUniform(const std::string& name) {
+        finishLink();
+        Uniform<T> uniform;
+        uniform.location = findUniform(name);
+        return uniform;
+    }
+
+    // 作用于当前使用的程序
+    void set(Uniform<bool> uniform, bool value) const;
+    void set(Uniform<int> uniform, int value) const;
+    void set(Uniform<unsigned int> uniform, unsigned int value) const;
+    void set(Uniform<float> uniform, float value) const;
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const;
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& value) const;
+
+    // 把名为blockName的uniform块连接到绑定点binding，程序中没有该块时忽略
+    void bindUniformBlock(const char* blockName, GLuint binding);
+
 private:
-    void checkCompileErrors(unsigned int shader, std::string type);
+    struct Stage {
+        GLenum type;
+        const char* path;
+    };
+
+    void build(const Stage* stages, int stageCount, const char* const* feedbackVaryings, int varyingCount);
+    bool loadBinary();
+    void saveBinary() const;
+
+    static std::string readFile(const char* path);
+    bool checkCompileErrors(unsigned int shader, std::string type);
+    // 链接后枚举全部激活的uniform，记录名字到位置的映射；uniform块的成员没有位置，不记录
+    void reflectUniforms();
+    GLint findUniform(const std::string& name) const;
+
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    uint64_t cacheKey;
+    bool fromBinaryCache;
+    bool linkPending;
+    // 等待链接结果时需要检查编译日志的着色器对象
+    GLuint pendingShaders[2];
+    GLenum pendingTypes[2];
+    int pendingCount;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef SPATIAL_HASH_GRID_H
+#define SPATIAL_HASH_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "thread_pool.h"
+
+struct ParticleStore;
+
+// 均匀网格空间哈希：每步用计数排序把存活的正常粒子按哈希桶重排，
+// 桶下标 -> 粒子区间；邻居查询只访问周围27个单元格，整体线性时间。
+// 不同单元格可能落入同一个桶，查询时用单元格坐标区分。
+class SpatialHashGrid {
+public:
+    void build(const ParticleStore& particles, float cellSize, ThreadPool& pool);
+
+    // 对(x, y, z)半径radius内的每个粒子调用f(k, dx, dy, dz, distSq)，
+    // k为排序后的下标，d为邻居相对查询点的位移。radius不能超过cellSize
+    template <typename F>
+    void forEachNeighbor(float x, float y, float z, float radius, F&& f) const;
+
+    size_t getCount() const { return particleIndex.size(); }
+    float getCellSize() const { return cellSize; }
+
+    // 排序后的粒子数据，连续存放以便邻居遍历
+    uint32_t getParticleIndex(size_t k) const { return particleIndex[k]; }
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;
+
+private:
+    static uint64_t packCell(int32_t ix, int32_t iy, int32_t iz) {
+        // 每轴21位，足以覆盖模拟范围
+        const uint64_t mask = (1u << 21) - 1;
+        return ((static_cast<uint64_t>(ix) & mask) << 42) | ((static_cast<uint64_t>(iy) & mask) << 21)
+            | (static_cast<uint64_t>(iz) & mask);
+    }
+
+    uint32_t bucketOf(int32_t ix, int32_t iy, int32_t iz) const {
+        uint32_t h = (static_cast<uint32_t>(ix) * 73856093u) ^ (static_cast<uint32_t>(iy) * 19349663u)
+            ^ (static_cast<uint32_t>(iz) * 83492791u);
+        return h & bucketMask;
+    }
+
+    int32_t cellCoord(float v) const;
+
+    float cellSize = 1.0f;
+    float inverseCellSize = 1.0f;
+    uint32_t bucketMask = 0;
+
+    std::vector<uint32_t> bucketStart; // 大小为桶数+1
+    std::vector<uint32_t> particleIndex;
+    std::vector<uint64_t> cellKeys;     // 排序后每个粒子所在单元格
+
+    // 构建时的临时数据
+    std::vector<uint32_t> unsortedIndex;
+    std::vector<uint32_t> unsortedBucket;
+    std::vector<uint64_t> unsortedCell;
+};
+
+template <typename F>
+void SpatialHashGrid::forEachNeighbor(float x, float y, float z, float radius, F&& f) const {
+    if (particleIndex.empty()) {
+        return;
+    }
+
+    const float radiusSq = radius * radius;
+    const int32_t cx = cellCoord(x), cy = cellCoord(y), cz = cellCoord(z);
+
+    for (int32_t dz = -1; dz <= 1; ++dz) {
+        for (int32_t dy = -1; dy <= 1; ++dy) {
+            for (int32_t dx = -1; dx <= 1; ++dx) {
+                const uint64_t cell = packCell(cx + dx, cy + dy, cz + dz);
+                const uint32_t bucket = bucketOf(cx + dx, cy + dy, cz + dz);
+
+                for (uint32_t k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k) {
+                    if (cellKeys[k] != cell) {
+                        continue;
+                    }
+                    const float rx = posX[k] - x;
+                    const float ry = posY[k] - y;
+                    const float rz = posZ[k] - z;
+                    const float distSq = rx * rx + ry * ry + rz * rz;
+                    if (distSq < radiusSq) {
+                        f(k, rx, ry, rz, distSq);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
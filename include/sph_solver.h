@@ -0,0 +1,38 @@
+#ifndef SPH_SOLVER_H
+#define SPH_SOLVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "spatial_hash_grid.h"
+#include "thread_pool.h"
+
+struct SphSettings {
+    float particleMass;
+    float smoothingLength;  // h，同时作为网格单元格边长
+    float restDensity;
+    float stiffness;        // 压强 = stiffness * (密度 - restDensity)，只取排斥部分
+    float viscosity;
+};
+
+// SPH风格的吸积盘压强与黏性（Müller 2003的poly6/spiky/黏性核）。
+// 两趟遍历网格：先求密度与压强，再求加速度；每个粒子的邻居按网格顺序求和，结果确定。
+class SphSolver {
+public:
+    // 把压强与黏性加速度累加到以原粒子下标索引的accel数组中。
+    // skipTargets非空时，其中非零的粒子只参与密度计算、作为邻居出现，不累加自身的加速度
+    void addAccelerations(const SpatialHashGrid& grid, const SphSettings& settings, ThreadPool& pool,
+        std::vector<float>& accelX, std::vector<float>& accelY, std::vector<float>& accelZ,
+        const uint8_t* skipTargets);
+
+    // 最近一次的平均邻居数（含自身）
+    double getAverageNeighbors() const { return averageNeighbors; }
+
+private:
+    std::vector<float> density;
+    std::vector<float> pressure;
+    std::vector<unsigned> neighborCounts;
+    double averageNeighbors = 0.0;
+};
+
+#endif
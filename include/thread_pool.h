@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 分块并行for：区间被切成固定大小的块，各线程通过原子计数器动态领取，
+// 先做完的线程会继续领取剩余的块，负载不均时自动平衡。
+class ThreadPool {
+public:
+    // body(chunkBegin, chunkEnd, workerIndex)，workerIndex范围[0, getThreadCount())
+    using ChunkFunction = std::function<void(size_t, size_t, int)>;
+
+    // threadCount包含调用线程本身，1表示完全在调用线程上执行
+    explicit ThreadPool(int threadCount = 1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void setThreadCount(int threadCount);
+    int getThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    // 阻塞直到所有块执行完毕，调用线程作为0号线程参与
+    void parallelFor(size_t begin, size_t end, size_t chunkSize, const ChunkFunction& body);
+
+    static int getHardwareThreadCount();
+
+private:
+    void startWorkers(int workerCount);
+    void stopWorkers();
+    void workerLoop(int workerIndex, unsigned long long seenGeneration);
+    void runChunks(int workerIndex);
+
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    bool stopping;
+    unsigned long long generation;
+    int activeWorkers;
+
+    // 当前任务
+    const ChunkFunction* job;
+    size_t jobBegin;
+    size_t jobEnd;
+    size_t jobChunkSize;
+    std::atomic<size_t> nextChunk;
+};
+
+#endif
@@ -1,7 +1,18 @@
 #version 330 core
 out vec4 FragColor;
 
-uniform vec3 viewPos;
+// 每帧参数，布局与frame_uniforms.h中的FrameUniforms一致
+layout(std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float lightIntensity;
+    vec3 lightColor;
+    float colorIntensity;
+    vec3 lightPos;
+    int directionalLight;
+    vec3 lightDir;
+};
 
 void main() {
     vec2 coord = gl_PointCoord - vec2(0.5);
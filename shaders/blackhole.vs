@@ -1,8 +1,18 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+// 每帧参数，布局与frame_uniforms.h中的FrameUniforms一致
+layout(std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float lightIntensity;
+    vec3 lightColor;
+    float colorIntensity;
+    vec3 lightPos;
+    int directionalLight;
+    vec3 lightDir;
+};
 
 void main() {
     gl_Position = projection * view * vec4(aPos, 1.0);
@@ -5,18 +5,23 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec3 Color;
 
-uniform vec3 viewPos;
-uniform vec3 lightColor;
-uniform float lightIntensity;
-uniform vec3 lightPos;
-uniform vec3 lightDir;
-uniform bool directionalLight;
-uniform float colorIntensity;
+// 每帧参数，布局与frame_uniforms.h中的FrameUniforms一致
+layout(std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float lightIntensity;
+    vec3 lightColor;
+    float colorIntensity;
+    vec3 lightPos;
+    int directionalLight;
+    vec3 lightDir;
+};
 
 void main() {
     vec3 norm = normalize(Normal);
     vec3 lightDirCalc;
-    if (directionalLight) {
+    if (directionalLight != 0) {
         lightDirCalc = normalize(-lightDir);
     } else {
         lightDirCalc = normalize(lightPos - FragPos);
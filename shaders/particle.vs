@@ -9,8 +9,18 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec3 Color;
 
-uniform mat4 projection;
-uniform mat4 view;
+// 每帧参数，布局与frame_uniforms.h中的FrameUniforms一致
+layout(std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float lightIntensity;
+    vec3 lightColor;
+    float colorIntensity;
+    vec3 lightPos;
+    int directionalLight;
+    vec3 lightDir;
+};
 
 void main() {
     vec3 worldPos = instancePos + aPos * instanceSize;
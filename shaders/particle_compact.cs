@@ -0,0 +1,87 @@
+#version 430 core
+// 存活粒子压缩：三趟前缀和，把life > 0的粒子按原顺序写入紧凑实例缓冲，
+// 并把存活数量写入间接绘制命令的instanceCount
+// 第0趟：工作组内扫描；第1趟：单个工作组扫描各组总数；第2趟：散射写出
+layout (local_size_x = 256) in;
+
+// GpuParticleState：每个粒子12个float（位置3、速度3、颜色3、寿命、大小、类型）
+layout (std430, binding = 0) readonly buffer ParticleStates { float states[]; };
+// ParticleInstance：每个实例7个float（位置3、颜色3、大小）
+layout (std430, binding = 1) writeonly buffer CompactInstances { float instances[]; };
+layout (std430, binding = 2) buffer LocalOffsets { uint localOffsets[]; };
+layout (std430, binding = 3) buffer GroupOffsets { uint groupOffsets[]; };
+// DrawElementsIndirectCommand / DrawArraysIndirectCommand，instanceCount都在下标1
+layout (std430, binding = 4) buffer DrawCommand { uint command[5]; };
+
+uniform int compactPass;
+uniform uint particleCount;
+uniform uint groupCount;
+
+shared uint scan[256];
+
+// Hillis-Steele包含式扫描，返回本线程的包含前缀和
+uint inclusiveScan(uint value) {
+    uint lane = gl_LocalInvocationID.x;
+    scan[lane] = value;
+    barrier();
+    for (uint stride = 1u; stride < 256u; stride <<= 1) {
+        uint addend = lane >= stride ? scan[lane - stride] : 0u;
+        barrier();
+        scan[lane] += addend;
+        barrier();
+    }
+    return scan[lane];
+}
+
+bool isLive(uint i) {
+    return i < particleCount && states[i * 12u + 9u] > 0.0;
+}
+
+void main() {
+    uint lane = gl_LocalInvocationID.x;
+
+    if (compactPass == 0) {
+        uint i = gl_GlobalInvocationID.x;
+        uint live = isLive(i) ? 1u : 0u;
+        uint inclusive = inclusiveScan(live);
+        if (i < particleCount) {
+            localOffsets[i] = inclusive - live;
+        }
+        if (lane == 255u) {
+            groupOffsets[gl_WorkGroupID.x] = inclusive;
+        }
+    }
+    else if (compactPass == 1) {
+        // 只派发一个工作组，按256组一块依次扫描并累加进位
+        uint carry = 0u;
+        for (uint base = 0u; base < groupCount; base += 256u) {
+            uint g = base + lane;
+            uint total = g < groupCount ? groupOffsets[g] : 0u;
+            uint inclusive = inclusiveScan(total);
+            if (g < groupCount) {
+                groupOffsets[g] = carry + inclusive - total;
+            }
+            carry += scan[255];
+            barrier();
+        }
+        if (lane == 0u) {
+            command[1] = carry;
+        }
+    }
+    else {
+        uint i = gl_GlobalInvocationID.x;
+        if (!isLive(i)) {
+            return;
+        }
+
+        uint dst = (groupOffsets[gl_WorkGroupID.x] + localOffsets[i]) * 7u;
+        uint src = i * 12u;
+        instances[dst + 0u] = states[src + 0u];
+        instances[dst + 1u] = states[src + 1u];
+        instances[dst + 2u] = states[src + 2u];
+        instances[dst + 3u] = states[src + 6u];
+        instances[dst + 4u] = states[src + 7u];
+        instances[dst + 5u] = states[src + 8u];
+        instances[dst + 6u] = states[src + 10u];
+    }
+}
@@ -0,0 +1,68 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+flat in vec3 Center;
+flat in float Radius;
+in vec3 Color;
+
+// 每帧参数，布局与frame_uniforms.h中的FrameUniforms一致
+layout(std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float lightIntensity;
+    vec3 lightColor;
+    float colorIntensity;
+    vec3 lightPos;
+    int directionalLight;
+    vec3 lightDir;
+};
+
+void main() {
+    // 视线与球体求交，未命中的像素位于球体轮廓之外
+    vec3 rayDir = normalize(FragPos - viewPos);
+    vec3 oc = viewPos - Center;
+    float b = dot(oc, rayDir);
+    float c = dot(oc, oc) - Radius * Radius;
+    float h = b * b - c;
+    if (h < 0.0) {
+        discard;
+    }
+
+    vec3 hitPos = viewPos + rayDir * (-b - sqrt(h));
+    vec3 norm = (hitPos - Center) / Radius;
+
+    vec3 lightDirCalc;
+    if (directionalLight != 0) {
+        lightDirCalc = normalize(-lightDir);
+    } else {
+        lightDirCalc = normalize(lightPos - hitPos);
+    }
+
+    // 光照与particle.fs相同
+    float ambientStrength = 0.3;
+    vec3 ambient = ambientStrength * lightColor;
+
+    float diff = max(dot(norm, lightDirCalc), 0.0);
+    vec3 diffuse = diff * lightColor;
+
+    float specularStrength = 0.8;
+    vec3 viewDir = normalize(viewPos - hitPos);
+    vec3 reflectDir = reflect(-lightDirCalc, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec3 specular = specularStrength * spec * lightColor;
+
+    vec3 result = (ambient + diffuse + specular) * Color * lightIntensity * colorIntensity;
+
+    float glow = 0.5;
+    vec3 glowColor = Color * glow;
+    result += glowColor;
+
+    FragColor = vec4(result, 1.0);
+
+    // 写入球面上的真实深度，保证与网格粒子和黑洞正确遮挡
+    vec4 clipPos = projection * view * vec4(hitPos, 1.0);
+    float ndcDepth = clipPos.z / clipPos.w;
+    gl_FragDepth = (gl_DepthRange.diff * ndcDepth + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+}
@@ -0,0 +1,53 @@
+#version 330 core
+// 每个粒子一个始终朝向相机的四边形，球体在片段着色器中通过光线求交重建
+layout (location = 2) in vec3 instancePos;
+layout (location = 3) in vec3 instanceColor;
+layout (location = 4) in float instanceSize;
+
+out vec3 FragPos;
+flat out vec3 Center;
+flat out float Radius;
+out vec3 Color;
+
+// 每帧参数，布局与frame_uniforms.h中的FrameUniforms一致
+layout(std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float lightIntensity;
+    vec3 lightColor;
+    float colorIntensity;
+    vec3 lightPos;
+    int directionalLight;
+    vec3 lightDir;
+};
+
+void main() {
+    // 三角形带的四个角：(-1,-1) (1,-1) (-1,1) (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    vec3 toCenter = instancePos - viewPos;
+    float dist = length(toCenter);
+    vec3 dir = toCenter / dist;
+
+    // 四边形垂直于视线，用相机的上方向确定朝向
+    vec3 cameraUp = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 right = cross(dir, cameraUp);
+    if (dot(right, right) < 1e-6) {
+        right = cross(dir, vec3(1.0, 0.0, 0.0));
+    }
+    right = normalize(right);
+    vec3 up = cross(right, dir);
+
+    // 透视下球体轮廓在过球心平面上的半径为 r*d/sqrt(d^2-r^2)
+    float radius = instanceSize;
+    float extent = radius * dist / sqrt(max(dist * dist - radius * radius, 1e-6));
+
+    FragPos = instancePos + (right * corner.x + up * corner.y) * extent;
+    Center = instancePos;
+    Radius = radius;
+    Color = instanceColor;
+
+    // 相机位于球内时丢弃整个四边形
+    gl_Position = dist > radius ? projection * view * vec4(FragPos, 1.0) : vec4(0.0, 0.0, 0.0, 0.0);
+}
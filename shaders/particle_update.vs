@@ -0,0 +1,212 @@
+#version 330 core
+// GPU端粒子积分：每个顶点一个粒子，结果通过变换反馈写入另一个缓冲
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inVelocity;
+layout (location = 2) in vec3 inColor;
+layout (location = 3) in float inLife;
+layout (location = 4) in float inSize;
+layout (location = 5) in float inType;
+
+out vec3 outPosition;
+out vec3 outVelocity;
+out vec3 outColor;
+out float outLife;
+out float outSize;
+out float outType;
+
+uniform float deltaTime;
+uniform int leapfrog;
+uniform float blackHoleMass;
+uniform float particleLifetime;
+uniform float spiralStrength;
+uniform float turbulenceStrength;
+uniform float accretionDiskRadius;
+uniform float particleSize;
+
+uniform uint seed;
+uniform uint stepIndex;
+
+// 本步要生成的爆炸与喷流粒子数，只占用空闲槽位：按下标排在第k个的空闲槽位，
+// k < explosionCount时成为爆炸粒子，其后jetCount个成为喷流粒子，空闲槽位不足时少生成
+uniform int jetCount;
+uniform float jetAngle;
+uniform vec3 jetDirection;
+uniform float jetParticleSpeed;
+
+uniform int explosionCount;
+uniform float explosionStrength;
+
+// 存活粒子压缩第0、1趟的结果：组内与组间的存活数排他前缀和，
+// 槽位之前的空闲槽位数 = 槽位下标 - 之前的存活粒子数
+uniform usamplerBuffer liveOffsets;
+uniform usamplerBuffer groupLiveOffsets;
+const int CompactGroupSize = 256;
+
+const float PI = 3.14159265358979323846;
+
+uint rngState;
+
+uint pcgHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float nextFloat() {
+    rngState = pcgHash(rngState);
+    return float(rngState >> 8u) * (1.0 / 16777216.0);
+}
+
+int freeSlotRank(int id) {
+    uint liveBefore = texelFetch(groupLiveOffsets, id / CompactGroupSize).r + texelFetch(liveOffsets, id).r;
+    return id - int(liveBefore);
+}
+
+// 在吸积盘平面内随机位置，与ParticleSimulation::resetParticle一致
+void resetParticle() {
+    float angle = nextFloat() * 2.0 * PI;
+    float radius = 5.0 + nextFloat() * accretionDiskRadius;
+    float height = (nextFloat() - 0.5) * 2.0;
+
+    outPosition = vec3(cos(angle) * radius, height, sin(angle) * radius);
+
+    float orbitalSpeed = sqrt(blackHoleMass / radius) * 0.8;
+    vec3 tangent = normalize(vec3(-sin(angle), 0.0, cos(angle)));
+    vec3 radialDir = normalize(-outPosition);
+
+    outVelocity = tangent * orbitalSpeed + radialDir * (0.1 + nextFloat() * 0.3);
+    outVelocity.y += (nextFloat() - 0.5) * 0.5;
+
+    outLife = particleLifetime * (0.8 + nextFloat() * 0.4);
+    outSize = particleSize * (0.5 + nextFloat());
+
+    float colorFactor = length(outVelocity) / 10.0;
+    outColor = vec3(
+        0.3 + (0.5 + nextFloat() * 0.5) * 0.7 * colorFactor,
+        0.3 + (0.5 + nextFloat() * 0.5) * 0.5 * colorFactor,
+        1.0);
+    outType = 0.0;
+}
+
+void spawnJet() {
+    float angle = radians(jetAngle);
+    float randomAngle = nextFloat() * angle;
+    float randomRotation = nextFloat() * 2.0 * PI;
+
+    // 绕水平轴旋转喷流方向（Rodrigues公式）
+    vec3 axis = vec3(cos(randomRotation), 0.0, sin(randomRotation));
+    vec3 dir = jetDirection * cos(randomAngle)
+        + cross(axis, jetDirection) * sin(randomAngle)
+        + axis * dot(axis, jetDirection) * (1.0 - cos(randomAngle));
+
+    outPosition = vec3(0.0);
+    outVelocity = dir * jetParticleSpeed;
+    outLife = 2.0;
+    outSize = particleSize * 0.3;
+    outColor = vec3(1.0, 0.8, 0.2);
+    outType = 1.0;
+}
+
+void spawnExplosion() {
+    float theta = nextFloat() * 2.0 * PI;
+    float phi = acos(2.0 * nextFloat() - 1.0);
+
+    outPosition = vec3(0.0);
+    outVelocity = vec3(sin(phi) * cos(theta), sin(phi) * sin(theta), cos(phi))
+        * explosionStrength * (0.8 + nextFloat() * 0.4);
+    outLife = 3.0;
+    outSize = particleSize * (0.8 + nextFloat() * 0.4);
+    outColor = vec3(1.0, 0.5, 0.1);
+    outType = 2.0;
+}
+
+void main() {
+    rngState = pcgHash(uint(gl_VertexID) ^ pcgHash(stepIndex ^ pcgHash(seed)));
+
+    outPosition = inPosition;
+    outVelocity = inVelocity;
+    outColor = inColor;
+    outLife = inLife;
+    outSize = inSize;
+    outType = inType;
+
+    int type = int(inType + 0.5);
+
+    if (inLife <= 0.0) {
+        // 空闲槽位：上一步死亡的正常粒子与寿命耗尽的特效粒子
+        if (explosionCount + jetCount > 0) {
+            int rank = freeSlotRank(gl_VertexID);
+            if (rank < explosionCount) {
+                spawnExplosion();
+                return;
+            }
+            if (rank < explosionCount + jetCount) {
+                spawnJet();
+                return;
+            }
+        }
+        // 没有被领取的正常粒子回到吸积盘，特效粒子保持空闲
+        if (type == 0) {
+            resetParticle();
+        }
+        return;
+    }
+
+    // 蛙跳：先用旧速度漂移半步，之后的受力都在半步位置处计算
+    float halfDt = 0.5 * deltaTime;
+    vec3 position = leapfrog != 0 ? inPosition + inVelocity * halfDt : inPosition;
+    float distSq = dot(position, position);
+    float dist = sqrt(distSq);
+
+    if (type == 0 && dist < 0.5) {
+        // 粒子被黑洞吞噬
+        outLife = 0.0;
+        return;
+    }
+
+    vec3 gravityDir = -position / dist;
+
+    // 牛顿引力 + 相对论经验修正
+    float gravity = blackHoleMass / distSq;
+    float relFactor = 1.0 + 2.0 / (dist + 0.5);
+
+    // 螺旋吸积效应
+    vec3 spiralForce = cross(gravityDir, vec3(0.0, 1.0, 0.0)) * spiralStrength;
+
+    // 湍流效应
+    vec3 turbulence = (vec3(nextFloat(), nextFloat(), nextFloat()) - 0.5) * 2.0 * turbulenceStrength;
+
+    vec3 velocity = inVelocity;
+    if (type == 0) {
+        velocity += (gravityDir * gravity * relFactor + spiralForce + turbulence) * deltaTime;
+    }
+
+    // 速度限制
+    float speed = length(velocity);
+    if (speed > 100.0) {
+        velocity *= 100.0 / speed;
+    }
+
+    outVelocity = velocity;
+    outPosition = position + velocity * (leapfrog != 0 ? halfDt : deltaTime);
+
+    if (type == 0) {
+        // 正常粒子受潮汐力影响
+        outLife = inLife - deltaTime * (1.0 + 5.0 / (distSq + 0.1));
+
+        float speedFactor = length(velocity) / 50.0;
+        float energyRelease = 1.0 / (dist + 0.5);
+        outColor = vec3(0.5 + energyRelease * 0.5, 0.3 + speedFactor * 0.5, 1.0 - energyRelease * 0.3);
+    }
+    else if (type == 1) {
+        outLife = inLife - deltaTime;
+        outColor = vec3(1.0, 0.8, 0.2);
+    }
+    else {
+        outLife = inLife - deltaTime;
+        float lifeRatio = outLife / 3.0;
+        outColor = vec3(1.0, 0.5 * lifeRatio, 0.1 * lifeRatio);
+    }
+
+    outColor = clamp(outColor, 0.0, 1.0);
+}
@@ -0,0 +1,323 @@
+#include "barnes_hut.h"
+#include "particle_simulation.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // 每轴10位，Morton码共30位
+    const int MortonBits = 10;
+    const int MaxLevel = MortonBits;
+    // 深度2共64个单元格，作为并行建树的任务
+    const int SubtreeLevel = 2;
+    const int SubtreeCount = 64;
+
+    uint32_t expandBits(uint32_t v) {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    // 位序为 ...x y z，八分体编号o的x/y/z位分别是第2/1/0位
+    uint32_t mortonCode(uint32_t x, uint32_t y, uint32_t z) {
+        return (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+    }
+
+    uint32_t octantAt(uint32_t code, int level) {
+        return (code >> (3 * (MaxLevel - 1 - level))) & 7u;
+    }
+
+    // 以code前缀的下界定位Morton排序数组中的区间
+    size_t lowerBound(const std::vector<uint32_t>& codes, size_t begin, size_t end, uint32_t code) {
+        return std::lower_bound(codes.begin() + begin, codes.begin() + end, code) - codes.begin();
+    }
+}
+
+void BarnesHutTree::build(const ParticleStore& particles, float mass, ThreadPool& pool) {
+    particleCount = particles.count();
+    bodyMass = mass;
+    nodes.clear();
+
+    // 收集质点并求包围盒
+    bodyIndex.clear();
+    float minX = 0.0f, minY = 0.0f, minZ = 0.0f;
+    float maxX = 0.0f, maxY = 0.0f, maxZ = 0.0f;
+    for (size_t i = 0; i < particleCount; ++i) {
+        if (particles.type[i] != 0 || particles.life[i] <= 0.0f) {
+            continue;
+        }
+        float x = particles.posX[i], y = particles.posY[i], z = particles.posZ[i];
+        if (bodyIndex.empty()) {
+            minX = maxX = x; minY = maxY = y; minZ = maxZ = z;
+        }
+        minX = std::min(minX, x); maxX = std::max(maxX, x);
+        minY = std::min(minY, y); maxY = std::max(maxY, y);
+        minZ = std::min(minZ, z); maxZ = std::max(maxZ, z);
+        bodyIndex.push_back(static_cast<uint32_t>(i));
+    }
+
+    const size_t bodyCount = bodyIndex.size();
+    if (bodyCount == 0) {
+        return;
+    }
+
+    // 立方体根单元格，略微放大保证最大坐标量化后仍在范围内
+    const float side = std::max(std::max(maxX - minX, maxY - minY), std::max(maxZ - minZ, 1e-3f)) * 1.001f;
+    const float scale = static_cast<float>(1 << MortonBits) / side;
+    const uint32_t maxCell = (1u << MortonBits) - 1;
+
+    sortKeys.resize(bodyCount);
+    pool.parallelFor(0, bodyCount, 4096, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = bodyIndex[k];
+            uint32_t qx = std::min(static_cast<uint32_t>((particles.posX[i] - minX) * scale), maxCell);
+            uint32_t qy = std::min(static_cast<uint32_t>((particles.posY[i] - minY) * scale), maxCell);
+            uint32_t qz = std::min(static_cast<uint32_t>((particles.posZ[i] - minZ) * scale), maxCell);
+            sortKeys[k] = (static_cast<uint64_t>(mortonCode(qx, qy, qz)) << 32) | i;
+        }
+    });
+
+    // LSD基数排序，每趟10位，共三趟覆盖30位Morton码；稳定排序保证结果确定
+    sortScratch.resize(bodyCount);
+    for (int pass = 0; pass < 3; ++pass) {
+        const int shift = 32 + pass * 10;
+        size_t counts[1025] = {};
+        for (uint64_t key : sortKeys) {
+            ++counts[((key >> shift) & 1023u) + 1];
+        }
+        for (int b = 0; b < 1024; ++b) {
+            counts[b + 1] += counts[b];
+        }
+        for (uint64_t key : sortKeys) {
+            sortScratch[counts[(key >> shift) & 1023u]++] = key;
+        }
+        sortKeys.swap(sortScratch);
+    }
+
+    mortonCodes.resize(bodyCount);
+    bodyX.resize(bodyCount);
+    bodyY.resize(bodyCount);
+    bodyZ.resize(bodyCount);
+    pool.parallelFor(0, bodyCount, 4096, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = static_cast<uint32_t>(sortKeys[k]);
+            mortonCodes[k] = static_cast<uint32_t>(sortKeys[k] >> 32);
+            bodyIndex[k] = i;
+            bodyX[k] = particles.posX[i];
+            bodyY[k] = particles.posY[i];
+            bodyZ[k] = particles.posZ[i];
+        }
+    });
+
+    // 深度2的64个单元格在Morton数组中各占一段连续区间，互不相交，可以并行建子树
+    const int subtreeShift = 3 * (MaxLevel - SubtreeLevel);
+    subtrees.resize(SubtreeCount);
+    pool.parallelFor(0, SubtreeCount, 1, [&](size_t begin, size_t end, int) {
+        for (size_t t = begin; t < end; ++t) {
+            std::vector<BarnesHutNode>& out = subtrees[t];
+            out.clear();
+
+            size_t rangeBegin = lowerBound(mortonCodes, 0, bodyCount, static_cast<uint32_t>(t) << subtreeShift);
+            size_t rangeEnd = lowerBound(mortonCodes, rangeBegin, bodyCount, static_cast<uint32_t>(t + 1) << subtreeShift);
+            if (rangeBegin == rangeEnd) {
+                continue;
+            }
+
+            const uint32_t o1 = static_cast<uint32_t>(t) >> 3, o2 = static_cast<uint32_t>(t) & 7u;
+            float cellX = minX + ((o1 >> 2) & 1u) * side * 0.5f + ((o2 >> 2) & 1u) * side * 0.25f;
+            float cellY = minY + ((o1 >> 1) & 1u) * side * 0.5f + ((o2 >> 1) & 1u) * side * 0.25f;
+            float cellZ = minZ + (o1 & 1u) * side * 0.5f + (o2 & 1u) * side * 0.25f;
+            buildSubtree(rangeBegin, rangeEnd, SubtreeLevel, cellX, cellY, cellZ, side * 0.25f, out);
+        }
+    });
+
+    // 按深度优先顺序拼接：根节点、深度1节点及其下的子树，子树内的next加上拼接偏移
+    BarnesHutNode root = {};
+    root.size = side;
+    root.bodyBegin = 0;
+    root.bodyEnd = static_cast<uint32_t>(bodyCount);
+    nodes.push_back(root);
+
+    double rootX = 0.0, rootY = 0.0, rootZ = 0.0, rootMass = 0.0;
+    for (int o1 = 0; o1 < 8; ++o1) {
+        const size_t levelOneIndex = nodes.size();
+        double sumX = 0.0, sumY = 0.0, sumZ = 0.0, sumMass = 0.0;
+
+        for (int o2 = 0; o2 < 8; ++o2) {
+            const std::vector<BarnesHutNode>& sub = subtrees[o1 * 8 + o2];
+            if (sub.empty()) {
+                continue;
+            }
+
+            if (nodes.size() == levelOneIndex) {
+                BarnesHutNode levelOne = {};
+                levelOne.size = side * 0.5f;
+                levelOne.bodyBegin = sub[0].bodyBegin;
+                nodes.push_back(levelOne);
+            }
+
+            const uint32_t offset = static_cast<uint32_t>(nodes.size());
+            for (BarnesHutNode node : sub) {
+                node.next += offset;
+                nodes.push_back(node);
+            }
+
+            const BarnesHutNode& subRoot = sub[0];
+            sumX += static_cast<double>(subRoot.comX) * subRoot.mass;
+            sumY += static_cast<double>(subRoot.comY) * subRoot.mass;
+            sumZ += static_cast<double>(subRoot.comZ) * subRoot.mass;
+            sumMass += subRoot.mass;
+            nodes[levelOneIndex].bodyEnd = subRoot.bodyEnd;
+        }
+
+        if (nodes.size() == levelOneIndex) {
+            continue;
+        }
+
+        BarnesHutNode& levelOne = nodes[levelOneIndex];
+        levelOne.next = static_cast<uint32_t>(nodes.size());
+        levelOne.mass = static_cast<float>(sumMass);
+        levelOne.comX = static_cast<float>(sumX / sumMass);
+        levelOne.comY = static_cast<float>(sumY / sumMass);
+        levelOne.comZ = static_cast<float>(sumZ / sumMass);
+
+        rootX += sumX; rootY += sumY; rootZ += sumZ;
+        rootMass += sumMass;
+    }
+
+    nodes[0].next = static_cast<uint32_t>(nodes.size());
+    nodes[0].mass = static_cast<float>(rootMass);
+    nodes[0].comX = static_cast<float>(rootX / rootMass);
+    nodes[0].comY = static_cast<float>(rootY / rootMass);
+    nodes[0].comZ = static_cast<float>(rootZ / rootMass);
+}
+
+void BarnesHutTree::buildSubtree(size_t begin, size_t end, int level, float minX, float minY, float minZ,
+    float size, std::vector<BarnesHutNode>& out) const {
+    const size_t self = out.size();
+    BarnesHutNode node = {};
+    node.size = size;
+    node.bodyBegin = static_cast<uint32_t>(begin);
+    node.bodyEnd = static_cast<uint32_t>(end);
+    out.push_back(node);
+
+    double sumX = 0.0, sumY = 0.0, sumZ = 0.0, sumMass = 0.0;
+
+    if (end - begin <= static_cast<size_t>(LeafSize) || level >= MaxLevel) {
+        for (size_t k = begin; k < end; ++k) {
+            sumX += bodyX[k];
+            sumY += bodyY[k];
+            sumZ += bodyZ[k];
+        }
+        sumMass = static_cast<double>(end - begin);
+        sumX *= bodyMass; sumY *= bodyMass; sumZ *= bodyMass;
+        sumMass *= bodyMass;
+    }
+    else {
+        // 区间内的质点共享更高位的前缀，按本层的3位有序，逐个八分体切分
+        const float half = size * 0.5f;
+        size_t childBegin = begin;
+        for (uint32_t octant = 0; octant < 8 && childBegin < end; ++octant) {
+            size_t childEnd = childBegin;
+            while (childEnd < end && octantAt(mortonCodes[childEnd], level) == octant) {
+                ++childEnd;
+            }
+            if (childEnd == childBegin) {
+                continue;
+            }
+
+            const size_t child = out.size();
+            buildSubtree(childBegin, childEnd, level + 1,
+                minX + ((octant >> 2) & 1u) * half,
+                minY + ((octant >> 1) & 1u) * half,
+                minZ + (octant & 1u) * half,
+                half, out);
+
+            const BarnesHutNode& childNode = out[child];
+            sumX += static_cast<double>(childNode.comX) * childNode.mass;
+            sumY += static_cast<double>(childNode.comY) * childNode.mass;
+            sumZ += static_cast<double>(childNode.comZ) * childNode.mass;
+            sumMass += childNode.mass;
+
+            childBegin = childEnd;
+        }
+    }
+
+    BarnesHutNode& result = out[self];
+    result.next = static_cast<uint32_t>(out.size());
+    result.mass = static_cast<float>(sumMass);
+    result.comX = static_cast<float>(sumX / sumMass);
+    result.comY = static_cast<float>(sumY / sumMass);
+    result.comZ = static_cast<float>(sumZ / sumMass);
+}
+
+void BarnesHutTree::computeAccelerations(float theta, float softening, ThreadPool& pool,
+    std::vector<float>& accelX, std::vector<float>& accelY, std::vector<float>& accelZ,
+    const uint8_t* skipTargets) const {
+    accelX.assign(particleCount, 0.0f);
+    accelY.assign(particleCount, 0.0f);
+    accelZ.assign(particleCount, 0.0f);
+
+    const size_t bodyCount = bodyIndex.size();
+    if (bodyCount == 0) {
+        return;
+    }
+
+    const float thetaSq = theta * theta;
+    const float softeningSq = softening * softening;
+    const uint32_t nodeCount = static_cast<uint32_t>(nodes.size());
+    const BarnesHutNode* tree = nodes.data();
+
+    // 按Morton顺序遍历，相邻质点访问的节点大体相同，缓存命中率高
+    pool.parallelFor(0, bodyCount, 1024, [&](size_t begin, size_t end, int) {
+        for (size_t s = begin; s < end; ++s) {
+            if (skipTargets && skipTargets[bodyIndex[s]]) {
+                continue;
+            }
+            const float px = bodyX[s], py = bodyY[s], pz = bodyZ[s];
+            float ax = 0.0f, ay = 0.0f, az = 0.0f;
+
+            uint32_t n = 0;
+            while (n < nodeCount) {
+                const BarnesHutNode& node = tree[n];
+                const float dx = node.comX - px;
+                const float dy = node.comY - py;
+                const float dz = node.comZ - pz;
+                const float distSq = dx * dx + dy * dy + dz * dz;
+                const bool containsSelf = s >= node.bodyBegin && s < node.bodyEnd;
+
+                if (!containsSelf && node.size * node.size < thetaSq * distSq) {
+                    // 足够远：整个节点视为位于质心的单个质点
+                    const float invDist = 1.0f / std::sqrt(distSq + softeningSq);
+                    const float f = node.mass * invDist * invDist * invDist;
+                    ax += dx * f; ay += dy * f; az += dz * f;
+                    n = node.next;
+                }
+                else if (node.next == n + 1) {
+                    // 叶节点：逐个质点直接求和
+                    for (uint32_t k = node.bodyBegin; k < node.bodyEnd; ++k) {
+                        if (k == s) {
+                            continue;
+                        }
+                        const float bx = bodyX[k] - px;
+                        const float by = bodyY[k] - py;
+                        const float bz = bodyZ[k] - pz;
+                        const float invDist = 1.0f / std::sqrt(bx * bx + by * by + bz * bz + softeningSq);
+                        const float f = bodyMass * invDist * invDist * invDist;
+                        ax += bx * f; ay += by * f; az += bz * f;
+                    }
+                    n = node.next;
+                }
+                else {
+                    ++n;
+                }
+            }
+
+            const uint32_t i = bodyIndex[s];
+            accelX[i] = ax;
+            accelY[i] = ay;
+            accelZ[i] = az;
+        }
+    });
+}
@@ -0,0 +1,294 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+
+#include "particle_simulation.h"
+#include "particle_effect.h"
+#include "script_parser.h"
+
+// 模拟内核与生成路径的微基准：不创建OpenGL上下文，结果以JSON输出，便于比较不同版本之间的回归。
+// bytes_per_particle是按数据布局算出的名义状态流量，不是实测带宽。
+
+// 一步更新读位置、速度（24）、寿命（4）、类型（1），写位置、速度、寿命与颜色（40）
+static const double UpdateBytesPerParticle = 69.0;
+// 重置或生成一个粒子写位置、速度、颜色（36）、寿命、大小（8）与类型（1）
+static const double SpawnBytesPerParticle = 45.0;
+// 打包读位置、颜色、大小与寿命（32），写一个ParticleInstance
+static const double PackBytesPerParticle = 32.0 + sizeof(ParticleInstance);
+
+static const char* const DefaultEffects[] = {
+    "gentle_swirl", "violent_accretion", "distant_rings", "gamma_jet", "supernova"
+};
+
+static const uint64_t BenchSeed = 42;
+
+struct BenchResult {
+    std::string name;
+    std::string effect;
+    size_t particles;           // 模拟中的粒子总数
+    int iterations;
+    double nsPerParticle;       // 按每次迭代实际处理的粒子数平均
+    double minNsPerParticle;    // 最快一次迭代
+    double bytesPerParticle;
+};
+
+struct BenchOptions {
+    double minSeconds = 0.2;
+    int minIterations = 3;
+    int warmupIterations = 2;
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+        << "  --sizes LIST      comma separated particle counts (default 12000,100000,1000000,10000000)\n"
+        << "  --effects LIST    comma separated effect names (default: the five built-in effects)\n"
+        << "  --scripts DIR     effect script directory (default scripts/)\n"
+        << "  --min-time S      minimum measured time per benchmark in seconds (default 0.2)\n"
+        << "  --iterations N    minimum measured iterations per benchmark (default 3)\n"
+        << "  --kernel ISA      force integrator kernel: scalar, sse2 or avx2 (default: best supported)\n"
+        << "  --threads N       simulation worker threads, 0 = all hardware threads (default 1)\n"
+        << "  --out FILE        write JSON results to FILE instead of stdout\n";
+}
+
+static std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// 反复执行body直到累计时间与次数都达到下限。prepare在计时之外运行，body返回本次处理的粒子数
+static BenchResult runBenchmark(const BenchOptions& options,
+    const std::function<void()>& prepare, const std::function<size_t()>& body) {
+    using Clock = std::chrono::steady_clock;
+
+    for (int i = 0; i < options.warmupIterations; ++i) {
+        prepare();
+        body();
+    }
+
+    BenchResult result = {};
+    double totalSeconds = 0.0;
+    double totalParticles = 0.0;
+    double minNs = -1.0;
+    while (result.iterations < options.minIterations || totalSeconds < options.minSeconds) {
+        prepare();
+        auto start = Clock::now();
+        const size_t processed = body();
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        totalSeconds += seconds;
+        totalParticles += static_cast<double>(processed);
+        ++result.iterations;
+        if (processed > 0) {
+            const double ns = seconds * 1e9 / processed;
+            minNs = minNs < 0.0 ? ns : std::min(minNs, ns);
+        }
+    }
+
+    result.nsPerParticle = totalParticles > 0.0 ? totalSeconds * 1e9 / totalParticles : 0.0;
+    result.minNsPerParticle = std::max(minNs, 0.0);
+    return result;
+}
+
+static void report(std::vector<BenchResult>& results, BenchResult result,
+    const std::string& name, const std::string& effect, size_t particles, double bytesPerParticle) {
+    result.name = name;
+    result.effect = effect;
+    result.particles = particles;
+    result.bytesPerParticle = bytesPerParticle;
+
+    std::cerr << "  " << name << (effect.empty() ? "" : " [" + effect + "]")
+        << ": " << result.nsPerParticle << " ns/particle (min " << result.minNsPerParticle
+        << ", " << result.iterations << " iterations)" << std::endl;
+    results.push_back(result);
+}
+
+static void writeJson(std::ostream& out, const std::vector<BenchResult>& results,
+    const char* kernelName, int threadCount) {
+    out << "{\n"
+        << "  \"benchmark\": \"blackhole_bench\",\n"
+        << "  \"kernel\": \"" << kernelName << "\",\n"
+        << "  \"threads\": " << threadCount << ",\n"
+        << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << r.name << "\""
+            << ", \"effect\": \"" << r.effect << "\""
+            << ", \"particles\": " << r.particles
+            << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_particle\": " << r.nsPerParticle
+            << ", \"min_ns_per_particle\": " << r.minNsPerParticle
+            << ", \"bytes_per_particle\": " << r.bytesPerParticle << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = { 12000, 100000, 1000000, 10000000 };
+    std::vector<std::string> effectNames(std::begin(DefaultEffects), std::end(DefaultEffects));
+    std::string scriptDirectory = "scripts/";
+    std::string kernelName;
+    std::string outputPath;
+    int threadCount = 1;
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--sizes" && hasValue) {
+            sizes.clear();
+            for (const std::string& item : splitList(argv[++i])) {
+                sizes.push_back(static_cast<size_t>(std::strtoull(item.c_str(), nullptr, 10)));
+            }
+        }
+        else if (arg == "--effects" && hasValue) effectNames = splitList(argv[++i]);
+        else if (arg == "--scripts" && hasValue) scriptDirectory = argv[++i];
+        else if (arg == "--min-time" && hasValue) options.minSeconds = std::atof(argv[++i]);
+        else if (arg == "--iterations" && hasValue) options.minIterations = std::atoi(argv[++i]);
+        else if (arg == "--kernel" && hasValue) kernelName = argv[++i];
+        else if (arg == "--threads" && hasValue) threadCount = std::atoi(argv[++i]);
+        else if (arg == "--out" && hasValue) outputPath = argv[++i];
+        else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : -1;
+        }
+    }
+
+    if (sizes.empty() || std::find(sizes.begin(), sizes.end(), size_t(0)) != sizes.end()) {
+        std::cerr << "Particle counts must be positive" << std::endl;
+        return -1;
+    }
+    if (options.minIterations <= 0) {
+        options.minIterations = 1;
+    }
+
+    KernelISA isa = detectKernelISA();
+    if (!kernelName.empty()) {
+        if (kernelName == "scalar") isa = KernelISA::Scalar;
+        else if (kernelName == "sse2") isa = KernelISA::SSE2;
+        else if (kernelName == "avx2") isa = KernelISA::AVX2;
+        else {
+            std::cerr << "Unknown kernel: " << kernelName << std::endl;
+            return -1;
+        }
+
+        if (!isKernelISASupported(isa)) {
+            std::cerr << "Kernel " << getKernelISAName(isa) << " is not supported on this CPU" << std::endl;
+            return -1;
+        }
+    }
+
+    if (threadCount <= 0) {
+        threadCount = ThreadPool::getHardwareThreadCount();
+    }
+
+    // 载入脚本的日志改写到stderr，标准输出只留给JSON
+    ScriptParser scriptParser;
+    std::streambuf* stdoutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    scriptParser.loadScripts(scriptDirectory);
+    std::cout.rdbuf(stdoutBuffer);
+    std::vector<const ParticleEffect*> effects;
+    for (const std::string& name : effectNames) {
+        const ParticleEffect* effect = scriptParser.findEffect(name);
+        if (!effect) {
+            std::cerr << "Effect not found: " << name << std::endl;
+            return -1;
+        }
+        effects.push_back(effect);
+    }
+
+    std::vector<BenchResult> results;
+    const float deltaTime = 1.0f / 60.0f;
+
+    for (size_t size : sizes) {
+        std::cerr << size << " particles:" << std::endl;
+        ParticleSimulation simulation(static_cast<int>(size));
+        simulation.setKernelISA(isa);
+        simulation.setThreadCount(threadCount);
+
+        // 每个特效从同一初始状态开始，多次迭代之间状态继续演化，与实际运行一致
+        for (const ParticleEffect* effect : effects) {
+            simulation.applyEffect(*effect);
+            simulation.setSeed(BenchSeed);
+            BenchResult result = runBenchmark(options, [] {}, [&] {
+                simulation.update(deltaTime);
+                return size;
+            });
+            report(results, result, "update", effect->name, size, UpdateBytesPerParticle);
+        }
+
+        // 以下各项使用默认参数
+        simulation.applyEffect(*effects.front());
+
+        // 重新设定种子会对每个粒子调用一次resetParticle
+        BenchResult reset = runBenchmark(options, [] {}, [&] {
+            simulation.setSeed(BenchSeed);
+            return size;
+        });
+        report(results, reset, "reset", "", size, SpawnBytesPerParticle);
+
+        // 生成路径只处理空闲槽位，计时前把一部分粒子放回空闲表；
+        // 爆炸每次固定生成500个，连续触发直到空闲槽位用完
+        const size_t spawnCount = std::min<size_t>(size, 100000);
+        BenchResult explosion = runBenchmark(options, [&] {
+            simulation.retireParticles(0, spawnCount);
+        }, [&] {
+            const size_t before = simulation.getFreeSlotCount();
+            while (simulation.getFreeSlotCount() > 0) {
+                simulation.triggerExplosion();
+            }
+            return before;
+        });
+        report(results, explosion, "explosion_spawn", "", size, SpawnBytesPerParticle);
+
+        BenchResult jet = runBenchmark(options, [&] {
+            simulation.retireParticles(0, spawnCount);
+        }, [&] {
+            const size_t before = simulation.getFreeSlotCount();
+            simulation.spawnJetParticles(before);
+            return before - simulation.getFreeSlotCount();
+        });
+        report(results, jet, "jet_spawn", "", size, SpawnBytesPerParticle);
+
+        // 打包前先推进一步，让少量粒子死亡，覆盖跳过死亡粒子的分支
+        simulation.setSeed(BenchSeed);
+        simulation.update(deltaTime);
+        std::vector<ParticleInstance> instances(size);
+        BenchResult pack = runBenchmark(options, [] {}, [&] {
+            simulation.packInstances(instances.data());
+            return size;
+        });
+        report(results, pack, "pack_instances", "", size, PackBytesPerParticle);
+    }
+
+    const char* isaName = getKernelISAName(isa);
+    if (outputPath.empty()) {
+        writeJson(std::cout, results, isaName, threadCount);
+    }
+    else {
+        std::ofstream file(outputPath);
+        if (!file) {
+            std::cerr << "Failed to open " << outputPath << std::endl;
+            return -1;
+        }
+        writeJson(file, results, isaName, threadCount);
+        std::cerr << "Results written to " << outputPath << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "block_time_steps.h"
+#include <algorithm>
+#include <cmath>
+
+void BlockTimeStepper::integrate(const IntegrationBatch& batch, size_t count, const IntegrationConstants& constants,
+    const BlockTimeStepSettings& settings, IntegrateKernel kernel, ThreadPool& pool) {
+    maxBin = std::min(std::max(settings.maxBin, 0), MaxTimeBins - 1);
+    const float dt = constants.deltaTime;
+
+    // 选档：最大的k使Δt/2^k不超过accuracy·√(r³/M)，最细为maxBin
+    binOf.resize(count);
+    pool.parallelFor(0, count, 4096, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i) {
+            if (batch.type[i] != 0) {
+                binOf[i] = 0;
+                continue;
+            }
+            if (batch.life[i] <= 0.0f || (batch.analytic && batch.analytic[i])) {
+                binOf[i] = Excluded;
+                continue;
+            }
+
+            const float x = batch.posX[i], y = batch.posY[i], z = batch.posZ[i];
+            const float distSq = x * x + y * y + z * z;
+            const float dynamicalTime = std::sqrt(distSq * std::sqrt(distSq) / settings.blackHoleMass);
+            const float allowed = settings.accuracy * dynamicalTime;
+
+            int bin = 0;
+            float binDt = dt;
+            while (bin < maxBin && binDt > allowed) {
+                binDt *= 0.5f;
+                ++bin;
+            }
+            binOf[i] = static_cast<uint8_t>(bin);
+        }
+    });
+
+    // 计数排序，最细档在前，档内保持原下标顺序
+    for (int bin = 0; bin < MaxTimeBins; ++bin) {
+        binCounts[bin] = 0;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (binOf[i] != Excluded) {
+            ++binCounts[binOf[i]];
+        }
+    }
+
+    size_t cursor[MaxTimeBins];
+    size_t total = 0;
+    forceEvaluations = 0;
+    for (int bin = maxBin; bin >= 0; --bin) {
+        binBegin[bin] = total;
+        cursor[bin] = total;
+        total += binCounts[bin];
+        forceEvaluations += static_cast<uint64_t>(binCounts[bin]) << bin;
+    }
+    uniformEvaluations = static_cast<uint64_t>(total) << maxBin;
+
+    order.resize(total);
+    for (size_t i = 0; i < count; ++i) {
+        if (binOf[i] != Excluded) {
+            order[cursor[binOf[i]]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    const bool hasAccel = batch.accelX != nullptr;
+    posX.resize(total); posY.resize(total); posZ.resize(total);
+    velX.resize(total); velY.resize(total); velZ.resize(total);
+    life.resize(total);
+    type.resize(total);
+    colorR.resize(total); colorG.resize(total); colorB.resize(total);
+    if (hasAccel) {
+        accelX.resize(total); accelY.resize(total); accelZ.resize(total);
+    }
+
+    pool.parallelFor(0, total, 4096, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = order[k];
+            posX[k] = batch.posX[i]; posY[k] = batch.posY[i]; posZ[k] = batch.posZ[i];
+            velX[k] = batch.velX[i]; velY[k] = batch.velY[i]; velZ[k] = batch.velZ[i];
+            life[k] = batch.life[i];
+            type[k] = batch.type[i];
+            colorR[k] = batch.colorR[i]; colorG[k] = batch.colorG[i]; colorB[k] = batch.colorB[i];
+            if (hasAccel) {
+                accelX[k] = batch.accelX[i]; accelY[k] = batch.accelY[i]; accelZ[k] = batch.accelZ[i];
+            }
+        }
+    });
+
+    IntegrationBatch sorted;
+    sorted.posX = posX.data(); sorted.posY = posY.data(); sorted.posZ = posZ.data();
+    sorted.velX = velX.data(); sorted.velY = velY.data(); sorted.velZ = velZ.data();
+    sorted.life = life.data();
+    sorted.type = type.data();
+    sorted.colorR = colorR.data(); sorted.colorG = colorG.data(); sorted.colorB = colorB.data();
+    sorted.accelX = hasAccel ? accelX.data() : nullptr;
+    sorted.accelY = hasAccel ? accelY.data() : nullptr;
+    sorted.accelZ = hasAccel ? accelZ.data() : nullptr;
+    sorted.noiseIndex = order.data();
+    sorted.analytic = nullptr;
+
+    const int tickCount = 1 << maxBin;
+    for (int tick = 0; tick < tickCount; ++tick) {
+        // 第k档在节拍序号是2^(maxBin-k)的倍数时积分；某档不活跃时更粗的档也不活跃
+        int coarsestActive = maxBin;
+        while (coarsestActive > 0 && tick % (1 << (maxBin - coarsestActive + 1)) == 0) {
+            --coarsestActive;
+        }
+        const size_t activeEnd = binBegin[coarsestActive] + binCounts[coarsestActive];
+
+        IntegrationConstants binConstants[MaxTimeBins];
+        for (int bin = coarsestActive; bin <= maxBin; ++bin) {
+            binConstants[bin] = constants;
+            binConstants[bin].deltaTime = dt / static_cast<float>(1 << bin);
+            // 每个节拍使用不同的噪声流
+            binConstants[bin].noiseStream[1] = constants.noiseStream[1] ^ (static_cast<uint32_t>(tick) << 16);
+        }
+
+        pool.parallelFor(0, activeEnd, 4096, [&](size_t begin, size_t end, int) {
+            for (int bin = maxBin; bin >= coarsestActive; --bin) {
+                const size_t first = std::max(begin, binBegin[bin]);
+                const size_t last = std::min(end, binBegin[bin] + binCounts[bin]);
+                if (first < last) {
+                    kernel(sorted, binConstants[bin], first, last);
+                }
+            }
+        });
+    }
+
+    pool.parallelFor(0, total, 4096, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = order[k];
+            batch.posX[i] = posX[k]; batch.posY[i] = posY[k]; batch.posZ[i] = posZ[k];
+            batch.velX[i] = velX[k]; batch.velY[i] = velY[k]; batch.velZ[i] = velZ[k];
+            batch.life[i] = life[k];
+            batch.colorR[i] = colorR[k]; batch.colorG[i] = colorG[k]; batch.colorB[i] = colorB[k];
+        }
+    });
+}
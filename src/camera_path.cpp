@@ -0,0 +1,123 @@
+#include "camera_path.h"
+#include "camera.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool CameraPath::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open camera path: " << filename << std::endl;
+        return false;
+    }
+
+    keyframes.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        const size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        std::istringstream stream(line);
+        CameraKeyframe keyframe;
+        if (!(stream >> keyframe.time >> keyframe.theta >> keyframe.phi >> keyframe.radius
+            >> keyframe.target.x >> keyframe.target.y >> keyframe.target.z)) {
+            std::cerr << filename << ":" << lineNumber << ": expected 'time theta phi radius x y z'" << std::endl;
+            keyframes.clear();
+            return false;
+        }
+        if (!addKeyframe(keyframe)) {
+            std::cerr << filename << ":" << lineNumber << ": keyframe time " << keyframe.time
+                << " is not after the previous keyframe (" << keyframes.back().time << ")" << std::endl;
+            keyframes.clear();
+            return false;
+        }
+    }
+
+    if (keyframes.empty()) {
+        std::cerr << "Camera path has no keyframes: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CameraPath::save(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write camera path: " << filename << std::endl;
+        return false;
+    }
+
+    file << "# time theta phi radius targetX targetY targetZ\n";
+    for (const CameraKeyframe& k : keyframes) {
+        file << k.time << " " << k.theta << " " << k.phi << " " << k.radius << " "
+            << k.target.x << " " << k.target.y << " " << k.target.z << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool CameraPath::addKeyframe(const CameraKeyframe& keyframe) {
+    if (keyframes.empty()) {
+        keyframes.push_back(keyframe);
+        return true;
+    }
+
+    const CameraKeyframe& last = keyframes.back();
+    if (!(keyframe.time > last.time)) {
+        return false;
+    }
+
+    CameraKeyframe unwrapped = keyframe;
+    while (unwrapped.theta - last.theta > 180.0f) unwrapped.theta -= 360.0f;
+    while (unwrapped.theta - last.theta < -180.0f) unwrapped.theta += 360.0f;
+    keyframes.push_back(unwrapped);
+    return true;
+}
+
+bool CameraPath::addKeyframe(float time, const Camera& camera) {
+    return addKeyframe(CameraKeyframe{ time, camera.Theta, camera.Phi, camera.Radius, camera.Target });
+}
+
+CameraKeyframe CameraPath::sample(float time) const {
+    if (keyframes.empty()) {
+        return CameraKeyframe{ time, 45.0f, 30.0f, 25.0f, glm::vec3(0.0f) };
+    }
+    if (time <= keyframes.front().time) {
+        return keyframes.front();
+    }
+    if (time >= keyframes.back().time) {
+        return keyframes.back();
+    }
+
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+        [](float t, const CameraKeyframe& k) { return t < k.time; });
+    const CameraKeyframe& a = *(next - 1);
+    const CameraKeyframe& b = *next;
+    const float t = (time - a.time) / (b.time - a.time);
+
+    CameraKeyframe result;
+    result.time = time;
+    result.theta = glm::mix(a.theta, b.theta, t);
+    result.phi = glm::mix(a.phi, b.phi, t);
+    result.radius = glm::mix(a.radius, b.radius, t);
+    result.target = glm::mix(a.target, b.target, t);
+    return result;
+}
+
+void CameraPath::apply(Camera& camera, float time) const {
+    const CameraKeyframe k = sample(time);
+
+    // 与鼠标交互保持相同的取值范围
+    float theta = std::fmod(k.theta, 360.0f);
+    if (theta < 0.0f) theta += 360.0f;
+    camera.Theta = theta;
+    camera.Phi = glm::clamp(k.phi, -89.0f, 89.0f);
+    camera.Target = k.target;
+    camera.SetRadius(k.radius);
+}
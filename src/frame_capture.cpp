@@ -0,0 +1,313 @@
+#include "frame_capture.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stb_image_write.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+static const char* const PipeMode = "wb";
+#else
+#include <csignal>
+static const char* const PipeMode = "w";
+#endif
+
+FrameCapture::FrameCapture(const CaptureSettings& settings, int windowWidth, int windowHeight)
+    : settings(settings), width(windowWidth), height(windowHeight), open(false),
+    framebuffer(0), colorBuffer(0), depthBuffer(0), nextSlot(0), pendingSlots(0),
+    frameCounter(0), capturedFrames(0), droppedFrames(0),
+    stopRequested(false), writtenFrames(0), writeFailed(false), pipe(nullptr) {
+    for (int i = 0; i < ReadbackSlots; ++i) {
+        pixelBuffers[i] = 0;
+        fences[i] = nullptr;
+        slotFrame[i] = 0;
+    }
+
+    if (settings.width > 0 && settings.height > 0) {
+        width = settings.width;
+        height = settings.height;
+        if (!createTarget()) {
+            return;
+        }
+    }
+
+    if (settings.output == CaptureOutput::PngSequence) {
+        std::error_code error;
+        std::filesystem::create_directories(settings.target, error);
+        if (error) {
+            std::cerr << "Failed to create capture directory " << settings.target << ": " << error.message() << std::endl;
+            return;
+        }
+    }
+    else {
+#ifndef _WIN32
+        // 编码器提前退出时写入返回错误，而不是让SIGPIPE结束整个程序
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+        pipe = popen(settings.target.c_str(), PipeMode);
+        if (!pipe) {
+            std::cerr << "Failed to start capture command: " << settings.target << std::endl;
+            return;
+        }
+    }
+
+    const size_t frameBytes = static_cast<size_t>(width) * height * 4;
+    glGenBuffers(ReadbackSlots, pixelBuffers);
+    for (int i = 0; i < ReadbackSlots; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pool.resize(MaxQueuedFrames);
+    for (int i = 0; i < MaxQueuedFrames; ++i) {
+        pool[i].resize(frameBytes);
+        freeBuffers.push_back(i);
+    }
+
+    open = true;
+    writer = std::thread(&FrameCapture::writerLoop, this);
+    std::cout << "Capturing " << width << "x" << height << " RGB frames to " << settings.target << std::endl;
+}
+
+FrameCapture::~FrameCapture() {
+    finish();
+
+    for (int i = 0; i < ReadbackSlots; ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+        }
+    }
+    glDeleteBuffers(ReadbackSlots, pixelBuffers);
+    if (framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+    }
+}
+
+bool FrameCapture::createTarget() {
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Capture framebuffer " << width << "x" << height << " is incomplete: 0x"
+            << std::hex << status << std::dec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FrameCapture::beginFrame() {
+    if (framebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glViewport(0, 0, width, height);
+    }
+}
+
+void FrameCapture::endFrame(int windowWidth, int windowHeight) {
+    if (!open) {
+        return;
+    }
+
+    // 先按顺序取回已经完成的读回；环已满时最旧的一帧只能等待，这时GPU已落后ReadbackSlots帧
+    while (pendingSlots > 0) {
+        const int oldest = (nextSlot - pendingSlots + ReadbackSlots) % ReadbackSlots;
+        if (!retrieve(oldest, pendingSlots == ReadbackSlots)) {
+            break;
+        }
+    }
+
+    // 写入PBO的glReadPixels立即返回，复制在GPU上异步进行
+    const int slot = nextSlot;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slotFrame[slot] = frameCounter++;
+    nextSlot = (nextSlot + 1) % ReadbackSlots;
+    ++pendingSlots;
+
+    if (framebuffer) {
+        // 保持宽高比缩放显示到窗口
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, windowWidth, windowHeight);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        const float scale = std::min(static_cast<float>(windowWidth) / width, static_cast<float>(windowHeight) / height);
+        const int drawWidth = static_cast<int>(width * scale);
+        const int drawHeight = static_cast<int>(height * scale);
+        const int x = (windowWidth - drawWidth) / 2;
+        const int y = (windowHeight - drawHeight) / 2;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBlitFramebuffer(0, 0, width, height, x, y, x + drawWidth, y + drawHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+}
+
+bool FrameCapture::retrieve(int slot, bool wait) {
+    GLsync sync = fences[slot];
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;) {
+        GLenum result = glClientWaitSync(sync, waitFlags, wait ? 1000000 : 0); // 等待时每次1ms
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) {
+            break;
+        }
+        if (!wait) {
+            return false;
+        }
+        waitFlags = 0;
+    }
+    glDeleteSync(sync);
+    fences[slot] = nullptr;
+    --pendingSlots;
+
+    int buffer = -1;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (settings.offline) {
+            queueChanged.wait(lock, [this] { return !freeBuffers.empty() || writeFailed; });
+        }
+        if (!freeBuffers.empty() && !writeFailed) {
+            buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+    }
+    if (buffer < 0) {
+        ++droppedFrames;
+        return true;
+    }
+
+    // 只做一次整块复制，翻转行序与去掉alpha在写线程中完成
+    std::vector<unsigned char>& pixels = pool[buffer];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels.size(), GL_MAP_READ_BIT);
+    const bool copied = mapped != nullptr;
+    if (copied) {
+        std::memcpy(pixels.data(), mapped, pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (copied) {
+            queue.push_back(PendingFrame{ buffer, slotFrame[slot] });
+        }
+        else {
+            freeBuffers.push_back(buffer);
+        }
+    }
+    if (copied) {
+        ++capturedFrames;
+        queueChanged.notify_all();
+    }
+    else {
+        ++droppedFrames;
+    }
+    return true;
+}
+
+void FrameCapture::finish() {
+    if (!open) {
+        return;
+    }
+
+    while (pendingSlots > 0) {
+        retrieve((nextSlot - pendingSlots + ReadbackSlots) % ReadbackSlots, true);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopRequested = true;
+    }
+    queueChanged.notify_all();
+    writer.join();
+
+    if (pipe) {
+        pclose(pipe);
+        pipe = nullptr;
+    }
+    open = false;
+
+    std::cout << "Capture finished: " << getWrittenFrames() << " frames written, "
+        << droppedFrames << " dropped" << std::endl;
+}
+
+uint64_t FrameCapture::getWrittenFrames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writtenFrames;
+}
+
+void FrameCapture::writerLoop() {
+    for (;;) {
+        PendingFrame pending;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueChanged.wait(lock, [this] { return !queue.empty() || stopRequested; });
+            if (queue.empty()) {
+                return;
+            }
+            pending = queue.front();
+            queue.pop_front();
+        }
+
+        const bool written = writeFrame(pending);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBuffers.push_back(pending.buffer);
+            if (written) {
+                ++writtenFrames;
+            }
+            else if (!writeFailed) {
+                // 之后的帧不再排队，离线模式也不会一直等下去
+                writeFailed = true;
+                std::cerr << "Frame capture write failed at frame " << pending.frame << std::endl;
+            }
+        }
+        queueChanged.notify_all();
+    }
+}
+
+bool FrameCapture::writeFrame(const PendingFrame& pending) {
+    // GL的行序从下到上，输出从上到下的RGB
+    const unsigned char* pixels = pool[pending.buffer].data();
+    rgb.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = pixels + static_cast<size_t>(height - 1 - y) * width * 4;
+        unsigned char* dst = rgb.data() + static_cast<size_t>(y) * width * 3;
+        for (int x = 0; x < width; ++x) {
+            dst[x * 3 + 0] = src[x * 4 + 0];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+    if (pipe) {
+        return std::fwrite(rgb.data(), 1, rgb.size(), pipe) == rgb.size();
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06llu.png", static_cast<unsigned long long>(pending.frame));
+    const std::string path = (std::filesystem::path(settings.target) / name).string();
+    return stbi_write_png(path.c_str(), width, height, 3, rgb.data(), width * 3) != 0;
+}
@@ -0,0 +1,28 @@
+#include "frame_uniforms.h"
+#include "shader.h"
+
+const char* const FrameUniformBuffer::BlockName = "FrameUniforms";
+
+FrameUniformBuffer::FrameUniformBuffer() : buffer(0) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // 绑定点只被这个缓冲占用，创建时绑定一次即可
+    glBindBufferBase(GL_UNIFORM_BUFFER, BindingPoint, buffer);
+}
+
+FrameUniformBuffer::~FrameUniformBuffer() {
+    glDeleteBuffers(1, &buffer);
+}
+
+void FrameUniformBuffer::attach(Shader& shader) const {
+    shader.bindUniformBlock(BlockName, BindingPoint);
+}
+
+void FrameUniformBuffer::update(const FrameUniforms& data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,306 @@
+#include "gpu_particle_simulation.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    const char* const FeedbackVaryings[] = {
+        "outPosition", "outVelocity", "outColor", "outLife", "outSize", "outType"
+    };
+
+    // 与particle_compact.cs的local_size_x一致
+    const GLuint CompactGroupSize = 256;
+}
+
+GpuParticleSimulation::GpuParticleSimulation(int maxParticles)
+    : updateShader("shaders/particle_update.vs", FeedbackVaryings, 6), maxParticles(maxParticles),
+      current(0), compactBuffer(0), localOffsetBuffer(0), groupOffsetBuffer(0), drawCommandBuffer(0),
+      compactGroupCount(0), offsetTextures{0, 0}, countReadbackBuffer(0), countFences{}, countSlot(0), liveCount(-1),
+      stepIndex(0), pendingExplosionParticles(0) {
+    glGenBuffers(2, stateBuffers);
+    glGenVertexArrays(2, updateVAOs);
+
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(GpuParticleState), nullptr, GL_DYNAMIC_COPY);
+        setupVertexArray(i);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    UpdateUniforms& u = updateUniforms;
+    u.deltaTime = updateShader.getUniform<float>("deltaTime");
+    u.blackHoleMass = updateShader.getUniform<float>("blackHoleMass");
+    u.particleLifetime = updateShader.getUniform<float>("particleLifetime");
+    u.leapfrog = updateShader.getUniform<int>("leapfrog");
+    u.spiralStrength = updateShader.getUniform<float>("spiralStrength");
+    u.turbulenceStrength = updateShader.getUniform<float>("turbulenceStrength");
+    u.accretionDiskRadius = updateShader.getUniform<float>("accretionDiskRadius");
+    u.particleSize = updateShader.getUniform<float>("particleSize");
+    u.seed = updateShader.getUniform<unsigned int>("seed");
+    u.stepIndex = updateShader.getUniform<unsigned int>("stepIndex");
+    u.jetCount = updateShader.getUniform<int>("jetCount");
+    u.jetAngle = updateShader.getUniform<float>("jetAngle");
+    u.jetDirection = updateShader.getUniform<glm::vec3>("jetDirection");
+    u.jetParticleSpeed = updateShader.getUniform<float>("jetParticleSpeed");
+    u.explosionCount = updateShader.getUniform<int>("explosionCount");
+    u.explosionStrength = updateShader.getUniform<float>("explosionStrength");
+    u.liveOffsets = updateShader.getUniform<int>("liveOffsets");
+    u.groupLiveOffsets = updateShader.getUniform<int>("groupLiveOffsets");
+
+    if (GLEW_VERSION_4_3) {
+        compactShader.reset(new Shader("shaders/particle_compact.cs"));
+        compactPassUniform = compactShader->getUniform<int>("compactPass");
+        compactParticleCountUniform = compactShader->getUniform<unsigned int>("particleCount");
+        compactGroupCountUniform = compactShader->getUniform<unsigned int>("groupCount");
+        compactGroupCount = (maxParticles + CompactGroupSize - 1) / CompactGroupSize;
+
+        GLuint buffers[5];
+        glGenBuffers(5, buffers);
+        compactBuffer = buffers[0];
+        localOffsetBuffer = buffers[1];
+        groupOffsetBuffer = buffers[2];
+        drawCommandBuffer = buffers[3];
+        countReadbackBuffer = buffers[4];
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, compactBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, maxParticles * sizeof(ParticleInstance), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, localOffsetBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, maxParticles * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, groupOffsetBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, compactGroupCount * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCommandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 5 * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, countReadbackBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, CountReadbackSlots * sizeof(GLuint), nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glGenTextures(2, offsetTextures);
+        glBindTexture(GL_TEXTURE_BUFFER, offsetTextures[0]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, localOffsetBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, offsetTextures[1]);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, groupOffsetBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+}
+
+GpuParticleSimulation::~GpuParticleSimulation() {
+    glDeleteVertexArrays(2, updateVAOs);
+    glDeleteBuffers(2, stateBuffers);
+    glDeleteProgram(updateShader.ID);
+
+    if (compactShader) {
+        for (GLsync fence : countFences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+        GLuint buffers[5] = { compactBuffer, localOffsetBuffer, groupOffsetBuffer, drawCommandBuffer, countReadbackBuffer };
+        glDeleteBuffers(5, buffers);
+        glDeleteTextures(2, offsetTextures);
+        glDeleteProgram(compactShader->ID);
+    }
+}
+
+void GpuParticleSimulation::setupVertexArray(int index) {
+    glBindVertexArray(updateVAOs[index]);
+    glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[index]);
+
+    const GLsizei stride = sizeof(GpuParticleState);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticleState, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticleState, velocity));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticleState, color));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticleState, life));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticleState, size));
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(GpuParticleState, type));
+
+    glBindVertexArray(0);
+}
+
+void GpuParticleSimulation::upload(const ParticleStore& particles) {
+    const size_t count = std::min(particles.count(), static_cast<size_t>(maxParticles));
+
+    std::vector<GpuParticleState> states(maxParticles);
+    for (size_t i = 0; i < count; ++i) {
+        GpuParticleState& state = states[i];
+        state.position = particles.position(i);
+        state.velocity = particles.velocity(i);
+        state.color = particles.color(i);
+        state.life = particles.life[i];
+        state.size = particles.size[i];
+        state.type = static_cast<float>(particles.type[i]);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, stateBuffers[current]);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, states.size() * sizeof(GpuParticleState), states.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 上次使用GPU后端时发出的读回不再对应当前状态
+    for (GLsync& fence : countFences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    liveCount = -1;
+}
+
+void GpuParticleSimulation::update(float deltaTime, const ParticleParameters& params, uint64_t seed) {
+    // 空闲槽位的序号来自压缩的前缀和，没有计算着色器时不生成特效粒子
+    const bool canSpawn = hasCompaction();
+    int explosionCount = canSpawn ? std::min(pendingExplosionParticles, maxParticles) : 0;
+    pendingExplosionParticles = 0;
+
+    // 与ParticleSimulation::advance一致：每个子步生成一批喷流粒子，爆炸粒子在第一个子步生成
+    const int substeps = std::max(params.substeps, 1);
+    const int jetCount = canSpawn && params.enableJet ? static_cast<int>(ParticleSimulation::JetParticlesPerStep) : 0;
+    for (int s = 0; s < substeps; ++s) {
+        step(deltaTime / substeps, params, seed, explosionCount, jetCount);
+        explosionCount = 0;
+    }
+}
+
+void GpuParticleSimulation::step(float deltaTime, const ParticleParameters& params, uint64_t seed,
+    int explosionCount, int jetCount) {
+    ++stepIndex;
+
+    const bool spawning = explosionCount + jetCount > 0;
+    if (spawning) {
+        scanLiveParticles();
+        unbindStorageBuffers();
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    const UpdateUniforms& u = updateUniforms;
+    updateShader.use();
+    updateShader.set(u.deltaTime, deltaTime);
+    updateShader.set(u.leapfrog, params.integrator == IntegratorType::Leapfrog ? 1 : 0);
+    updateShader.set(u.blackHoleMass, params.blackHoleMass);
+    updateShader.set(u.particleLifetime, params.particleLifetime);
+    updateShader.set(u.spiralStrength, params.spiralStrength);
+    updateShader.set(u.turbulenceStrength, params.turbulenceStrength);
+    updateShader.set(u.accretionDiskRadius, params.accretionDiskRadius);
+    updateShader.set(u.particleSize, params.particleSize);
+
+    updateShader.set(u.seed, static_cast<uint32_t>(seed ^ (seed >> 32)));
+    updateShader.set(u.stepIndex, stepIndex);
+
+    updateShader.set(u.jetCount, jetCount);
+    updateShader.set(u.jetAngle, params.jetAngle);
+    updateShader.set(u.jetDirection, params.jetDirection);
+    updateShader.set(u.jetParticleSpeed, params.jetParticleSpeed);
+
+    updateShader.set(u.explosionCount, explosionCount);
+    updateShader.set(u.explosionStrength, params.explosionStrength);
+
+    if (spawning) {
+        updateShader.set(u.liveOffsets, 0);
+        updateShader.set(u.groupLiveOffsets, 1);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, offsetTextures[0]);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_BUFFER, offsetTextures[1]);
+    }
+
+    const int next = 1 - current;
+
+    // 只需要变换反馈的输出，关闭光栅化
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(updateVAOs[current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateBuffers[next]);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, maxParticles);
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    if (spawning) {
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    current = next;
+}
+
+void GpuParticleSimulation::scanLiveParticles() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, stateBuffers[current]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, compactBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, localOffsetBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, groupOffsetBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, drawCommandBuffer);
+
+    compactShader->use();
+    compactShader->set(compactParticleCountUniform, static_cast<GLuint>(maxParticles));
+    compactShader->set(compactGroupCountUniform, compactGroupCount);
+
+    // 工作组内扫描 -> 组间扫描，每趟之间等待存储缓冲写入可见
+    compactShader->set(compactPassUniform, 0);
+    glDispatchCompute(compactGroupCount, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    compactShader->set(compactPassUniform, 1);
+    glDispatchCompute(1, 1, 1);
+}
+
+void GpuParticleSimulation::unbindStorageBuffers() {
+    for (GLuint binding = 0; binding < 5; ++binding) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    }
+}
+
+void GpuParticleSimulation::compactLiveInstances(GLuint drawCount) {
+    // {count, instanceCount, firstIndex/first, baseVertex/baseInstance, baseInstance}
+    const GLuint command[5] = { drawCount, 0, 0, 0, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // 前两趟求前缀和，第三趟散射
+    scanLiveParticles();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    compactShader->set(compactPassUniform, 2);
+    glDispatchCompute(compactGroupCount, 1, 1);
+
+    // 结果既作为实例属性读取，也作为间接绘制命令读取，instanceCount还要复制到读回环
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    unbindStorageBuffers();
+    readBackLiveCount();
+}
+
+void GpuParticleSimulation::readBackLiveCount() {
+    // 本槽的复制是CountReadbackSlots帧之前发出的，就绪则取回；仍未完成时本帧不再复制，等下一轮
+    GLsync& fence = countFences[countSlot];
+    if (fence) {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            countSlot = (countSlot + 1) % CountReadbackSlots;
+            return;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+
+        GLuint count = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, countReadbackBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, countSlot * sizeof(GLuint), sizeof(GLuint), &count);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        liveCount = static_cast<int>(count);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, drawCommandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, countReadbackBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sizeof(GLuint), countSlot * sizeof(GLuint), sizeof(GLuint));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    countSlot = (countSlot + 1) % CountReadbackSlots;
+}
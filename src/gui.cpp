@@ -1,7 +1,24 @@
 #include "gui.h"
 #include <imgui.h>
+#include <imgui_internal.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include <algorithm>
+
+// 当前后端不支持的控件显示为灰色且不可操作（ImGui 1.81还没有BeginDisabled）
+static void beginDisabled(bool disabled) {
+    if (disabled) {
+        ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
+        ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
+    }
+}
+
+static void endDisabled(bool disabled) {
+    if (disabled) {
+        ImGui::PopStyleVar();
+        ImGui::PopItemFlag();
+    }
+}
 
 GUI::GUI(GLFWwindow* window, Camera& camera)
     : m_camera(camera) {
@@ -15,7 +32,7 @@ GUI::GUI(GLFWwindow* window, Camera& camera)
     ImGui_ImplOpenGL3_Init("#version 330");
 }
 
-void GUI::render(ParticleSystem& particleSystem, ScriptParser& scriptParser) {
+void GUI::render(ParticleSystem& particleSystem, ScriptParser& scriptParser, Profiler& profiler) {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -34,6 +51,70 @@ void GUI::render(ParticleSystem& particleSystem, ScriptParser& scriptParser) {
         ImGui::SliderFloat("Color Intensity", &params.colorIntensity, 0.5f, 5.0f);
     }
 
+    if (ImGui::CollapsingHeader("Self Gravity (Barnes-Hut)")) {
+        auto& params = particleSystem.getParameters();
+        const ParticleSimulation& simulation = particleSystem.getSimulation();
+
+        const bool gpu = particleSystem.getBackend() == SimulationBackend::GPU;
+        if (gpu) {
+            ImGui::TextDisabled("Self gravity runs on the CPU backend only");
+        }
+        beginDisabled(gpu);
+        ImGui::Checkbox("Enable Self Gravity", &params.enableSelfGravity);
+        ImGui::SliderFloat("Particle Mass", &params.particleMass, 0.001f, 1.0f, "%.3f");
+        ImGui::SliderFloat("Opening Angle", &params.openingAngle, 0.2f, 1.2f);
+        ImGui::SliderFloat("Softening", &params.gravitySoftening, 0.05f, 2.0f);
+        endDisabled(gpu);
+
+        ImGui::Text("Tree Nodes: %zu", simulation.getTreeNodeCount());
+        ImGui::Text("Tree Build: %.3f ms", simulation.getTreeBuildMs());
+        ImGui::Text("Tree Traversal: %.3f ms", simulation.getTreeTraversalMs());
+    }
+
+    if (ImGui::CollapsingHeader("Disk Viscosity (SPH)")) {
+        auto& params = particleSystem.getParameters();
+        const ParticleSimulation& simulation = particleSystem.getSimulation();
+
+        const bool gpu = particleSystem.getBackend() == SimulationBackend::GPU;
+        if (gpu) {
+            ImGui::TextDisabled("SPH runs on the CPU backend only");
+        }
+        beginDisabled(gpu);
+        ImGui::Checkbox("Enable SPH", &params.enableSph);
+        ImGui::SliderFloat("Smoothing Length", &params.sphSmoothingLength, 0.25f, 4.0f);
+        ImGui::SliderFloat("Rest Density", &params.sphRestDensity, 0.0f, 1.0f, "%.3f");
+        ImGui::SliderFloat("Stiffness", &params.sphStiffness, 0.0f, 200.0f);
+        ImGui::SliderFloat("Viscosity", &params.sphViscosity, 0.0f, 5.0f);
+        endDisabled(gpu);
+
+        ImGui::Text("Grid Build: %.3f ms", simulation.getGridBuildMs());
+        ImGui::Text("SPH Forces: %.3f ms", simulation.getSphMs());
+        ImGui::Text("Avg Neighbors: %.1f", simulation.getAverageNeighbors());
+    }
+
+    if (ImGui::CollapsingHeader("Kepler Fast Path")) {
+        auto& params = particleSystem.getParameters();
+        const ParticleSimulation& simulation = particleSystem.getSimulation();
+
+        const bool gpu = particleSystem.getBackend() == SimulationBackend::GPU;
+        if (gpu) {
+            ImGui::TextDisabled("The Kepler fast path runs on the CPU backend only");
+        }
+        else if (params.enableKeplerFastPath && !simulation.isKeplerFastPathActive()) {
+            ImGui::Text("Takes effect with Self-Gravity or SPH enabled");
+        }
+        beginDisabled(gpu);
+        ImGui::Checkbox("Analytic Far-Field Orbits", &params.enableKeplerFastPath);
+        ImGui::SliderFloat("Capture Radius", &params.keplerCaptureRadius, 5.0f, 200.0f);
+        ImGui::SliderFloat("Inner Radius", &params.keplerInnerRadius, 1.0f, params.keplerCaptureRadius);
+        endDisabled(gpu);
+
+        const size_t analyticCount = simulation.getAnalyticParticleCount();
+        ImGui::Text("Analytic: %zu, Integrated: %zu", analyticCount,
+            static_cast<size_t>(simulation.getParticleCount()) - analyticCount);
+        ImGui::Text("Kepler Solve: %.3f ms", simulation.getKeplerMs());
+    }
+
     if (ImGui::CollapsingHeader("Advanced Lighting")) {
         auto& params = particleSystem.getParameters();
 
@@ -78,6 +159,14 @@ void GUI::render(ParticleSystem& particleSystem, ScriptParser& scriptParser) {
     if (ImGui::CollapsingHeader("Special Effects")) {
         auto& params = particleSystem.getParameters();
 
+        // GPU后端按压缩前缀和找空闲槽位生成特效粒子，没有计算着色器时不生成
+        const bool noSpawning = particleSystem.getBackend() == SimulationBackend::GPU
+            && !particleSystem.hasGpuCompaction();
+        if (noSpawning) {
+            ImGui::TextDisabled("Jets and explosions on the GPU backend need GL 4.3");
+        }
+        beginDisabled(noSpawning);
+
         ImGui::Text("Gamma Ray Jet:");
         ImGui::Checkbox("Enable Jet", &params.enableJet);
 
@@ -112,6 +201,85 @@ void GUI::render(ParticleSystem& particleSystem, ScriptParser& scriptParser) {
         }
         ImGui::SameLine();
         ImGui::TextDisabled("(Manually triggered explosion)");
+        endDisabled(noSpawning);
+    }
+
+    if (ImGui::CollapsingHeader("Effect Scripts")) {
+        const auto& effects = scriptParser.getEffects();
+        ImGui::Text("%zu effects, %zu from cache, %zu parsed in %.1f ms", effects.size(),
+            scriptParser.getCachedCount(), scriptParser.getParsedCount(), scriptParser.getLoadMs());
+        ImGui::Text("Hot Reload: %s, %zu updates", scriptParser.isWatching() ? "watching" : "off",
+            scriptParser.getReloadCount());
+
+        // 特效库可能有上千项，只提交可见的行
+        ImGui::BeginChild("EffectList", ImVec2(0.0f, 160.0f), true);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(effects.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                const ParticleEffect& effect = effects[i];
+                if (ImGui::Selectable(effect.name.c_str(), effect.name == m_activeEffect)) {
+                    m_activeEffect = effect.name;
+                    particleSystem.applyEffect(effect);
+                }
+                if (!effect.description.empty() && ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s", effect.description.c_str());
+                }
+            }
+        }
+        ImGui::EndChild();
+    }
+
+    if (ImGui::CollapsingHeader("Rewind")) {
+        RewindBuffer& rewind = particleSystem.getRewindBuffer();
+        static int budgetMB = static_cast<int>(RewindBuffer::DefaultBudgetBytes >> 20);
+
+        if (particleSystem.getBackend() != SimulationBackend::CPU) {
+            ImGui::TextDisabled("Rewind needs the CPU simulation backend");
+        }
+        else {
+            bool enabled = particleSystem.isRewindEnabled();
+            if (ImGui::Checkbox("Record History", &enabled)) {
+                particleSystem.setRewindEnabled(enabled);
+            }
+            if (ImGui::SliderInt("Memory Budget (MB)", &budgetMB, 64, 4096)) {
+                rewind.setBudget(static_cast<size_t>(budgetMB) << 20);
+            }
+
+            const int frameCount = static_cast<int>(rewind.getFrameCount());
+            const double ratio = rewind.getMemoryBytes() > 0
+                ? static_cast<double>(rewind.getRawBytes()) / rewind.getMemoryBytes() : 0.0;
+            ImGui::Text("%d frames, %.1f MB (%.1fx smaller than raw instances)", frameCount,
+                rewind.getMemoryBytes() / (1024.0 * 1024.0), ratio);
+            ImGui::Text("Encode: %.2f ms, Decode: %.2f ms", rewind.getLastEncodeMs(), rewind.getLastDecodeMs());
+
+            // 拖动时间轴即进入回看并暂停模拟；拖到最右端仍停在最新一帧，点Live才继续
+            if (particleSystem.isRewindEnabled() && frameCount > 0) {
+                int frame = particleSystem.isScrubbing() ? particleSystem.getScrubFrame() : frameCount - 1;
+                if (ImGui::SliderInt("Timeline", &frame, 0, frameCount - 1)) {
+                    particleSystem.setScrubFrame(frame);
+                }
+                if (ImGui::Button("<")) {
+                    particleSystem.setScrubFrame(std::max(frame - 1, 0));
+                }
+                ImGui::SameLine();
+                if (ImGui::Button(">")) {
+                    particleSystem.setScrubFrame(frame + 1);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Live")) {
+                    particleSystem.setScrubFrame(-1);
+                }
+                ImGui::SameLine();
+                if (particleSystem.isScrubbing()) {
+                    ImGui::Text("Step %llu, %d frames behind",
+                        static_cast<unsigned long long>(rewind.getFrameStep(frame)), frameCount - 1 - frame);
+                }
+                else {
+                    ImGui::TextDisabled("Live");
+                }
+            }
+        }
     }
 
     if (ImGui::CollapsingHeader("Camera Control")) {
@@ -153,10 +321,184 @@ void GUI::render(ParticleSystem& particleSystem, ScriptParser& scriptParser) {
 
     if (ImGui::CollapsingHeader("Performance")) {
         ImGui::Text("Particle Count: %d", particleSystem.getParticleCount());
+        ImGui::Text("Free Slots: %zu", particleSystem.getFreeSlotCount());
+
+        // GPU后端在显存中用变换反馈积分，不再需要逐帧上传实例数据
+        const char* backends[] = { "CPU", "GPU (transform feedback)" };
+        int backendIndex = particleSystem.getBackend() == SimulationBackend::GPU ? 1 : 0;
+        if (ImGui::Combo("Simulation Backend", &backendIndex, backends, IM_ARRAYSIZE(backends))) {
+            particleSystem.setBackend(backendIndex == 1 ? SimulationBackend::GPU : SimulationBackend::CPU);
+        }
+
+        // 两种绘制方式切换后可直接比较下方的帧时间
+        const char* renderModes[] = { "Sphere Mesh (384 indices)", "Impostor Quad (4 vertices)" };
+        int renderModeIndex = particleSystem.getRenderMode() == ParticleRenderMode::Impostor ? 1 : 0;
+        if (ImGui::Combo("Particle Rendering", &renderModeIndex, renderModes, IM_ARRAYSIZE(renderModes))) {
+            particleSystem.setRenderMode(renderModeIndex == 1 ? ParticleRenderMode::Impostor : ParticleRenderMode::Mesh);
+        }
+
+        if (particleSystem.getBackend() == SimulationBackend::CPU) {
+            bool culling = particleSystem.isCullingEnabled();
+            if (ImGui::Checkbox("Frustum Culling + LOD", &culling)) {
+                particleSystem.setCullingEnabled(culling);
+            }
+
+            const CullingStats& cullingStats = particleSystem.getCullingStats();
+            ImGui::Text("Dead (not drawn): %zu", cullingStats.deadSkipped);
+            ImGui::Text("Culled: %zu frustum", cullingStats.frustumCulled);
+            for (int lod = 0; lod < ParticleLodCount; ++lod) {
+                ImGui::Text("  LOD %d drawn: %zu", lod, cullingStats.drawn[lod]);
+            }
+
+            ImGui::Text("Instance Upload: %s", particleSystem.isPersistentUpload()
+                ? "persistent mapped ring (3 segments)" : "buffer orphaning");
+            ImGui::Text("Upload Size: %.1f KB/frame", particleSystem.getUploadBytes() / 1024.0f);
+        }
+        else {
+            ImGui::Text("Live Compaction: %s", particleSystem.hasGpuCompaction()
+                ? "compute prefix sum + indirect draw" : "unavailable (needs GL 4.3), drawing all slots");
+            // 数量从读回环取得，比画面晚几帧
+            const int liveCount = particleSystem.getGpuLiveCount();
+            if (liveCount >= 0) {
+                ImGui::Text("Drawn (compacted): %d of %d", liveCount, particleSystem.getParticleCount());
+                ImGui::Text("Dead (not drawn): %d", particleSystem.getParticleCount() - liveCount);
+            }
+        }
+
+        // GPU后端只跟随积分器与子步数，其余步进选项只作用于CPU模拟
+        const bool gpu = particleSystem.getBackend() == SimulationBackend::GPU;
+        ParticleSimulation& simulation = particleSystem.getSimulation();
+        beginDisabled(gpu);
+        const KernelISA kernels[] = { KernelISA::Scalar, KernelISA::SSE2, KernelISA::AVX2 };
+        if (ImGui::BeginCombo("Integrator Kernel", getKernelISAName(simulation.getKernelISA()))) {
+            for (KernelISA isa : kernels) {
+                if (!isKernelISASupported(isa)) continue;
+                bool selected = simulation.getKernelISA() == isa;
+                if (ImGui::Selectable(getKernelISAName(isa), selected)) {
+                    simulation.setKernelISA(isa);
+                }
+            }
+            ImGui::EndCombo();
+        }
+
+        int threadCount = simulation.getThreadCount();
+        if (ImGui::SliderInt("Worker Threads", &threadCount, 1, ThreadPool::getHardwareThreadCount())) {
+            simulation.setThreadCount(threadCount);
+        }
+        endDisabled(gpu);
+        ImGui::Text("Random Seed: %llu", static_cast<unsigned long long>(simulation.getSeed()));
+
+        ParticleParameters& stepParams = simulation.getParameters();
+        const char* integrators[] = { "Semi-implicit Euler", "Leapfrog (DKD)" };
+        int integrator = static_cast<int>(stepParams.integrator);
+        if (ImGui::Combo("Integrator", &integrator, integrators, 2)) {
+            stepParams.integrator = static_cast<IntegratorType>(integrator);
+        }
+        ImGui::SliderInt("Substeps", &stepParams.substeps, 1, 8);
+
+        if (gpu) {
+            ImGui::TextDisabled("The GPU backend steps once per frame; the options below are CPU only");
+        }
+        beginDisabled(gpu);
+        float stepRate = 1.0f / stepParams.fixedTimeStep;
+        if (ImGui::SliderFloat("Step Rate (Hz)", &stepRate, 30.0f, 240.0f, "%.0f")) {
+            stepParams.fixedTimeStep = 1.0f / stepRate;
+        }
+        bool deterministic = simulation.isDeterministic();
+        if (ImGui::Checkbox("Deterministic (one step per frame)", &deterministic)) {
+            simulation.setDeterministic(deterministic);
+        }
+        ImGui::Text("Steps This Frame: %d, Interpolation: %.2f", simulation.getStepsLastFrame(),
+            simulation.getInterpolationAlpha());
+        ImGui::Text("Step Index: %llu", static_cast<unsigned long long>(simulation.getStepIndex()));
+
+        ImGui::Checkbox("Block Timesteps", &stepParams.adaptiveTimeSteps);
+        if (stepParams.adaptiveTimeSteps) {
+            ImGui::SliderFloat("Step Accuracy", &stepParams.timeStepAccuracy, 0.005f, 0.2f, "%.3f");
+            ImGui::SliderInt("Finest Bin", &stepParams.maxTimeBin, 0, BlockTimeStepper::MaxTimeBins - 1);
+
+            const BlockTimeStepper& stepper = simulation.getBlockTimeStepper();
+            for (int bin = 0; bin <= stepper.getMaxBin(); ++bin) {
+                ImGui::Text("  Bin %d (dt/%d): %zu", bin, 1 << bin, stepper.getBinCount(bin));
+            }
+            ImGui::Text("Force Evaluations: %llu (%llu at finest step)",
+                static_cast<unsigned long long>(stepper.getForceEvaluations()),
+                static_cast<unsigned long long>(stepper.getUniformEvaluations()));
+        }
+        endDisabled(gpu);
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
             1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
     }
 
+    if (ImGui::CollapsingHeader("Profiler")) {
+        // 统计最近Profiler::HistoryFrames帧，GPU时间来自几帧之前的查询结果
+        static float history[Profiler::HistoryFrames];
+        static float gpuHistory[Profiler::HistoryFrames];
+        static int plotSection = 0;
+
+        const Profiler::Stats frame = profiler.getStats(-1, false);
+        ImGui::Text("Frame: %.2f ms (min %.2f, avg %.2f, p99 %.2f)", frame.last, frame.min, frame.avg, frame.p99);
+        ImGui::Text("GPU samples dropped: %llu (queries rotate over %d frames)",
+            static_cast<unsigned long long>(profiler.getDroppedGpuSamples()), Profiler::QueryFrames);
+        profiler.copyHistory(-1, false, history);
+        ImGui::PlotLines("Frame (ms)", history, Profiler::HistoryFrames, 0, nullptr, 0.0f,
+            std::max(frame.p99 * 1.5f, 1.0f), ImVec2(0.0f, 60.0f));
+
+        if (ImGui::BeginTable("ProfilerSections", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Section");
+            ImGui::TableSetupColumn("CPU min");
+            ImGui::TableSetupColumn("CPU avg");
+            ImGui::TableSetupColumn("CPU p99");
+            ImGui::TableSetupColumn("GPU min");
+            ImGui::TableSetupColumn("GPU avg");
+            ImGui::TableSetupColumn("GPU p99");
+            ImGui::TableHeadersRow();
+            for (int section = 0; section < profiler.getSectionCount(); ++section) {
+                const Profiler::Stats cpu = profiler.getStats(section, false);
+                const Profiler::Stats gpu = profiler.getStats(section, true);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(profiler.getSectionName(section));
+                const float values[] = { cpu.min, cpu.avg, cpu.p99, gpu.min, gpu.avg, gpu.p99 };
+                for (int column = 0; column < 6; ++column) {
+                    ImGui::TableNextColumn();
+                    if (column >= 3 && gpu.samples == 0) {
+                        ImGui::TextDisabled("-");
+                    }
+                    else {
+                        ImGui::Text("%.3f", values[column]);
+                    }
+                }
+            }
+            ImGui::EndTable();
+        }
+
+        if (profiler.getSectionCount() > 0) {
+            plotSection = std::min(plotSection, profiler.getSectionCount() - 1);
+            if (ImGui::BeginCombo("Plot Section", profiler.getSectionName(plotSection))) {
+                for (int section = 0; section < profiler.getSectionCount(); ++section) {
+                    if (ImGui::Selectable(profiler.getSectionName(section), section == plotSection)) {
+                        plotSection = section;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            const Profiler::Stats cpu = profiler.getStats(plotSection, false);
+            const Profiler::Stats gpu = profiler.getStats(plotSection, true);
+            const float scale = std::max(std::max(cpu.p99, gpu.p99) * 1.5f, 0.1f);
+            profiler.copyHistory(plotSection, false, history);
+            profiler.copyHistory(plotSection, true, gpuHistory);
+            ImGui::PlotLines("CPU (ms)", history, Profiler::HistoryFrames, 0, nullptr, 0.0f, scale, ImVec2(0.0f, 50.0f));
+            ImGui::PlotLines("GPU (ms)", gpuHistory, Profiler::HistoryFrames, 0, nullptr, 0.0f, scale, ImVec2(0.0f, 50.0f));
+        }
+
+        if (ImGui::Button("Export Chrome Trace (F9)")) {
+            profiler.exportChromeTrace("frame_trace.json");
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("frame_trace.json");
+    }
+
     ImGui::End();
 
     ImGui::Render();
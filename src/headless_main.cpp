@@ -0,0 +1,352 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+
+#include "particle_simulation.h"
+#include "particle_effect.h"
+#include "script_parser.h"
+#include "particle_snapshot.h"
+
+// 无窗口模拟驱动：不创建OpenGL上下文，只测量物理更新本身的开销
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+        << "  --particles N     number of particles (default 12000)\n"
+        << "  --frames M        number of simulated frames (default 1000)\n"
+        << "  --dt SECONDS      fixed time step per frame (default 0.016)\n"
+        << "  --effect NAME     apply effect script NAME from the scripts directory\n"
+        << "  --scripts DIR     effect script directory (default scripts/)\n"
+        << "  --explode         trigger an explosion on the first frame (frees 500 slots for it)\n"
+        << "  --kernel ISA      force integrator kernel: scalar, sse2 or avx2 (default: best supported)\n"
+        << "  --threads N       simulation worker threads, 0 = all hardware threads (default 1)\n"
+        << "  --seed S          fixed random seed for reproducible runs\n"
+        << "  --self-gravity    enable Barnes-Hut self-gravity between disk particles\n"
+        << "  --theta T         Barnes-Hut opening angle (default 0.7)\n"
+        << "  --sph             enable SPH pressure/viscosity between disk particles\n"
+        << "  --integrator NAME euler or leapfrog (default leapfrog)\n"
+        << "  --substeps N      integration substeps per frame (default 1)\n"
+        << "  --block-steps     power-of-two block timesteps from the local dynamical time\n"
+        << "  --max-bin K       finest block timestep is dt / 2^K (default 5)\n"
+        << "  --kepler R        propagate particles beyond radius R on analytic Kepler orbits\n"
+        << "                    (only with --self-gravity or --sph)\n"
+        << "  --load-snapshot F resume from state snapshot F instead of spawning particles\n"
+        << "  --save-snapshot F write a state snapshot to F after the last frame\n"
+        << "  --record F        stream packed instances of every frame to recording F\n"
+        << "  --replay F        read back recording F and report its throughput, no simulation\n";
+}
+
+// 对全部粒子状态做FNV-1a哈希，用于比较两次运行是否逐位一致
+static uint64_t hashParticleState(const ParticleStore& particles) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+    };
+
+    const size_t n = particles.count();
+    mix(particles.posX.data(), n * sizeof(float));
+    mix(particles.posY.data(), n * sizeof(float));
+    mix(particles.posZ.data(), n * sizeof(float));
+    mix(particles.velX.data(), n * sizeof(float));
+    mix(particles.velY.data(), n * sizeof(float));
+    mix(particles.velZ.data(), n * sizeof(float));
+    mix(particles.life.data(), n * sizeof(float));
+    mix(particles.type.data(), n);
+    return hash;
+}
+
+// 顺序读取录制中的全部实例，测量映射文件的回放带宽
+static int replayRecording(const std::string& path) {
+    auto openStart = std::chrono::steady_clock::now();
+    SnapshotFile recording;
+    if (!recording.open(path) || recording.getKind() != SnapshotKind::Recording) {
+        std::cerr << "Not a recording: " << path << std::endl;
+        return -1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    // 每个实例都读一遍，和上传到GPU时一样触碰全部字节
+    double sum = 0.0;
+    size_t instances = 0;
+    for (size_t f = 0; f < recording.getFrameCount(); ++f) {
+        const SnapshotFile::Frame& frame = recording.getFrame(f);
+        for (size_t i = 0; i < frame.count; ++i) {
+            const ParticleInstance& instance = frame.instances[i];
+            sum += instance.position.x + instance.color.r + instance.size;
+        }
+        instances += frame.count;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double openMs = std::chrono::duration<double, std::milli>(start - openStart).count();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double bytes = static_cast<double>(instances) * sizeof(ParticleInstance);
+    std::cout << "Recording:          " << path << "\n"
+        << "Frames:             " << recording.getFrameCount() << "\n"
+        << "Instances:          " << instances << "\n"
+        << "Open:               " << openMs << " ms\n"
+        << "Replay:             " << seconds * 1000.0 << " ms\n"
+        << "Throughput:         " << bytes / seconds / 1e9 << " GB/s\n"
+        << "Checksum:           " << sum << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int particleCount = 12000;
+    int frameCount = 1000;
+    float deltaTime = 0.016f;
+    std::string effectName;
+    std::string scriptDirectory = "scripts/";
+    bool explode = false;
+    std::string kernelName;
+    int threadCount = 1;
+    bool hasSeed = false;
+    uint64_t seed = 0;
+    bool selfGravity = false;
+    float theta = 0.7f;
+    bool sph = false;
+    std::string integratorName;
+    int substeps = 1;
+    bool blockSteps = false;
+    int maxBin = 5;
+    float keplerRadius = 0.0f;
+    std::string loadSnapshotPath;
+    std::string saveSnapshotPath;
+    std::string recordPath;
+    std::string replayPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--particles" && hasValue) particleCount = std::atoi(argv[++i]);
+        else if (arg == "--frames" && hasValue) frameCount = std::atoi(argv[++i]);
+        else if (arg == "--dt" && hasValue) deltaTime = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--effect" && hasValue) effectName = argv[++i];
+        else if (arg == "--scripts" && hasValue) scriptDirectory = argv[++i];
+        else if (arg == "--explode") explode = true;
+        else if (arg == "--kernel" && hasValue) kernelName = argv[++i];
+        else if (arg == "--threads" && hasValue) threadCount = std::atoi(argv[++i]);
+        else if (arg == "--seed" && hasValue) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+            hasSeed = true;
+        }
+        else if (arg == "--self-gravity") selfGravity = true;
+        else if (arg == "--sph") sph = true;
+        else if (arg == "--theta" && hasValue) theta = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--integrator" && hasValue) integratorName = argv[++i];
+        else if (arg == "--substeps" && hasValue) substeps = std::atoi(argv[++i]);
+        else if (arg == "--block-steps") blockSteps = true;
+        else if (arg == "--max-bin" && hasValue) maxBin = std::atoi(argv[++i]);
+        else if (arg == "--kepler" && hasValue) keplerRadius = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--load-snapshot" && hasValue) loadSnapshotPath = argv[++i];
+        else if (arg == "--save-snapshot" && hasValue) saveSnapshotPath = argv[++i];
+        else if (arg == "--record" && hasValue) recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue) replayPath = argv[++i];
+        else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : -1;
+        }
+    }
+
+    if (particleCount <= 0 || frameCount <= 0 || substeps <= 0) {
+        std::cerr << "Particle, frame and substep counts must be positive" << std::endl;
+        return -1;
+    }
+
+    if (!replayPath.empty()) {
+        return replayRecording(replayPath);
+    }
+
+    // 从快照恢复时粒子数与全部参数都取自快照，命令行的物理选项不再生效
+    auto setupStart = std::chrono::steady_clock::now();
+    SnapshotFile snapshot;
+    if (!loadSnapshotPath.empty()) {
+        if (!snapshot.open(loadSnapshotPath) || snapshot.getKind() != SnapshotKind::State) {
+            std::cerr << "Not a state snapshot: " << loadSnapshotPath << std::endl;
+            return -1;
+        }
+        particleCount = static_cast<int>(snapshot.getParticleCount());
+    }
+    ParticleSimulation simulation(snapshot.isOpen() ? 0 : particleCount);
+
+    if (!effectName.empty() && !snapshot.isOpen()) {
+        ScriptParser scriptParser;
+        scriptParser.loadScripts(scriptDirectory);
+
+        bool found = false;
+        for (const auto& effect : scriptParser.getEffects()) {
+            if (effect.name == effectName) {
+                simulation.applyEffect(effect);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            std::cerr << "Effect not found: " << effectName << std::endl;
+            return -1;
+        }
+    }
+
+    if (!kernelName.empty()) {
+        KernelISA isa;
+        if (kernelName == "scalar") isa = KernelISA::Scalar;
+        else if (kernelName == "sse2") isa = KernelISA::SSE2;
+        else if (kernelName == "avx2") isa = KernelISA::AVX2;
+        else {
+            std::cerr << "Unknown kernel: " << kernelName << std::endl;
+            return -1;
+        }
+
+        if (!isKernelISASupported(isa)) {
+            std::cerr << "Kernel " << getKernelISAName(isa) << " is not supported on this CPU" << std::endl;
+            return -1;
+        }
+        simulation.setKernelISA(isa);
+    }
+
+    if (threadCount <= 0) {
+        threadCount = ThreadPool::getHardwareThreadCount();
+    }
+    simulation.setThreadCount(threadCount);
+
+    double restoreMs = 0.0;
+    if (snapshot.isOpen()) {
+        // 恢复只有一次从映射到模拟数组的复制
+        auto restoreStart = std::chrono::steady_clock::now();
+        snapshot.restore(simulation);
+        restoreMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - restoreStart).count();
+        deltaTime = simulation.getParameters().fixedTimeStep;
+        substeps = simulation.getParameters().substeps;
+        selfGravity = simulation.getParameters().enableSelfGravity;
+        sph = simulation.getParameters().enableSph;
+        blockSteps = simulation.getParameters().adaptiveTimeSteps;
+        keplerRadius = simulation.getParameters().enableKeplerFastPath ? simulation.getParameters().keplerCaptureRadius : 0.0f;
+    }
+    else {
+        if (hasSeed) {
+            simulation.setSeed(seed);
+        }
+
+        simulation.getParameters().enableSelfGravity = selfGravity;
+        simulation.getParameters().openingAngle = theta;
+        simulation.getParameters().enableSph = sph;
+
+        if (!integratorName.empty()) {
+            if (integratorName == "euler") simulation.getParameters().integrator = IntegratorType::SemiImplicitEuler;
+            else if (integratorName == "leapfrog") simulation.getParameters().integrator = IntegratorType::Leapfrog;
+            else {
+                std::cerr << "Unknown integrator: " << integratorName << std::endl;
+                return -1;
+            }
+        }
+
+        // 每帧恰好一个固定步，与墙钟时间无关
+        simulation.getParameters().fixedTimeStep = deltaTime;
+        simulation.getParameters().substeps = substeps;
+        simulation.getParameters().adaptiveTimeSteps = blockSteps;
+        simulation.getParameters().maxTimeBin = maxBin;
+        if (keplerRadius > 0.0f) {
+            simulation.getParameters().enableKeplerFastPath = true;
+            simulation.getParameters().keplerCaptureRadius = keplerRadius;
+            simulation.getParameters().keplerInnerRadius = keplerRadius * 0.5f;
+        }
+        simulation.setDeterministic(true);
+    }
+
+    if (keplerRadius > 0.0f && !simulation.isKeplerFastPathActive()) {
+        std::cerr << "--kepler has no effect without --self-gravity or --sph" << std::endl;
+    }
+
+    // 初始时粒子全部存活、空闲表为空，先腾出爆炸粒子所需的槽位，否则爆炸不生成任何粒子
+    if (explode) {
+        if (simulation.getFreeSlotCount() < ParticleSimulation::ExplosionParticles) {
+            simulation.retireParticles(0, ParticleSimulation::ExplosionParticles);
+        }
+        simulation.triggerExplosion();
+    }
+
+    SnapshotRecorder recorder;
+    if (!recordPath.empty()) {
+        recorder.start(recordPath, simulation);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frameCount; ++frame) {
+        simulation.advance(deltaTime);
+        recorder.recordFrame(simulation);
+    }
+    recorder.stop();
+    auto end = std::chrono::steady_clock::now();
+
+    double setupSeconds = std::chrono::duration<double>(start - setupStart).count();
+    double totalSeconds = std::chrono::duration<double>(end - start).count();
+    double particleSteps = static_cast<double>(particleCount) * frameCount;
+
+    std::cout << "Kernel:             " << getKernelISAName(simulation.getKernelISA()) << "\n"
+        << "Threads:            " << simulation.getThreadCount() << "\n"
+        << "Integrator:         "
+        << (simulation.getParameters().integrator == IntegratorType::Leapfrog ? "Leapfrog" : "Euler")
+        << " x" << substeps << "\n"
+        << "Particles:          " << particleCount << "\n"
+        << "Frames:             " << frameCount << "\n"
+        << "Setup:              " << setupSeconds * 1000.0 << " ms\n"
+        << "Total update time:  " << totalSeconds * 1000.0 << " ms\n"
+        << "Per frame:          " << totalSeconds * 1000.0 / frameCount << " ms\n"
+        << "Per particle:       " << totalSeconds * 1e9 / particleSteps << " ns\n"
+        << "Throughput:         " << particleSteps / totalSeconds / 1e6 << " M particle-steps/s\n"
+        << "Seed:               " << simulation.getSeed() << "\n";
+    if (selfGravity) {
+        std::cout << "Tree nodes:         " << simulation.getTreeNodeCount() << "\n"
+            << "Tree build:         " << simulation.getTreeBuildMs() << " ms (last frame)\n"
+            << "Tree traversal:     " << simulation.getTreeTraversalMs() << " ms (last frame)\n";
+    }
+    if (blockSteps) {
+        const BlockTimeStepper& stepper = simulation.getBlockTimeStepper();
+        std::cout << "Time bins:         ";
+        for (int bin = 0; bin <= stepper.getMaxBin(); ++bin) {
+            std::cout << " " << stepper.getBinCount(bin);
+        }
+        std::cout << " (last step)\n"
+            << "Force evaluations:  " << stepper.getForceEvaluations() << " vs "
+            << stepper.getUniformEvaluations() << " at finest step\n";
+    }
+    if (keplerRadius > 0.0f) {
+        std::cout << "Analytic particles: " << simulation.getAnalyticParticleCount() << " of "
+            << simulation.getParticleCount() << "\n"
+            << "Kepler solve:       " << simulation.getKeplerMs() << " ms (last frame, summed over chunks)\n";
+    }
+    if (sph) {
+        std::cout << "Grid build:         " << simulation.getGridBuildMs() << " ms (last frame)\n"
+            << "SPH forces:         " << simulation.getSphMs() << " ms (last frame)\n"
+            << "Avg neighbors:      " << simulation.getAverageNeighbors() << "\n";
+    }
+    if (snapshot.isOpen()) {
+        std::cout << "Snapshot restore:   " << restoreMs << " ms (" << snapshot.getFileBytes() / 1e6 << " MB, step "
+            << snapshot.getState().stepIndex << ")\n";
+    }
+    if (!recordPath.empty()) {
+        std::cout << "Recorded:           " << recorder.getFrameCount() << " frames, "
+            << recorder.getBytesWritten() / 1e6 << " MB" << (recorder.hasFailed() ? " (write failed)" : "") << "\n";
+    }
+    if (!saveSnapshotPath.empty()) {
+        SnapshotWriter writer;
+        auto saveStart = std::chrono::steady_clock::now();
+        writer.save(simulation, saveSnapshotPath);
+        writer.wait();
+        double saveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - saveStart).count();
+        if (writer.hasFailed()) {
+            std::cerr << "Failed to save snapshot " << saveSnapshotPath << std::endl;
+            return -1;
+        }
+        std::cout << "Snapshot save:      " << writer.getLastCopyMs() << " ms on the caller, "
+            << saveMs << " ms until written\n";
+    }
+    std::cout << "State checksum:     " << std::hex << hashParticleState(simulation.getParticles()) << std::dec << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "instance_buffer.h"
+#include <iostream>
+
+InstanceRingBuffer::InstanceRingBuffer(size_t bytes, bool allowPersistent)
+    : buffer(0), mappedMemory(nullptr), currentSegment(0) {
+    // 段大小按256字节对齐，满足各驱动对缓冲偏移的对齐要求
+    segmentBytes = (bytes + 255) & ~static_cast<size_t>(255);
+    for (int i = 0; i < SegmentCount; ++i) {
+        fences[i] = nullptr;
+    }
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    bool hasBufferStorage = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (allowPersistent && hasBufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, segmentBytes * SegmentCount, nullptr, flags);
+        mappedMemory = static_cast<unsigned char*>(
+            glMapBufferRange(GL_ARRAY_BUFFER, 0, segmentBytes * SegmentCount, flags));
+
+        if (!mappedMemory) {
+            // 映射失败时重建一个普通缓冲，glBufferStorage创建的存储不可再改变大小
+            std::cerr << "Persistent mapping failed, falling back to buffer orphaning" << std::endl;
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        }
+    }
+
+    if (!mappedMemory) {
+        glBufferData(GL_ARRAY_BUFFER, segmentBytes, nullptr, GL_STREAM_DRAW);
+        staging.resize(segmentBytes);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstanceRingBuffer::~InstanceRingBuffer() {
+    for (int i = 0; i < SegmentCount; ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+        }
+    }
+
+    if (mappedMemory) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void InstanceRingBuffer::waitForSegment(int segment) {
+    GLsync sync = fences[segment];
+    if (!sync) {
+        return;
+    }
+
+    // 第一次等待时刷新命令队列，否则栅栏可能永远不会被提交
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;) {
+        GLenum result = glClientWaitSync(sync, waitFlags, 1000000); // 1ms
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) {
+            break;
+        }
+        waitFlags = 0;
+    }
+
+    glDeleteSync(sync);
+    fences[segment] = nullptr;
+}
+
+void* InstanceRingBuffer::beginWrite() {
+    if (!mappedMemory) {
+        return staging.data();
+    }
+
+    currentSegment = (currentSegment + 1) % SegmentCount;
+    waitForSegment(currentSegment);
+    return mappedMemory + currentSegment * segmentBytes;
+}
+
+size_t InstanceRingBuffer::endWrite(size_t bytesWritten) {
+    if (mappedMemory) {
+        // 一致映射下写入对GPU自动可见，无需拷贝或刷新
+        return currentSegment * segmentBytes;
+    }
+
+    // 先孤立旧存储，驱动可以在GPU仍读取上一帧时分配新内存，避免隐式同步
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, segmentBytes, nullptr, GL_STREAM_DRAW);
+    if (bytesWritten > 0) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytesWritten, staging.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return 0;
+}
+
+void InstanceRingBuffer::fence() {
+    if (!mappedMemory) {
+        return;
+    }
+
+    if (fences[currentSegment]) {
+        glDeleteSync(fences[currentSegment]);
+    }
+    fences[currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
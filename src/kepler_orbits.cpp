@@ -0,0 +1,381 @@
+#include "kepler_orbits.h"
+#include "particle_simulation.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float Pi = 3.14159265358979323846f;
+const float TwoPi = 2.0f * Pi;
+
+// 推进时每次处理的轨道数，中间结果放在栈上，留在L1缓存中
+const size_t SubBatch = 256;
+
+// 就近取整：加减1.5·2^23把小数部分移出尾数，|x| < 2^22时成立，不产生分支或函数调用
+inline float roundNearest(float x) {
+    const float shifter = 12582912.0f;
+    return (x + shifter) - shifter;
+}
+
+// 无分支的sin/cos：按π/2取整归约到[-π/4, π/4]，再用多项式逼近，误差约1e-7
+inline void sinCos(float x, float& s, float& c) {
+    const float k = roundNearest(x * (2.0f / Pi));
+    const float r = (x - k * 1.5703125f) - k * 4.83826794897e-4f;
+    const float r2 = r * r;
+
+    const float sr = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    const float cr = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f
+        + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    // 按象限交换并取符号，用乘加代替选择以便向量化
+    const int quadrant = static_cast<int>(k);
+    const float odd = static_cast<float>(quadrant & 1);
+    const float sinSign = 1.0f - static_cast<float>(quadrant & 2);
+    const float cosSign = 1.0f - static_cast<float>((quadrant + 1) & 2);
+    s = sinSign * (sr + odd * (cr - sr));
+    c = cosSign * (cr + odd * (sr - cr));
+}
+
+// 一次牛顿迭代；修正量很小，用小角度旋转更新sin/cos，不再重新求三角函数
+inline void newtonCorrect(float& E, float& s, float& c, float e, float M) {
+    const float delta = -(E - e * s - M) / (1.0f - e * c);
+    const float cosDelta = 1.0f - 0.5f * delta * delta;
+    const float rotatedSin = s * cosDelta + c * delta;
+    const float rotatedCos = c * cosDelta - s * delta;
+    E = E + delta;
+    s = rotatedSin;
+    c = rotatedCos;
+}
+
+// 推进平近点角并解开普勒方程，更新偏近点角及其余弦，再由偏近点角求近焦点坐标系中的位置与速度，
+// 变换到世界坐标，同时算出寿命衰减与颜色。寿命衰减与着色公式与积分内核一致。
+// 参数都是互不重叠的连续数组，循环无分支，编译器可直接向量化
+void advanceOrbits(size_t count, float deltaTime,
+    float* __restrict meanAnomaly, float* __restrict eccentricAnomaly, float* __restrict cosAnomaly,
+    const float* __restrict meanMotion, const float* __restrict eccentricity, const float* __restrict semiMajor,
+    const float* __restrict periX, const float* __restrict periY, const float* __restrict periZ,
+    const float* __restrict normalX, const float* __restrict normalY, const float* __restrict normalZ,
+    float* __restrict outX, float* __restrict outY, float* __restrict outZ,
+    float* __restrict outVX, float* __restrict outVY, float* __restrict outVZ,
+    float* __restrict outRadius, float* __restrict outLifeLoss,
+    float* __restrict outR, float* __restrict outG, float* __restrict outB) {
+    for (size_t k = 0; k < count; ++k) {
+        const float e = eccentricity[k];
+        const float a = semiMajor[k];
+        const float motion = meanMotion[k];
+        const float dM = motion * deltaTime;
+        float M = meanAnomaly[k] + dM;
+
+        // 以上一步的解为起点：dE/dM = 1 / (1 - e·cosE)，每步只需一次sin/cos
+        float E = eccentricAnomaly[k] + dM / (1.0f - e * cosAnomaly[k]);
+
+        // 平近点角与偏近点角同时平移2π的整数倍，保持在[-π, π]附近
+        const float turns = roundNearest(M * (1.0f / TwoPi));
+        M = M - TwoPi * turns;
+        E = E - TwoPi * turns;
+
+        float sinE, cosE;
+        sinCos(E, sinE, cosE);
+
+        // 两次牛顿修正 E - e·sinE = M
+        newtonCorrect(E, sinE, cosE, e, M);
+        newtonCorrect(E, sinE, cosE, e, M);
+
+        meanAnomaly[k] = M;
+        eccentricAnomaly[k] = E;
+        cosAnomaly[k] = cosE;
+
+        const float b = a * std::sqrt(1.0f - e * e);
+        const float oneMinusECos = 1.0f - e * cosE;
+        const float u = a * (cosE - e);
+        const float w = b * sinE;
+        const float rate = motion / oneMinusECos; // dE/dt
+        const float du = -a * sinE * rate;
+        const float dw = b * cosE * rate;
+
+        const float vx = du * periX[k] + dw * normalX[k];
+        const float vy = du * periY[k] + dw * normalY[k];
+        const float vz = du * periZ[k] + dw * normalZ[k];
+        outX[k] = u * periX[k] + w * normalX[k];
+        outY[k] = u * periY[k] + w * normalY[k];
+        outZ[k] = u * periZ[k] + w * normalZ[k];
+        outVX[k] = vx;
+        outVY[k] = vy;
+        outVZ[k] = vz;
+
+        const float distance = a * oneMinusECos;
+        outRadius[k] = distance;
+        outLifeLoss[k] = deltaTime * (1.0f + 5.0f / (distance * distance + 0.1f));
+
+        const float speedFactor = std::sqrt(vx * vx + vy * vy + vz * vz) / 50.0f;
+        const float energyRelease = 1.0f / (distance + 0.5f);
+        outR[k] = std::min(std::max(0.5f + energyRelease * 0.5f, 0.0f), 1.0f);
+        outG[k] = std::min(std::max(0.3f + speedFactor * 0.5f, 0.0f), 1.0f);
+        outB[k] = std::min(std::max(1.0f - energyRelease * 0.3f, 0.0f), 1.0f);
+    }
+}
+
+}
+
+void KeplerPropagator::prepare(size_t particleCount, size_t size) {
+    if (size == blockSize && analytic.size() == particleCount) {
+        return;
+    }
+
+    blockSize = size;
+    analytic.assign(particleCount, 0);
+    counts.assign((particleCount + blockSize - 1) / blockSize, 0);
+    slot.resize(particleCount);
+    meanAnomaly.resize(particleCount);
+    eccentricAnomaly.resize(particleCount);
+    cosAnomaly.resize(particleCount);
+    meanMotion.resize(particleCount);
+    eccentricity.resize(particleCount);
+    semiMajor.resize(particleCount);
+    periX.resize(particleCount); periY.resize(particleCount); periZ.resize(particleCount);
+    normalX.resize(particleCount); normalY.resize(particleCount); normalZ.resize(particleCount);
+}
+
+void KeplerPropagator::capture(const ParticleStore& particles, size_t begin, size_t end,
+    const KeplerSettings& settings, uint64_t stepIndex) {
+    const size_t block = begin / blockSize;
+    const size_t base = block * blockSize;
+    const size_t middle = base + counts[block];
+    size_t k = middle;
+
+    const size_t phase = static_cast<size_t>((begin + stepIndex) % CaptureInterval);
+    for (size_t i = begin + (CaptureInterval - phase) % CaptureInterval; i < end; i += CaptureInterval) {
+        if (analytic[i] || particles.type[i] != 0 || particles.life[i] <= 0.0f) {
+            continue;
+        }
+
+        const glm::vec3 r = particles.position(i);
+        const float rLen = glm::length(r);
+        if (rLen <= settings.captureRadius) {
+            continue;
+        }
+
+        // 等效引力参数：在当前半径上与数值模型的向心加速度一致
+        const float mu = settings.blackHoleMass * (1.0f + 2.0f / (rLen + 0.5f));
+        const glm::vec3 v = particles.velocity(i);
+        const glm::vec3 h = glm::cross(r, v);
+        const float hLen = glm::length(h);
+        const float inverseA = 2.0f / rLen - glm::dot(v, v) / mu;
+        if (hLen <= 1e-6f || inverseA <= 0.0f) {
+            continue;
+        }
+
+        const float a = 1.0f / inverseA;
+        const glm::vec3 eVec = glm::cross(v, h) / mu - r / rLen;
+        float e = glm::length(eVec);
+        if (e >= settings.maxEccentricity || a * (1.0f - e) <= settings.innerRadius) {
+            continue;
+        }
+
+        // 近圆轨道以当前位置为近心点
+        glm::vec3 p;
+        float E;
+        if (e < 1e-4f) {
+            e = 0.0f;
+            p = r / rLen;
+            E = 0.0f;
+        }
+        else {
+            p = eVec / e;
+            E = std::atan2(glm::dot(r, v) / std::sqrt(mu * a), 1.0f - rLen / a);
+        }
+        const glm::vec3 q = glm::cross(h, p) / hLen;
+
+        analytic[i] = 1;
+        slot[k] = static_cast<uint32_t>(i);
+        meanAnomaly[k] = E - e * std::sin(E);
+        eccentricAnomaly[k] = E;
+        cosAnomaly[k] = std::cos(E);
+        meanMotion[k] = std::sqrt(mu / (a * a * a));
+        eccentricity[k] = e;
+        semiMajor[k] = a;
+        periX[k] = p.x; periY[k] = p.y; periZ[k] = p.z;
+        normalX[k] = q.x; normalY[k] = q.y; normalZ[k] = q.z;
+        ++k;
+    }
+    counts[block] = static_cast<uint32_t>(k - base);
+
+    // 新轨道按下标升序追加在段尾，与原有部分合并，保持整段有序
+    if (k > middle && middle > base && slot[middle - 1] > slot[middle]) {
+        mergeEntries(base, middle, k);
+    }
+}
+
+void KeplerPropagator::propagate(ParticleStore& particles, size_t begin, float deltaTime,
+    const KeplerSettings& settings) {
+    const size_t block = begin / blockSize;
+    const size_t base = block * blockSize;
+    const size_t last = base + counts[block];
+
+    float outX[SubBatch], outY[SubBatch], outZ[SubBatch];
+    float outVX[SubBatch], outVY[SubBatch], outVZ[SubBatch];
+    float outRadius[SubBatch], outLifeLoss[SubBatch];
+    float outR[SubBatch], outG[SubBatch], outB[SubBatch];
+
+    // 大多数步没有粒子离开，只有出现第一个被移除的项之后才开始搬移，且写入位置总不超过读取位置
+    size_t written = base;
+    for (size_t first = base; first < last; first += SubBatch) {
+        const size_t n = std::min(SubBatch, last - first);
+        advanceOrbits(n, deltaTime, meanAnomaly.data() + first, eccentricAnomaly.data() + first,
+            cosAnomaly.data() + first, meanMotion.data() + first, eccentricity.data() + first,
+            semiMajor.data() + first,
+            periX.data() + first, periY.data() + first, periZ.data() + first,
+            normalX.data() + first, normalY.data() + first, normalZ.data() + first,
+            outX, outY, outZ, outVX, outVY, outVZ, outRadius, outLifeLoss, outR, outG, outB);
+
+        // 散射回粒子存储
+        for (size_t k = 0; k < n; ++k) {
+            const uint32_t i = slot[first + k];
+            particles.posX[i] = outX[k]; particles.posY[i] = outY[k]; particles.posZ[i] = outZ[k];
+            particles.velX[i] = outVX[k]; particles.velY[i] = outVY[k]; particles.velZ[i] = outVZ[k];
+            particles.colorR[i] = outR[k]; particles.colorG[i] = outG[k]; particles.colorB[i] = outB[k];
+
+            const float life = particles.life[i] - outLifeLoss[k];
+            particles.life[i] = life;
+            if (outRadius[k] < settings.innerRadius || life <= 0.0f) {
+                analytic[i] = 0;
+                continue;
+            }
+            if (written != first + k) {
+                moveEntry(written, first + k);
+            }
+            ++written;
+        }
+    }
+    counts[block] = static_cast<uint32_t>(written - base);
+}
+
+void KeplerPropagator::releaseWithin(const ParticleStore& particles, float radius) {
+    const float radiusSq = radius * radius;
+    for (size_t block = 0; block < counts.size(); ++block) {
+        const size_t base = block * blockSize;
+        const size_t last = base + counts[block];
+        size_t written = base;
+        for (size_t k = base; k < last; ++k) {
+            const uint32_t i = slot[k];
+            const float x = particles.posX[i], y = particles.posY[i], z = particles.posZ[i];
+            if (x * x + y * y + z * z <= radiusSq) {
+                analytic[i] = 0;
+                continue;
+            }
+            if (written != k) {
+                moveEntry(written, k);
+            }
+            ++written;
+        }
+        counts[block] = static_cast<uint32_t>(written - base);
+    }
+}
+
+void KeplerPropagator::releaseAll() {
+    for (size_t block = 0; block < counts.size(); ++block) {
+        const size_t base = block * blockSize;
+        for (size_t k = base; k < base + counts[block]; ++k) {
+            analytic[slot[k]] = 0;
+        }
+        counts[block] = 0;
+    }
+}
+
+size_t KeplerPropagator::getAnalyticCount() const {
+    size_t total = 0;
+    for (uint32_t count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+KeplerOrbitArrays KeplerPropagator::getSegment(size_t segment) const {
+    const size_t base = segment * blockSize;
+    KeplerOrbitArrays result;
+    result.count = counts[segment];
+    result.slot = slot.data() + base;
+    result.meanAnomaly = meanAnomaly.data() + base;
+    result.eccentricAnomaly = eccentricAnomaly.data() + base;
+    result.cosAnomaly = cosAnomaly.data() + base;
+    result.meanMotion = meanMotion.data() + base;
+    result.eccentricity = eccentricity.data() + base;
+    result.semiMajor = semiMajor.data() + base;
+    result.periX = periX.data() + base; result.periY = periY.data() + base; result.periZ = periZ.data() + base;
+    result.normalX = normalX.data() + base; result.normalY = normalY.data() + base; result.normalZ = normalZ.data() + base;
+    return result;
+}
+
+void KeplerPropagator::assign(const KeplerOrbitArrays& source, size_t particleCount, size_t size) {
+    // 重新分配并清空所有分段
+    blockSize = 0;
+    prepare(particleCount, size);
+
+    // 各段首尾相接保存，按槽位所在块依次追加即可还原原来的段内顺序。
+    // 重复或越界的槽位直接跳过，保证每段不超过块内粒子数
+    for (size_t n = 0; n < source.count; ++n) {
+        const uint32_t i = source.slot[n];
+        if (i >= particleCount || analytic[i]) {
+            continue;
+        }
+
+        const size_t block = i / blockSize;
+        const size_t k = block * blockSize + counts[block]++;
+        analytic[i] = 1;
+        slot[k] = i;
+        meanAnomaly[k] = source.meanAnomaly[n];
+        eccentricAnomaly[k] = source.eccentricAnomaly[n];
+        cosAnomaly[k] = source.cosAnomaly[n];
+        meanMotion[k] = source.meanMotion[n];
+        eccentricity[k] = source.eccentricity[n];
+        semiMajor[k] = source.semiMajor[n];
+        periX[k] = source.periX[n]; periY[k] = source.periY[n]; periZ[k] = source.periZ[n];
+        normalX[k] = source.normalX[n]; normalY[k] = source.normalY[n]; normalZ[k] = source.normalZ[n];
+    }
+}
+
+void KeplerPropagator::moveEntry(size_t to, size_t from) {
+    slot[to] = slot[from];
+    meanAnomaly[to] = meanAnomaly[from];
+    eccentricAnomaly[to] = eccentricAnomaly[from];
+    cosAnomaly[to] = cosAnomaly[from];
+    meanMotion[to] = meanMotion[from];
+    eccentricity[to] = eccentricity[from];
+    semiMajor[to] = semiMajor[from];
+    periX[to] = periX[from]; periY[to] = periY[from]; periZ[to] = periZ[from];
+    normalX[to] = normalX[from]; normalY[to] = normalY[from]; normalZ[to] = normalZ[from];
+}
+
+void KeplerPropagator::mergeEntries(size_t begin, size_t middle, size_t end) {
+    // 原有部分中小于第一个新下标的前缀位置不变，只重排其后的部分
+    begin = std::upper_bound(slot.begin() + begin, slot.begin() + middle, slot[middle]) - slot.begin();
+
+    std::vector<uint32_t> order(end - begin);
+    size_t left = begin, right = middle;
+    for (uint32_t& source : order) {
+        if (right == end || (left < middle && slot[left] < slot[right])) {
+            source = static_cast<uint32_t>(left++);
+        }
+        else {
+            source = static_cast<uint32_t>(right++);
+        }
+    }
+
+    std::vector<uint32_t> mergedSlot(order.size());
+    for (size_t n = 0; n < order.size(); ++n) {
+        mergedSlot[n] = slot[order[n]];
+    }
+    std::copy(mergedSlot.begin(), mergedSlot.end(), slot.begin() + begin);
+
+    std::vector<float> merged(order.size());
+    std::vector<float>* arrays[] = {
+        &meanAnomaly, &eccentricAnomaly, &cosAnomaly, &meanMotion, &eccentricity, &semiMajor,
+        &periX, &periY, &periZ, &normalX, &normalY, &normalZ
+    };
+    for (std::vector<float>* values : arrays) {
+        for (size_t n = 0; n < order.size(); ++n) {
+            merged[n] = (*values)[order[n]];
+        }
+        std::copy(merged.begin(), merged.end(), values->begin() + begin);
+    }
+}
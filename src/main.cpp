@@ -1,4 +1,10 @@
 #include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <memory>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -10,7 +16,13 @@
 #include "imgui_impl_opengl3.h"
 #include "particle_system.h"
 #include "shader.h"
+#include "frame_uniforms.h"
+#include "profiler.h"
+#include "scene_benchmark.h"
 #include "camera.h"
+#include "camera_path.h"
+#include "frame_capture.h"
+#include "particle_snapshot.h"
 #include "gui.h"
 #include "script_parser.h"
 
@@ -22,6 +34,10 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// 默认帧缓冲的像素大小，由尺寸回调更新，渲染循环中不再查询
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
@@ -39,7 +55,186 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 void setupBlackHoleVAO();
 
-int main() {
+int main(int argc, char** argv) {
+    // 命令行参数：--threads N 设置模拟线程数，0表示使用全部硬件线程；--seed S 固定随机种子；
+    // --gpu 使用变换反馈的GPU模拟后端；--impostor 以朝向相机的四边形绘制粒子；
+    // --deterministic 固定种子（未指定时为0）且每帧只推进一个固定步，相同输入得到相同的粒子状态；
+    // --no-shader-cache 不读写shader_cache/下的程序二进制缓存；--particles N 粒子数；--effect NAME 启动时应用的特效；
+    // --record-path FILE 每0.1秒记录一个相机关键帧，退出时写入FILE；
+    // --benchmark PATH 场景基准：沿录制的相机路径以固定步长和种子运行固定帧数，不可见窗口、关闭垂直同步，
+    // 配合 --frames N、--dt S、--warmup N、--bench-out PREFIX 写出PREFIX.csv与PREFIX.json；
+    // --camera-path FILE 由录制的路径驱动相机；
+    // --capture DIR 把画面写成PNG序列，--capture-pipe CMD 把原始RGB24帧写入外部编码器，
+    // 配合 --capture-size WxH（离屏渲染分辨率）、--capture-fps F（离线模式，每帧推进1/F秒）、--capture-frames N；
+    // --load-snapshot FILE 从状态快照继续模拟（F5异步保存到snapshot.bhs）；
+    // --record FILE 把每帧打包好的实例流式写入FILE，--replay FILE 循环播放录制，不做模拟
+    int threadCount = 1;
+    int particleCount = 12000;
+    bool useGpuBackend = false;
+    bool useImpostors = false;
+    bool hasSeed = false;
+    bool deterministic = false;
+    bool useShaderCache = true;
+    unsigned long long seed = 0;
+    std::string recordPathFile;
+    std::string benchmarkPathFile;
+    std::string effectName;
+    std::string benchmarkOutput = "benchmark";
+    int benchmarkFrames = 0;
+    int warmupFrames = 30;
+    float benchmarkDeltaTime = 1.0f / 60.0f;
+    std::string cameraPathFile;
+    CaptureSettings captureSettings;
+    float captureFps = 0.0f;
+    int captureFrames = 0;
+    std::string loadSnapshotFile;
+    std::string recordFile;
+    std::string replayFile;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+            if (threadCount <= 0) {
+                threadCount = ThreadPool::getHardwareThreadCount();
+            }
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+            hasSeed = true;
+        }
+        else if (arg == "--gpu") {
+            useGpuBackend = true;
+        }
+        else if (arg == "--impostor") {
+            useImpostors = true;
+        }
+        else if (arg == "--deterministic") {
+            deterministic = true;
+        }
+        else if (arg == "--no-shader-cache") {
+            useShaderCache = false;
+        }
+        else if (arg == "--particles" && i + 1 < argc) {
+            particleCount = std::atoi(argv[++i]);
+        }
+        else if (arg == "--record-path" && i + 1 < argc) {
+            recordPathFile = argv[++i];
+        }
+        else if (arg == "--benchmark" && i + 1 < argc) {
+            benchmarkPathFile = argv[++i];
+        }
+        else if (arg == "--effect" && i + 1 < argc) {
+            effectName = argv[++i];
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            benchmarkFrames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--dt" && i + 1 < argc) {
+            benchmarkDeltaTime = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--warmup" && i + 1 < argc) {
+            warmupFrames = std::max(std::atoi(argv[++i]), 0);
+        }
+        else if (arg == "--bench-out" && i + 1 < argc) {
+            benchmarkOutput = argv[++i];
+        }
+        else if (arg == "--camera-path" && i + 1 < argc) {
+            cameraPathFile = argv[++i];
+        }
+        else if (arg == "--capture" && i + 1 < argc) {
+            captureSettings.output = CaptureOutput::PngSequence;
+            captureSettings.target = argv[++i];
+        }
+        else if (arg == "--capture-pipe" && i + 1 < argc) {
+            captureSettings.output = CaptureOutput::Pipe;
+            captureSettings.target = argv[++i];
+        }
+        else if (arg == "--capture-size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &captureSettings.width, &captureSettings.height) != 2
+                || captureSettings.width <= 0 || captureSettings.height <= 0) {
+                std::cerr << "Capture size must look like 1920x1080" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg == "--capture-fps" && i + 1 < argc) {
+            captureFps = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--capture-frames" && i + 1 < argc) {
+            captureFrames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--load-snapshot" && i + 1 < argc) {
+            loadSnapshotFile = argv[++i];
+        }
+        else if (arg == "--record" && i + 1 < argc) {
+            recordFile = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            replayFile = argv[++i];
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            std::cerr << "Usage: " << argv[0] << " [--threads N] [--seed S] [--gpu] [--impostor] [--deterministic] [--no-shader-cache]"
+                << " [--particles N] [--effect NAME] [--record-path FILE] [--camera-path FILE]"
+                << " [--benchmark PATH [--frames N] [--dt S] [--warmup N] [--bench-out PREFIX]]"
+                << " [--capture DIR | --capture-pipe CMD] [--capture-size WxH] [--capture-fps F] [--capture-frames N]"
+                << " [--load-snapshot FILE] [--record FILE] [--replay FILE]" << std::endl;
+            return -1;
+        }
+    }
+
+    if (particleCount <= 0 || benchmarkDeltaTime <= 0.0f) {
+        std::cerr << "Particle count and time step must be positive" << std::endl;
+        return -1;
+    }
+
+    // 快照与录制文件只做映射，粒子数取自文件，渲染缓冲据此分配
+    SnapshotFile snapshot;
+    if (!loadSnapshotFile.empty()) {
+        if (!snapshot.open(loadSnapshotFile) || snapshot.getKind() != SnapshotKind::State) {
+            std::cerr << "Not a state snapshot: " << loadSnapshotFile << std::endl;
+            return -1;
+        }
+        particleCount = static_cast<int>(snapshot.getParticleCount());
+    }
+    SnapshotFile replay;
+    if (!replayFile.empty()) {
+        if (!replay.open(replayFile) || replay.getKind() != SnapshotKind::Recording || replay.getFrameCount() == 0) {
+            std::cerr << "Not a recording: " << replayFile << std::endl;
+            return -1;
+        }
+        particleCount = static_cast<int>(replay.getParticleCount());
+        if (useGpuBackend) {
+            std::cout << "Replay uploads recorded instances, ignoring --gpu" << std::endl;
+            useGpuBackend = false;
+        }
+    }
+
+    // 基准模式：每帧一个固定步、固定种子，相机只由路径驱动，逐帧计时写入文件
+    const bool benchmark = !benchmarkPathFile.empty();
+    CameraPath cameraPath;
+    if (benchmark) {
+        if (!cameraPath.load(benchmarkPathFile)) {
+            return -1;
+        }
+        if (benchmarkFrames <= 0) {
+            benchmarkFrames = static_cast<int>(cameraPath.getDuration() / benchmarkDeltaTime) + 1;
+        }
+        deterministic = true;
+    }
+    else if (!cameraPathFile.empty() && !cameraPath.load(cameraPathFile)) {
+        return -1;
+    }
+
+    // 离线捕获：模拟时间只按帧推进，与渲染和编码耗时无关，可以快于或慢于实时
+    const bool capturing = !captureSettings.target.empty();
+    captureSettings.offline = capturing && captureFps > 0.0f;
+    if (captureSettings.offline) {
+        deterministic = true;
+    }
+    const float fixedDeltaTime = benchmark ? benchmarkDeltaTime : (captureSettings.offline ? 1.0f / captureFps : 0.0f);
+    // 0表示不限帧数
+    const int frameLimit = benchmark ? warmupFrames + benchmarkFrames : (capturing ? std::max(captureFrames, 0) : 0);
+
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
@@ -48,6 +243,10 @@ int main() {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (benchmark) {
+        // 不可见窗口仍有默认帧缓冲，可在无显示器的CI机器（Xvfb + Mesa）上运行
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Advanced Black Hole Particle System", nullptr, nullptr);
     if (!window) {
@@ -57,6 +256,10 @@ int main() {
     }
 
     glfwMakeContextCurrent(window);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    if (fixedDeltaTime > 0.0f) {
+        glfwSwapInterval(0);
+    }
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
@@ -76,29 +279,175 @@ int main() {
     std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
     std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
-    setupBlackHoleVAO();
-    ParticleSystem particleSystem(12000);
-
+    // 先提交编译，驱动支持并行编译时与后面的初始化重叠进行；第一次使用时才等待结果
     std::cout << "Loading shaders..." << std::endl;
+    double shaderStart = glfwGetTime();
+    Shader::initialize(useShaderCache ? "shader_cache" : "");
     Shader particleShader("shaders/particle.vs", "shaders/particle.fs");
+    Shader particleImpostorShader("shaders/particle_impostor.vs", "shaders/particle_impostor.fs");
     Shader blackHoleShader("shaders/blackhole.vs", "shaders/blackhole.fs");
+    double shaderSubmitMs = (glfwGetTime() - shaderStart) * 1000.0;
+
+    setupBlackHoleVAO();
+    ParticleSystem particleSystem(particleCount);
+    particleSystem.getSimulation().setThreadCount(threadCount);
+    if (hasSeed || deterministic) {
+        particleSystem.getSimulation().setSeed(seed);
+    }
+    particleSystem.getSimulation().setDeterministic(deterministic);
+    if (useGpuBackend) {
+        particleSystem.setBackend(SimulationBackend::GPU);
+    }
+    if (useImpostors) {
+        particleSystem.setRenderMode(ParticleRenderMode::Impostor);
+    }
 
     GUI gui(window, camera);
     ScriptParser scriptParser;
     scriptParser.loadScripts("scripts/");
+    std::vector<std::string> changedEffects;
+
+    if (!effectName.empty()) {
+        const ParticleEffect* effect = scriptParser.findEffect(effectName);
+        if (!effect) {
+            std::cerr << "Effect not found: " << effectName << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        // 特效会改变吸积盘半径，用同一种子重新生成粒子
+        particleSystem.applyEffect(*effect);
+        particleSystem.getSimulation().setSeed(particleSystem.getSimulation().getSeed());
+    }
+    if (fixedDeltaTime > 0.0f) {
+        particleSystem.getSimulation().getParameters().fixedTimeStep = fixedDeltaTime;
+        particleSystem.getSimulation().setSeed(seed);
+    }
+    if (snapshot.isOpen()) {
+        double restoreStart = glfwGetTime();
+        snapshot.restore(particleSystem.getSimulation());
+        std::cout << "Restored " << particleCount << " particles at step " << snapshot.getState().stepIndex
+            << " from " << loadSnapshotFile << " in " << (glfwGetTime() - restoreStart) * 1000.0 << " ms" << std::endl;
+        snapshot.close();
+    }
+    if (!benchmark) {
+        scriptParser.startWatching();
+    }
+
+    // F5保存状态快照；调用线程只复制一次粒子数组，写盘在后台进行
+    SnapshotWriter snapshotWriter;
+    bool snapshotKeyDown = false;
+    SnapshotRecorder recorder;
+    if (!recordFile.empty()) {
+        if (particleSystem.getBackend() == SimulationBackend::GPU) {
+            std::cerr << "Recording needs the CPU simulation backend" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        recorder.start(recordFile, particleSystem.getSimulation());
+    }
+
+    // 相机与光照参数每帧上传一次，三个程序共享。
+    // 程序在帧循环中isReady()之后才连接uniform块并参与绘制，链接未完成的帧跳过对应的绘制；
+    // 基准与捕获要求每一帧画面完整，进入循环前等待全部链接
+    FrameUniformBuffer frameUniformBuffer;
+    FrameUniforms frameUniforms = {};
+    struct PendingProgram {
+        Shader* shader;
+        bool attached;
+    };
+    PendingProgram programs[] = { { &particleShader, false }, { &particleImpostorShader, false }, { &blackHoleShader, false } };
+    int attachedPrograms = 0;
+    auto attachReadyPrograms = [&](bool wait) {
+        for (PendingProgram& program : programs) {
+            if (program.attached || (!wait && !program.shader->isReady())) {
+                continue;
+            }
+            frameUniformBuffer.attach(*program.shader);
+            program.attached = true;
+            if (++attachedPrograms == 3) {
+                int cachedPrograms = particleShader.isFromBinaryCache() + particleImpostorShader.isFromBinaryCache()
+                    + blackHoleShader.isFromBinaryCache();
+                std::cout << "Shaders: submit " << shaderSubmitMs << " ms, all linked after "
+                    << (glfwGetTime() - shaderStart) * 1000.0 << " ms (" << cachedPrograms << "/3 from binary cache)" << std::endl;
+            }
+        }
+    };
+    auto isAttached = [&](const Shader& shader) {
+        for (const PendingProgram& program : programs) {
+            if (program.shader == &shader) {
+                return program.attached;
+            }
+        }
+        return false;
+    };
+    if (benchmark || capturing) {
+        attachReadyPrograms(true);
+    }
+    // 各段的CPU/GPU耗时，F9导出Chrome trace
+    Profiler profiler;
+    bool traceKeyDown = false;
+
+    SceneBenchmark sceneBenchmark;
+    int frameNumber = 0;
+    if (benchmark) {
+        profiler.setWaitForGpuResults(true);
+        sceneBenchmark.setFirstFrame(warmupFrames);
+        std::cout << "Benchmark: " << benchmarkFrames << " frames (+" << warmupFrames << " warm-up) along "
+            << benchmarkPathFile << ", dt " << benchmarkDeltaTime << " s, seed " << seed << std::endl;
+    }
+
+    std::unique_ptr<FrameCapture> capture;
+    if (capturing) {
+        capture = std::make_unique<FrameCapture>(captureSettings, framebufferWidth, framebufferHeight);
+        if (!capture->isOpen()) {
+            glfwTerminate();
+            return -1;
+        }
+    }
+
+    CameraPath recordedPath;
+    double loopStart = glfwGetTime();
     std::cout << "Starting main loop..." << std::endl;
 
-    while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+    while (!glfwWindowShouldClose(window) && (frameLimit == 0 || frameNumber < frameLimit)) {
+        profiler.beginFrame();
 
-        // 限制deltaTime
-        if (deltaTime > 0.1f) {
-            deltaTime = 0.1f;
+        if (fixedDeltaTime > 0.0f) {
+            deltaTime = fixedDeltaTime;
         }
+        else {
+            float currentFrame = glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            // 限制deltaTime
+            if (deltaTime > 0.1f) {
+                deltaTime = 0.1f;
+            }
+        }
+
+        if (!benchmark) {
+            processInput(window);
 
-        processInput(window);
+            if (!recordPathFile.empty()) {
+                const float recordTime = static_cast<float>(glfwGetTime() - loopStart);
+                if (recordedPath.empty() || recordTime - recordedPath.getDuration() >= 0.1f) {
+                    recordedPath.addKeyframe(recordTime, camera);
+                }
+            }
+        }
+
+        if (!cameraPath.empty()) {
+            // 固定步长时路径时间按帧计算，基准的预热帧停在路径起点
+            const float pathTime = fixedDeltaTime > 0.0f
+                ? std::max(frameNumber - (benchmark ? warmupFrames : 0), 0) * fixedDeltaTime
+                : static_cast<float>(glfwGetTime() - loopStart);
+            cameraPath.apply(camera, pathTime);
+        }
+
+        if (capture) {
+            capture->beginFrame();
+        }
         glClearColor(0.01f, 0.01f, 0.02f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -107,32 +456,172 @@ int main() {
             std::cout << "OpenGL error before rendering: " << error << std::endl;
         }
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+        const float aspect = capture && capture->usesOffscreenTarget()
+            ? (float)capture->getWidth() / (float)capture->getHeight() : (float)SCR_WIDTH / (float)SCR_HEIGHT;
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, 1000.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        particleSystem.update(deltaTime, camera.Position);
-        particleSystem.render(particleShader, projection, view, camera.Position);
+        // 监视线程已完成解析，这里只合并结果；正在使用的特效被修改后立即生效
+        scriptParser.pollUpdates(changedEffects);
+        for (const std::string& name : changedEffects) {
+            const ParticleEffect* effect = name == gui.getActiveEffect() ? scriptParser.findEffect(name) : nullptr;
+            if (effect) {
+                particleSystem.applyEffect(*effect);
+            }
+        }
 
-        blackHoleShader.use();
-        blackHoleShader.setMat4("projection", projection);
-        blackHoleShader.setMat4("view", view);
-        blackHoleShader.setVec3("viewPos", camera.Position);
+        if (!replay.isOpen()) {
+            ProfileScope scope(profiler, "Update");
+            particleSystem.update(deltaTime, camera.Position);
+            recorder.recordFrame(particleSystem.getSimulation());
+        }
 
-        glBindVertexArray(blackHoleVAO);
-        glDrawArrays(GL_POINTS, 0, 1);
-        glBindVertexArray(0);
+        {
+            ProfileScope scope(profiler, "Upload");
+            frameUniforms.projection = projection;
+            frameUniforms.view = view;
+            frameUniforms.viewPos = camera.Position;
+            particleSystem.fillLightUniforms(frameUniforms);
+            frameUniformBuffer.update(frameUniforms);
+            if (replay.isOpen()) {
+                // 每个渲染帧播放一帧录制，播完从头循环
+                const SnapshotFile::Frame& frame = replay.getFrame(frameNumber % replay.getFrameCount());
+                particleSystem.prepareReplay(frame.instances, frame.count);
+            }
+            else {
+                const int viewportHeight = capture && capture->usesOffscreenTarget() ? capture->getHeight() : framebufferHeight;
+                particleSystem.prepareRender(projection, view, camera.Position, static_cast<float>(viewportHeight));
+            }
+        }
 
-        ImGuiIO& io = ImGui::GetIO();
-        imguiWantCaptureMouse = io.WantCaptureMouse;
-        gui.render(particleSystem, scriptParser);
+        // 不阻塞地检查还在后台链接的程序
+        if (attachedPrograms < 3) {
+            attachReadyPrograms(false);
+        }
+
+        {
+            ProfileScope scope(profiler, "Particles");
+            Shader& activeParticleShader = particleSystem.getRenderMode() == ParticleRenderMode::Impostor
+                ? particleImpostorShader : particleShader;
+            if (isAttached(activeParticleShader)) {
+                particleSystem.render(activeParticleShader);
+            }
+        }
+
+        if (isAttached(blackHoleShader)) {
+            ProfileScope scope(profiler, "Black Hole");
+            blackHoleShader.use();
+
+            glBindVertexArray(blackHoleVAO);
+            glDrawArrays(GL_POINTS, 0, 1);
+            glBindVertexArray(0);
+        }
+
+        // 在界面之前读回，捕获的画面不含界面
+        if (capture) {
+            ProfileScope scope(profiler, "Capture");
+            capture->endFrame(framebufferWidth, framebufferHeight);
+        }
+
+        // 基准模式不绘制界面，只测场景本身
+        if (!benchmark) {
+            ProfileScope scope(profiler, "GUI");
+            ImGuiIO& io = ImGui::GetIO();
+            imguiWantCaptureMouse = io.WantCaptureMouse;
+            gui.render(particleSystem, scriptParser, profiler);
+        }
+
+        bool traceKeyPressed = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+        if (traceKeyPressed && !traceKeyDown) {
+            const char* tracePath = "frame_trace.json";
+            if (profiler.exportChromeTrace(tracePath)) {
+                std::cout << "Wrote " << tracePath << std::endl;
+            }
+        }
+        traceKeyDown = traceKeyPressed;
+
+        bool snapshotKeyPressed = glfwGetKey(window, GLFW_KEY_F5) == GLFW_PRESS;
+        if (snapshotKeyPressed && !snapshotKeyDown && !replay.isOpen()) {
+            if (particleSystem.getBackend() == SimulationBackend::CPU) {
+                snapshotWriter.save(particleSystem.getSimulation(), "snapshot.bhs");
+                std::cout << "Saving snapshot.bhs (" << snapshotWriter.getLastCopyMs() << " ms on the render thread)" << std::endl;
+            }
+            else {
+                std::cout << "Snapshots need the CPU simulation backend" << std::endl;
+            }
+        }
+        snapshotKeyDown = snapshotKeyPressed;
 
         error = glGetError();
         if (error != GL_NO_ERROR) {
             std::cout << "OpenGL error after rendering: " << error << std::endl;
         }
 
-        glfwSwapBuffers(window);
+        {
+            // 开启垂直同步时这里包含等待显示的时间
+            ProfileScope scope(profiler, "Present");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
+
+        profiler.endFrame();
+        if (benchmark) {
+            sceneBenchmark.collect(profiler, false);
+        }
+        ++frameNumber;
+    }
+
+    int exitCode = 0;
+    if (benchmark) {
+        profiler.finish();
+        sceneBenchmark.collect(profiler, true);
+
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        SceneBenchmarkInfo info;
+        info.effect = effectName;
+        info.cameraPath = benchmarkPathFile;
+        info.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        info.backend = particleSystem.getBackend() == SimulationBackend::GPU ? "gpu" : "cpu";
+        info.renderMode = getRenderModeName(particleSystem.getRenderMode());
+        info.width = width;
+        info.height = height;
+        info.particles = particleCount;
+        info.warmupFrames = warmupFrames;
+        info.deltaTime = benchmarkDeltaTime;
+        info.seed = seed;
+
+        const std::string csvPath = benchmarkOutput + ".csv";
+        const std::string jsonPath = benchmarkOutput + ".json";
+        if (sceneBenchmark.writeCsv(csvPath, profiler, info) && sceneBenchmark.writeJson(jsonPath, profiler, info)) {
+            std::cout << "Frame CPU p50 " << sceneBenchmark.getPercentile(-1, false, 50.0f)
+                << " ms, p99 " << sceneBenchmark.getPercentile(-1, false, 99.0f)
+                << " ms; GPU p50 " << sceneBenchmark.getPercentile(-1, true, 50.0f)
+                << " ms, p99 " << sceneBenchmark.getPercentile(-1, true, 99.0f) << " ms" << std::endl;
+            std::cout << "Wrote " << csvPath << " and " << jsonPath << std::endl;
+        }
+        else {
+            std::cerr << "Failed to write " << csvPath << " / " << jsonPath << std::endl;
+            exitCode = -1;
+        }
+    }
+
+    if (capture) {
+        capture->finish();
+        if (capture->getDroppedFrames() > 0 && !captureSettings.offline) {
+            std::cout << "Frames were dropped because the writer fell behind; use --capture-fps for lossless capture" << std::endl;
+        }
+        capture.reset();
+    }
+
+    if (recorder.isRecording()) {
+        recorder.stop();
+        std::cout << "Recorded " << recorder.getFrameCount() << " frames (" << recorder.getBytesWritten() / (1024 * 1024)
+            << " MB) to " << recordFile << (recorder.hasFailed() ? ", write failed" : "") << std::endl;
+    }
+    snapshotWriter.wait();
+
+    if (!recordPathFile.empty() && recordedPath.save(recordPathFile)) {
+        std::cout << "Wrote " << recordedPath.getKeyframeCount() << " camera keyframes to " << recordPathFile << std::endl;
     }
 
     glDeleteVertexArrays(1, &blackHoleVAO);
@@ -140,7 +629,7 @@ int main() {
 
     gui.cleanup();
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
 
 void setupBlackHoleVAO() {
@@ -228,5 +717,7 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    framebufferWidth = width;
+    framebufferHeight = height;
     glViewport(0, 0, width, height);
 }
\ No newline at end of file
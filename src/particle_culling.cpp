@@ -0,0 +1,156 @@
+#include "particle_culling.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const uint8_t FrustumCulled = 0xFF;
+    const uint8_t HorizonCulled = 0xFE;
+    const uint8_t Dead = 0xFD;
+
+    // 粒子完全位于黑洞球体之后：视线穿过球体，且粒子在球体出射面之后
+    bool isBehindHorizon(const glm::vec3& cameraPosition, const glm::vec3& position,
+        float radius, float horizonRadius) {
+        glm::vec3 toParticle = position - cameraPosition;
+        float particleDistance = glm::length(toParticle);
+        if (particleDistance <= 0.0f) {
+            return false;
+        }
+        glm::vec3 dir = toParticle / particleDistance;
+
+        // 黑洞中心在视线上的投影
+        float along = glm::dot(-cameraPosition, dir);
+        if (along <= 0.0f) {
+            return false;
+        }
+
+        float perpSq = glm::dot(cameraPosition, cameraPosition) - along * along;
+        float margin = horizonRadius - radius;
+        if (margin <= 0.0f || perpSq >= margin * margin) {
+            return false;
+        }
+
+        float exitDistance = along + std::sqrt(horizonRadius * horizonRadius - perpSq);
+        return particleDistance - radius > exitDistance;
+    }
+}
+
+CullingView CullingView::fromCamera(const glm::mat4& projection, const glm::mat4& view,
+    const glm::vec3& cameraPosition, float viewportHeight, float horizonRadius) {
+    CullingView result;
+
+    // Gribb-Hartmann：从裁剪矩阵的行组合出六个平面
+    glm::mat4 m = projection * view;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    result.frustumPlanes[0] = row3 + row0; // 左
+    result.frustumPlanes[1] = row3 - row0; // 右
+    result.frustumPlanes[2] = row3 + row1; // 下
+    result.frustumPlanes[3] = row3 - row1; // 上
+    result.frustumPlanes[4] = row3 + row2; // 近
+    result.frustumPlanes[5] = row3 - row2; // 远
+
+    for (glm::vec4& plane : result.frustumPlanes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    result.cameraPosition = cameraPosition;
+    result.pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+    result.horizonRadius = horizonRadius;
+
+    // 8x8、6x6、4x4网格与最粗的八面体
+    result.lodMinPixels[0] = 12.0f;
+    result.lodMinPixels[1] = 5.0f;
+    result.lodMinPixels[2] = 2.0f;
+    result.lodMinPixels[3] = 0.0f;
+    return result;
+}
+
+size_t CullingStats::totalDrawn() const {
+    size_t total = 0;
+    for (int lod = 0; lod < ParticleLodCount; ++lod) {
+        total += drawn[lod];
+    }
+    return total;
+}
+
+size_t cullAndPackInstances(const ParticleStore& particles, const RenderInterpolation& interpolation,
+    const CullingView& view,
+    std::vector<uint8_t>& lodScratch, ParticleInstance* out, CullingStats& stats) {
+    const size_t count = particles.count();
+    lodScratch.resize(count);
+
+    stats.deadSkipped = 0;
+    stats.frustumCulled = 0;
+    stats.horizonCulled = 0;
+    for (int lod = 0; lod < ParticleLodCount; ++lod) {
+        stats.drawn[lod] = 0;
+    }
+
+    // 第一遍：分类并统计各桶大小
+    for (size_t i = 0; i < count; ++i) {
+        if (particles.life[i] <= 0.0f) {
+            lodScratch[i] = Dead;
+            ++stats.deadSkipped;
+            continue;
+        }
+
+        glm::vec3 position = interpolation.position(particles, i);
+        float radius = particles.size[i];
+
+        bool inside = true;
+        for (const glm::vec4& plane : view.frustumPlanes) {
+            if (glm::dot(glm::vec3(plane), position) + plane.w < -radius) {
+                inside = false;
+                break;
+            }
+        }
+        if (!inside) {
+            lodScratch[i] = FrustumCulled;
+            ++stats.frustumCulled;
+            continue;
+        }
+
+        if (view.horizonRadius > 0.0f
+            && isBehindHorizon(view.cameraPosition, position, radius, view.horizonRadius)) {
+            lodScratch[i] = HorizonCulled;
+            ++stats.horizonCulled;
+            continue;
+        }
+
+        float distance = glm::length(position - view.cameraPosition);
+        float projectedPixels = radius * view.pixelsPerUnit / std::max(distance, 1e-3f);
+
+        int lod = 0;
+        while (lod < ParticleLodCount - 1 && projectedPixels < view.lodMinPixels[lod]) {
+            ++lod;
+        }
+        lodScratch[i] = static_cast<uint8_t>(lod);
+        ++stats.drawn[lod];
+    }
+
+    size_t cursor[ParticleLodCount];
+    size_t offset = 0;
+    for (int lod = 0; lod < ParticleLodCount; ++lod) {
+        stats.lodOffset[lod] = offset;
+        cursor[lod] = offset;
+        offset += stats.drawn[lod];
+    }
+
+    // 第二遍：按桶写入实例
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t lod = lodScratch[i];
+        if (lod >= ParticleLodCount) {
+            continue;
+        }
+
+        ParticleInstance& instance = out[cursor[lod]++];
+        instance.position = interpolation.position(particles, i);
+        instance.color = glm::vec3(particles.colorR[i], particles.colorG[i], particles.colorB[i]);
+        instance.size = particles.size[i];
+    }
+
+    return offset;
+}
@@ -0,0 +1,223 @@
+#include "particle_kernels.h"
+#include "random.h"
+#include <cmath>
+
+#if defined(BLACKHOLE_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// 与SIMD中max/min指令的语义一致：max(v, 0)在v不大于0时返回0
+static inline float clampUnit(float v) {
+    v = v > 0.0f ? v : 0.0f;
+    return v < 1.0f ? v : 1.0f;
+}
+
+void integrateParticlesScalar(const IntegrationBatch& b, const IntegrationConstants& c,
+    size_t begin, size_t end) {
+    const float dt = c.deltaTime;
+    const float halfDt = 0.5f * dt;
+
+    for (size_t i = begin; i < end; ++i) {
+        const int type = b.type[i];
+        float life = b.life[i];
+
+        // 待重生的正常粒子本帧不参与积分
+        if (type == 0 && life <= 0.0f) {
+            continue;
+        }
+        if (b.analytic && b.analytic[i]) {
+            continue;
+        }
+
+        float x = b.posX[i], y = b.posY[i], z = b.posZ[i];
+        float vx = b.velX[i], vy = b.velY[i], vz = b.velZ[i];
+
+        // 蛙跳：先用旧速度漂移半步，之后的受力都在半步位置处计算
+        if (c.leapfrog) {
+            x = x + vx * halfDt;
+            y = y + vy * halfDt;
+            z = z + vz * halfDt;
+        }
+
+        // 计算到黑洞的距离
+        float distSq = x * x + y * y + z * z;
+        float distance = std::sqrt(distSq);
+
+        if (type == 0 && distance < 0.5f) {
+            // 粒子被黑洞吞噬
+            b.life[i] = 0.0f;
+            continue;
+        }
+
+        float invDistance = 1.0f / distance;
+        float gx = -x * invDistance;
+        float gy = -y * invDistance;
+        float gz = -z * invDistance;
+
+        // 牛顿引力 + 相对论经验修正
+        float gravity = c.blackHoleMass / distSq;
+        float relFactor = 1.0f + 2.0f / (distance + 0.5f);
+        float pull = gravity * relFactor;
+
+        // 螺旋吸积效应 cross(g, up) = (-gz, 0, gx)
+        float sx = -gz * c.spiralStrength;
+        float sz = gx * c.spiralStrength;
+
+        // 湍流效应
+        const uint32_t noiseIndex = b.noiseIndex ? b.noiseIndex[i] : static_cast<uint32_t>(i);
+        uint32_t noise[4] = { noiseIndex, c.noiseStream[0], c.noiseStream[1],
+            static_cast<uint32_t>(RandomDomain::Turbulence) };
+        philox::generate(noise, c.noiseKey[0], c.noiseKey[1]);
+        float tx = (philox::toUnitFloat(noise[0]) - 0.5f) * 2.0f * c.turbulenceStrength;
+        float ty = (philox::toUnitFloat(noise[1]) - 0.5f) * 2.0f * c.turbulenceStrength;
+        float tz = (philox::toUnitFloat(noise[2]) - 0.5f) * 2.0f * c.turbulenceStrength;
+
+        float ax = gx * pull + sx + tx;
+        float ay = gy * pull + ty;
+        float az = gz * pull + sz + tz;
+
+        if (b.accelX) {
+            ax = ax + b.accelX[i];
+            ay = ay + b.accelY[i];
+            az = az + b.accelZ[i];
+        }
+
+        // 只有正常粒子受黑洞引力影响
+        if (type == 0) {
+            vx = vx + ax * dt;
+            vy = vy + ay * dt;
+            vz = vz + az * dt;
+        }
+
+        // 速度限制
+        float speedSq = vx * vx + vy * vy + vz * vz;
+        if (speedSq > 10000.0f) {
+            float scale = 100.0f / std::sqrt(speedSq);
+            vx = vx * scale;
+            vy = vy * scale;
+            vz = vz * scale;
+        }
+
+        if (c.leapfrog) {
+            // 用新速度再漂移半步
+            b.posX[i] = x + vx * halfDt;
+            b.posY[i] = y + vy * halfDt;
+            b.posZ[i] = z + vz * halfDt;
+        }
+        else {
+            b.posX[i] = x + vx * dt;
+            b.posY[i] = y + vy * dt;
+            b.posZ[i] = z + vz * dt;
+        }
+        b.velX[i] = vx;
+        b.velY[i] = vy;
+        b.velZ[i] = vz;
+
+        float r, g, bl;
+        if (type == 0) {
+            // 正常粒子受潮汐力影响
+            float tidalFactor = 1.0f + 5.0f / (distSq + 0.1f);
+            life = life - dt * tidalFactor;
+
+            float speedFactor = std::sqrt(vx * vx + vy * vy + vz * vz) / 50.0f;
+            float energyRelease = 1.0f / (distance + 0.5f);
+            r = 0.5f + energyRelease * 0.5f;
+            g = 0.3f + speedFactor * 0.5f;
+            bl = 1.0f - energyRelease * 0.3f;
+        }
+        else if (type == 1) {
+            // 喷流粒子 - 黄色/橙色
+            life = life - dt;
+            r = 1.0f;
+            g = 0.8f;
+            bl = 0.2f;
+        }
+        else {
+            // 爆炸粒子 - 红色/橙色
+            life = life - dt;
+            float lifeRatio = life / 3.0f;
+            r = 1.0f;
+            g = 0.5f * lifeRatio;
+            bl = 0.1f * lifeRatio;
+        }
+
+        b.life[i] = life;
+        b.colorR[i] = clampUnit(r);
+        b.colorG[i] = clampUnit(g);
+        b.colorB[i] = clampUnit(bl);
+    }
+}
+
+#if defined(BLACKHOLE_SIMD_X86)
+
+static bool cpuSupportsAVX2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    // 需要操作系统保存YMM寄存器（OSXSAVE + XCR0）
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+bool isKernelISASupported(KernelISA isa) {
+    switch (isa) {
+    case KernelISA::Scalar:
+        return true;
+#if defined(BLACKHOLE_SIMD_X86)
+    case KernelISA::SSE2:
+        return true;
+    case KernelISA::AVX2:
+        return cpuSupportsAVX2();
+#endif
+    default:
+        return false;
+    }
+}
+
+KernelISA detectKernelISA() {
+    if (isKernelISASupported(KernelISA::AVX2)) return KernelISA::AVX2;
+    if (isKernelISASupported(KernelISA::SSE2)) return KernelISA::SSE2;
+    return KernelISA::Scalar;
+}
+
+IntegrateKernel getIntegrateKernel(KernelISA isa) {
+    if (!isKernelISASupported(isa)) {
+        return integrateParticlesScalar;
+    }
+
+    switch (isa) {
+#if defined(BLACKHOLE_SIMD_X86)
+    case KernelISA::SSE2:
+        return integrateParticlesSSE2;
+    case KernelISA::AVX2:
+        return integrateParticlesAVX2;
+#endif
+    default:
+        return integrateParticlesScalar;
+    }
+}
+
+const char* getKernelISAName(KernelISA isa) {
+    switch (isa) {
+    case KernelISA::SSE2: return "SSE2";
+    case KernelISA::AVX2: return "AVX2";
+    default: return "Scalar";
+    }
+}
@@ -0,0 +1,77 @@
+#include "particle_kernels.h"
+#include "particle_kernels_simd.h"
+#include <immintrin.h>
+
+namespace {
+
+struct AVX2Ops {
+    static constexpr size_t Width = 8;
+
+    struct Vec {
+        __m256 v;
+        Vec(__m256 value) : v(value) {}
+        friend Vec operator+(Vec a, Vec b) { return _mm256_add_ps(a.v, b.v); }
+        friend Vec operator-(Vec a, Vec b) { return _mm256_sub_ps(a.v, b.v); }
+        friend Vec operator*(Vec a, Vec b) { return _mm256_mul_ps(a.v, b.v); }
+        friend Vec operator/(Vec a, Vec b) { return _mm256_div_ps(a.v, b.v); }
+    };
+
+    static Vec set1(float value) { return _mm256_set1_ps(value); }
+    static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Vec a) { _mm256_storeu_ps(p, a.v); }
+    static Vec sqrt(Vec a) { return _mm256_sqrt_ps(a.v); }
+    static Vec min(Vec a, Vec b) { return _mm256_min_ps(a.v, b.v); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_ps(a.v, b.v); }
+    static Vec negate(Vec a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+
+    static Vec cmplt(Vec a, Vec b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    static Vec cmple(Vec a, Vec b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    static Vec maskAnd(Vec a, Vec b) { return _mm256_and_ps(a.v, b.v); }
+    static Vec maskOr(Vec a, Vec b) { return _mm256_or_ps(a.v, b.v); }
+    // ~a & b
+    static Vec maskAndNot(Vec a, Vec b) { return _mm256_andnot_ps(a.v, b.v); }
+    static Vec allOnes() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    static bool allSet(Vec mask) { return _mm256_movemask_ps(mask.v) == 0xFF; }
+
+    static Vec select(Vec mask, Vec a, Vec b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+
+    // 8个uint8类型码零扩展为32位后比较
+    static Vec typeEquals(const uint8_t* types, int value) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(types));
+        __m256i lanes = _mm256_cvtepu8_epi32(bytes);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(lanes, _mm256_set1_epi32(value)));
+    }
+
+    // 整数通道，用于Philox
+    using IVec = __m256i;
+
+    static IVec set1Int(uint32_t value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+    static IVec xorInt(IVec a, IVec b) { return _mm256_xor_si256(a, b); }
+    static IVec loadInt(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static IVec laneIndices(uint32_t first) {
+        return _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first)),
+            _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+
+    // 32x32->64位乘法：_mm256_mul_epu32只处理偶数通道，奇数通道先右移再乘
+    static void mulhilo(IVec a, uint32_t m, IVec& hi, IVec& lo) {
+        const __m256i mv = _mm256_set1_epi32(static_cast<int>(m));
+        const __m256i lowMask = _mm256_set1_epi64x(0xFFFFFFFFll);
+        __m256i even = _mm256_mul_epu32(a, mv);
+        __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), mv);
+        lo = _mm256_or_si256(_mm256_and_si256(even, lowMask), _mm256_slli_epi64(odd, 32));
+        hi = _mm256_or_si256(_mm256_srli_epi64(even, 32), _mm256_andnot_si256(lowMask, odd));
+    }
+
+    static Vec toUnitFloat(IVec x) {
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+    }
+};
+
+}
+
+void integrateParticlesAVX2(const IntegrationBatch& batch, const IntegrationConstants& constants,
+    size_t begin, size_t end) {
+    integrateParticlesSimd<AVX2Ops>(batch, constants, begin, end);
+}
@@ -0,0 +1,179 @@
+#ifndef PARTICLE_KERNELS_SIMD_H
+#define PARTICLE_KERNELS_SIMD_H
+
+// 向量化积分内核的公共实现，只能被按指令集单独编译的源文件包含。
+// Ops提供向量类型Vec（支持+ - * /）以及载入、比较、掩码选择等操作，
+// 整数向量IVec用于在各通道中并行生成Philox随机数；
+// 运算顺序与integrateParticlesScalar保持一致，保证结果逐位相同。
+
+#include "particle_kernels.h"
+#include "random.h"
+
+// 每个通道一个粒子，counter[0]为粒子下标
+template <typename Ops>
+inline void philoxLanes(typename Ops::IVec counter[4], uint32_t key0, uint32_t key1) {
+    using IVec = typename Ops::IVec;
+
+    for (int round = 0; round < philox::Rounds; ++round) {
+        IVec hi0, lo0, hi1, lo1;
+        Ops::mulhilo(counter[0], philox::M0, hi0, lo0);
+        Ops::mulhilo(counter[2], philox::M1, hi1, lo1);
+
+        IVec c0 = Ops::xorInt(Ops::xorInt(hi1, counter[1]), Ops::set1Int(key0));
+        IVec c2 = Ops::xorInt(Ops::xorInt(hi0, counter[3]), Ops::set1Int(key1));
+        counter[0] = c0;
+        counter[1] = lo1;
+        counter[2] = c2;
+        counter[3] = lo0;
+
+        key0 += philox::W0;
+        key1 += philox::W1;
+    }
+}
+
+template <typename Ops>
+void integrateParticlesSimd(const IntegrationBatch& b, const IntegrationConstants& c,
+    size_t begin, size_t end) {
+    using Vec = typename Ops::Vec;
+    const size_t width = Ops::Width;
+
+    const Vec zero = Ops::set1(0.0f);
+    const Vec one = Ops::set1(1.0f);
+    const Vec dt = Ops::set1(c.deltaTime);
+    const Vec halfDt = Ops::set1(0.5f * c.deltaTime);
+    const bool leapfrog = c.leapfrog != 0;
+    const Vec mass = Ops::set1(c.blackHoleMass);
+    const Vec spiral = Ops::set1(c.spiralStrength);
+    const Vec turbulence = Ops::set1(c.turbulenceStrength);
+    const Vec half = Ops::set1(0.5f);
+    const Vec two = Ops::set1(2.0f);
+
+    size_t i = begin;
+    for (; i + width <= end; i += width) {
+        const Vec isNormal = Ops::typeEquals(b.type + i, 0);
+        const Vec isJet = Ops::typeEquals(b.type + i, 1);
+
+        Vec life = Ops::load(b.life + i);
+
+        // 待重生的正常粒子与解析推进的粒子本帧不参与积分
+        Vec skip = Ops::maskAnd(isNormal, Ops::cmple(life, zero));
+        if (b.analytic) {
+            skip = Ops::maskOr(skip, Ops::maskAndNot(Ops::typeEquals(b.analytic + i, 0), Ops::allOnes()));
+        }
+        if (Ops::allSet(skip)) {
+            continue;
+        }
+
+        const Vec px = Ops::load(b.posX + i);
+        const Vec py = Ops::load(b.posY + i);
+        const Vec pz = Ops::load(b.posZ + i);
+        Vec vx = Ops::load(b.velX + i);
+        Vec vy = Ops::load(b.velY + i);
+        Vec vz = Ops::load(b.velZ + i);
+
+        // 蛙跳：先用旧速度漂移半步，之后的受力都在半步位置处计算
+        const Vec x = leapfrog ? px + vx * halfDt : px;
+        const Vec y = leapfrog ? py + vy * halfDt : py;
+        const Vec z = leapfrog ? pz + vz * halfDt : pz;
+
+        // 计算到黑洞的距离
+        const Vec distSq = x * x + y * y + z * z;
+        const Vec distance = Ops::sqrt(distSq);
+
+        // 粒子被黑洞吞噬
+        const Vec swallowed = Ops::maskAndNot(skip,
+            Ops::maskAnd(isNormal, Ops::cmplt(distance, Ops::set1(0.5f))));
+        const Vec active = Ops::maskAndNot(Ops::maskOr(skip, swallowed), Ops::allOnes());
+
+        const Vec invDistance = one / distance;
+        const Vec gx = Ops::negate(x) * invDistance;
+        const Vec gy = Ops::negate(y) * invDistance;
+        const Vec gz = Ops::negate(z) * invDistance;
+
+        // 牛顿引力 + 相对论经验修正
+        const Vec gravity = mass / distSq;
+        const Vec relFactor = one + Ops::set1(2.0f) / (distance + Ops::set1(0.5f));
+        const Vec pull = gravity * relFactor;
+
+        // 螺旋吸积效应 cross(g, up) = (-gz, 0, gx)
+        const Vec sx = Ops::negate(gz) * spiral;
+        const Vec sz = gx * spiral;
+
+        // 湍流效应
+        typename Ops::IVec noise[4] = {
+            b.noiseIndex ? Ops::loadInt(b.noiseIndex + i) : Ops::laneIndices(static_cast<uint32_t>(i)),
+            Ops::set1Int(c.noiseStream[0]),
+            Ops::set1Int(c.noiseStream[1]),
+            Ops::set1Int(static_cast<uint32_t>(RandomDomain::Turbulence))
+        };
+        philoxLanes<Ops>(noise, c.noiseKey[0], c.noiseKey[1]);
+        const Vec tx = (Ops::toUnitFloat(noise[0]) - half) * two * turbulence;
+        const Vec ty = (Ops::toUnitFloat(noise[1]) - half) * two * turbulence;
+        const Vec tz = (Ops::toUnitFloat(noise[2]) - half) * two * turbulence;
+
+        Vec ax = gx * pull + sx + tx;
+        Vec ay = gy * pull + ty;
+        Vec az = gz * pull + sz + tz;
+
+        if (b.accelX) {
+            ax = ax + Ops::load(b.accelX + i);
+            ay = ay + Ops::load(b.accelY + i);
+            az = az + Ops::load(b.accelZ + i);
+        }
+
+        // 只有正常粒子受黑洞引力影响
+        vx = Ops::select(isNormal, vx + ax * dt, vx);
+        vy = Ops::select(isNormal, vy + ay * dt, vy);
+        vz = Ops::select(isNormal, vz + az * dt, vz);
+
+        // 速度限制
+        const Vec speedSq = vx * vx + vy * vy + vz * vz;
+        const Vec clampScale = Ops::select(Ops::cmpgt(speedSq, Ops::set1(10000.0f)),
+            Ops::set1(100.0f) / Ops::sqrt(speedSq), one);
+        vx = vx * clampScale;
+        vy = vy * clampScale;
+        vz = vz * clampScale;
+
+        // 蛙跳用新速度再漂移半步
+        const Vec stepDt = leapfrog ? halfDt : dt;
+        const Vec nx = x + vx * stepDt;
+        const Vec ny = y + vy * stepDt;
+        const Vec nz = z + vz * stepDt;
+
+        // 正常粒子受潮汐力影响，特效粒子固定寿命衰减
+        const Vec tidalFactor = one + Ops::set1(5.0f) / (distSq + Ops::set1(0.1f));
+        const Vec newLife = Ops::select(isNormal, life - dt * tidalFactor, life - dt);
+
+        const Vec speedFactor = Ops::sqrt(vx * vx + vy * vy + vz * vz) / Ops::set1(50.0f);
+        const Vec energyRelease = one / (distance + Ops::set1(0.5f));
+        const Vec lifeRatio = newLife / Ops::set1(3.0f);
+
+        Vec r = Ops::select(isNormal, Ops::set1(0.5f) + energyRelease * Ops::set1(0.5f), one);
+        Vec g = Ops::select(isNormal, Ops::set1(0.3f) + speedFactor * Ops::set1(0.5f),
+            Ops::select(isJet, Ops::set1(0.8f), Ops::set1(0.5f) * lifeRatio));
+        Vec bl = Ops::select(isNormal, one - energyRelease * Ops::set1(0.3f),
+            Ops::select(isJet, Ops::set1(0.2f), Ops::set1(0.1f) * lifeRatio));
+
+        r = Ops::min(Ops::max(r, zero), one);
+        g = Ops::min(Ops::max(g, zero), one);
+        bl = Ops::min(Ops::max(bl, zero), one);
+
+        Ops::store(b.posX + i, Ops::select(active, nx, px));
+        Ops::store(b.posY + i, Ops::select(active, ny, py));
+        Ops::store(b.posZ + i, Ops::select(active, nz, pz));
+        Ops::store(b.velX + i, Ops::select(active, vx, Ops::load(b.velX + i)));
+        Ops::store(b.velY + i, Ops::select(active, vy, Ops::load(b.velY + i)));
+        Ops::store(b.velZ + i, Ops::select(active, vz, Ops::load(b.velZ + i)));
+        Ops::store(b.life + i, Ops::select(active, newLife, Ops::select(swallowed, zero, life)));
+        Ops::store(b.colorR + i, Ops::select(active, r, Ops::load(b.colorR + i)));
+        Ops::store(b.colorG + i, Ops::select(active, g, Ops::load(b.colorG + i)));
+        Ops::store(b.colorB + i, Ops::select(active, bl, Ops::load(b.colorB + i)));
+    }
+
+    // 尾部不足一个向量宽度的粒子交给标量实现
+    if (i < end) {
+        integrateParticlesScalar(b, c, i, end);
+    }
+}
+
+#endif
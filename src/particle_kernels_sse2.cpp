@@ -0,0 +1,82 @@
+#include "particle_kernels.h"
+#include "particle_kernels_simd.h"
+#include <emmintrin.h>
+#include <cstring>
+
+namespace {
+
+struct SSE2Ops {
+    static constexpr size_t Width = 4;
+
+    struct Vec {
+        __m128 v;
+        Vec(__m128 value) : v(value) {}
+        friend Vec operator+(Vec a, Vec b) { return _mm_add_ps(a.v, b.v); }
+        friend Vec operator-(Vec a, Vec b) { return _mm_sub_ps(a.v, b.v); }
+        friend Vec operator*(Vec a, Vec b) { return _mm_mul_ps(a.v, b.v); }
+        friend Vec operator/(Vec a, Vec b) { return _mm_div_ps(a.v, b.v); }
+    };
+
+    static Vec set1(float value) { return _mm_set1_ps(value); }
+    static Vec load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Vec a) { _mm_storeu_ps(p, a.v); }
+    static Vec sqrt(Vec a) { return _mm_sqrt_ps(a.v); }
+    static Vec min(Vec a, Vec b) { return _mm_min_ps(a.v, b.v); }
+    static Vec max(Vec a, Vec b) { return _mm_max_ps(a.v, b.v); }
+    static Vec negate(Vec a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+
+    static Vec cmplt(Vec a, Vec b) { return _mm_cmplt_ps(a.v, b.v); }
+    static Vec cmple(Vec a, Vec b) { return _mm_cmple_ps(a.v, b.v); }
+    static Vec cmpgt(Vec a, Vec b) { return _mm_cmpgt_ps(a.v, b.v); }
+    static Vec maskAnd(Vec a, Vec b) { return _mm_and_ps(a.v, b.v); }
+    static Vec maskOr(Vec a, Vec b) { return _mm_or_ps(a.v, b.v); }
+    // ~a & b
+    static Vec maskAndNot(Vec a, Vec b) { return _mm_andnot_ps(a.v, b.v); }
+    static Vec allOnes() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+    static bool allSet(Vec mask) { return _mm_movemask_ps(mask.v) == 0xF; }
+
+    static Vec select(Vec mask, Vec a, Vec b) {
+        return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+    }
+
+    // 4个uint8类型码扩展为32位后比较
+    static Vec typeEquals(const uint8_t* types, int value) {
+        int packed;
+        std::memcpy(&packed, types, sizeof(packed));
+        __m128i bytes = _mm_cvtsi32_si128(packed);
+        __m128i zeroes = _mm_setzero_si128();
+        __m128i lanes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zeroes), zeroes);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(lanes, _mm_set1_epi32(value)));
+    }
+
+    // 整数通道，用于Philox
+    using IVec = __m128i;
+
+    static IVec set1Int(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+    static IVec xorInt(IVec a, IVec b) { return _mm_xor_si128(a, b); }
+    static IVec loadInt(const uint32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static IVec laneIndices(uint32_t first) {
+        return _mm_add_epi32(_mm_set1_epi32(static_cast<int>(first)), _mm_set_epi32(3, 2, 1, 0));
+    }
+
+    // 32x32->64位乘法：_mm_mul_epu32只处理偶数通道，奇数通道先右移再乘
+    static void mulhilo(IVec a, uint32_t m, IVec& hi, IVec& lo) {
+        const __m128i mv = _mm_set1_epi32(static_cast<int>(m));
+        const __m128i lowMask = _mm_set_epi32(0, -1, 0, -1);
+        __m128i even = _mm_mul_epu32(a, mv);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), mv);
+        lo = _mm_or_si128(_mm_and_si128(even, lowMask), _mm_slli_epi64(odd, 32));
+        hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(lowMask, odd));
+    }
+
+    static Vec toUnitFloat(IVec x) {
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+    }
+};
+
+}
+
+void integrateParticlesSSE2(const IntegrationBatch& batch, const IntegrationConstants& constants,
+    size_t begin, size_t end) {
+    integrateParticlesSimd<SSE2Ops>(batch, constants, begin, end);
+}
@@ -0,0 +1,698 @@
+#include "particle_simulation.h"
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <glm/gtc/matrix_transform.hpp>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846f
+#endif
+
+void ParticleStore::resize(size_t count) {
+    posX.resize(count); posY.resize(count); posZ.resize(count);
+    velX.resize(count); velY.resize(count); velZ.resize(count);
+    life.resize(count);
+    type.resize(count);
+    colorR.resize(count); colorG.resize(count); colorB.resize(count);
+    size.resize(count);
+}
+
+ParticleArrays ParticleStore::arrays() const {
+    return ParticleArrays{ count(),
+        posX.data(), posY.data(), posZ.data(),
+        velX.data(), velY.data(), velZ.data(),
+        life.data(), type.data(),
+        colorR.data(), colorG.data(), colorB.data(),
+        size.data() };
+}
+
+void ParticleStore::assign(const ParticleArrays& source) {
+    const size_t n = source.count;
+    posX.assign(source.posX, source.posX + n);
+    posY.assign(source.posY, source.posY + n);
+    posZ.assign(source.posZ, source.posZ + n);
+    velX.assign(source.velX, source.velX + n);
+    velY.assign(source.velY, source.velY + n);
+    velZ.assign(source.velZ, source.velZ + n);
+    life.assign(source.life, source.life + n);
+    type.assign(source.type, source.type + n);
+    colorR.assign(source.colorR, source.colorR + n);
+    colorG.assign(source.colorG, source.colorG + n);
+    colorB.assign(source.colorB, source.colorB + n);
+    size.assign(source.size, source.size + n);
+}
+
+ParticleSimulation::ParticleSimulation(int maxParticles) : maxParticles(maxParticles) {
+    params.blackHoleMass = 5000.0f;
+    params.particleLifetime = 10.0f;
+    params.spiralStrength = 1.5f;
+    params.turbulenceStrength = 0.3f;
+    params.accretionDiskRadius = 25.0f;
+    params.particleSize = 0.1f;
+    params.colorIntensity = 2.0f;
+    params.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    params.lightIntensity = 1.0f;
+    params.lightPosition = glm::vec3(10.0f, 10.0f, 10.0f);
+    params.lightDirection = glm::vec3(-1.0f, -1.0f, -1.0f);
+    params.directionalLight = false;
+
+    // 喷流参数
+    params.enableJet = false;
+    params.jetStrength = 5.0f;
+    params.jetAngle = 15.0f;
+    params.jetDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+    params.jetParticleSpeed = 20.0f;
+
+    // 爆炸参数
+    params.enableExplosion = false;
+    params.explosionStrength = 10.0f;
+    params.explosionDuration = 2.0f;
+    params.explosionRadius = 15.0f;
+
+    // 自引力参数
+    params.enableSelfGravity = false;
+    params.particleMass = 0.05f;
+    params.openingAngle = 0.7f;
+    params.gravitySoftening = 0.5f;
+
+    // SPH参数
+    params.enableSph = false;
+    params.sphSmoothingLength = 0.75f;
+    params.sphRestDensity = 0.05f;
+    params.sphStiffness = 20.0f;
+    params.sphViscosity = 0.5f;
+
+    // 时间步进参数
+    params.integrator = IntegratorType::Leapfrog;
+    params.fixedTimeStep = 1.0f / 60.0f;
+    params.substeps = 1;
+    params.adaptiveTimeSteps = false;
+    params.timeStepAccuracy = 0.05f;
+    params.maxTimeBin = 5;
+    params.enableKeplerFastPath = false;
+    params.keplerCaptureRadius = 20.0f;
+    params.keplerInnerRadius = 10.0f;
+
+    // 特效状态
+    explosionTimer = 0.0f;
+    explosionActive = false;
+
+    // 默认每次运行使用不同的种子，setSeed可固定种子以复现结果
+    std::random_device rd;
+    seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    stepIndex = 0;
+    explosionCount = 0;
+    freeSlotCount = 0;
+    treeBuildMs = 0.0;
+    treeTraversalMs = 0.0;
+    gridBuildMs = 0.0;
+    sphMs = 0.0;
+    keplerMs = 0.0;
+    timeAccumulator = 0.0;
+    interpolationAlpha = 1.0f;
+    stepsLastFrame = 0;
+    deterministic = false;
+
+    setKernelISA(detectKernelISA());
+    setThreadCount(1);
+
+    // 参数就绪后再生成粒子，resetParticle依赖吸积盘半径等参数
+    initializeParticles();
+}
+
+void ParticleSimulation::initializeParticles() {
+    particles.resize(maxParticles);
+    freeSlots.clear();
+    freeSlotCount = 0;
+    previousX.clear();
+    previousY.clear();
+    previousZ.clear();
+    timeAccumulator = 0.0;
+    interpolationAlpha = 1.0f;
+    keplerOrbits.releaseAll();
+
+    for (int i = 0; i < maxParticles; ++i) {
+        RandomStream rng(seed, RandomDomain::Initial, i);
+        resetParticle(i, rng);
+    }
+}
+
+void ParticleSimulation::resetParticle(size_t i, RandomStream& rng) {
+    // 在吸积盘平面内随机位置
+    float angle = rng.nextFloat() * 2.0f * M_PI;
+    float radius = 5.0f + rng.nextFloat() * params.accretionDiskRadius;
+    float height = (rng.nextFloat() - 0.5f) * 2.0f;
+
+    glm::vec3 position = glm::vec3(
+        cos(angle) * radius,
+        height,
+        sin(angle) * radius
+    );
+
+    // 初始速度（轨道速度 + 随机分量）
+    float orbitalSpeed = sqrt(params.blackHoleMass / radius) * 0.8f;
+    glm::vec3 tangent = glm::normalize(glm::vec3(-sin(angle), 0.0f, cos(angle)));
+    glm::vec3 orbitalVelocity = tangent * orbitalSpeed;
+
+    // 向黑洞的径向速度
+    glm::vec3 radialDir = glm::normalize(-position);
+    glm::vec3 inwardVelocity = radialDir * (0.1f + rng.nextFloat() * 0.3f);
+
+    glm::vec3 velocity = orbitalVelocity + inwardVelocity;
+    velocity.y += (rng.nextFloat() - 0.5f) * 0.5f;
+
+    particles.setPosition(i, position);
+    particles.setVelocity(i, velocity);
+    particles.life[i] = params.particleLifetime * (0.8f + rng.nextFloat() * 0.4f);
+    particles.size[i] = params.particleSize * (0.5f + rng.nextFloat());
+
+    // 颜色基于位置和速度
+    float colorFactor = glm::length(velocity) / 10.0f;
+    particles.colorR[i] = 0.3f + rng.nextFloat(0.5f, 1.0f) * 0.7f * colorFactor;
+    particles.colorG[i] = 0.3f + rng.nextFloat(0.5f, 1.0f) * 0.5f * colorFactor;
+    particles.colorB[i] = 1.0f;
+
+    particles.type[i] = 0;
+    syncPreviousPosition(i);
+}
+
+void ParticleSimulation::syncPreviousPosition(size_t i) {
+    if (previousX.empty()) {
+        return;
+    }
+    previousX[i] = particles.posX[i];
+    previousY[i] = particles.posY[i];
+    previousZ[i] = particles.posZ[i];
+}
+
+int ParticleSimulation::advance(float frameTime) {
+    const double step = params.fixedTimeStep;
+    const int substeps = std::max(params.substeps, 1);
+    const float substep = params.fixedTimeStep / substeps;
+
+    if (deterministic) {
+        timeAccumulator = step;
+    }
+    else {
+        timeAccumulator += frameTime;
+    }
+
+    int steps = 0;
+    while (timeAccumulator >= step && steps < MaxStepsPerFrame) {
+        previousX = particles.posX;
+        previousY = particles.posY;
+        previousZ = particles.posZ;
+
+        for (int s = 0; s < substeps; ++s) {
+            update(substep);
+        }
+        timeAccumulator -= step;
+        ++steps;
+    }
+
+    // 模拟跟不上时丢弃积压的时间，宁可变慢也不让下一帧补更多步
+    if (timeAccumulator >= step) {
+        timeAccumulator = std::fmod(timeAccumulator, step);
+    }
+
+    interpolationAlpha = deterministic ? 1.0f : static_cast<float>(timeAccumulator / step);
+    stepsLastFrame = steps;
+    return steps;
+}
+
+void ParticleSimulation::setDeterministic(bool enabled) {
+    deterministic = enabled;
+    timeAccumulator = 0.0;
+    interpolationAlpha = 1.0f;
+}
+
+SimulationState ParticleSimulation::getState() const {
+    SimulationState state;
+    state.seed = seed;
+    state.stepIndex = stepIndex;
+    state.explosionCount = explosionCount;
+    state.timeAccumulator = timeAccumulator;
+    state.explosionTimer = explosionTimer;
+    state.explosionActive = explosionActive;
+    state.deterministic = deterministic;
+    return state;
+}
+
+void ParticleSimulation::restoreState(const ParticleParameters& parameters, const SimulationState& state,
+    const ParticleArrays& arrays, const uint32_t* slots, size_t slotCount,
+    const KeplerOrbitArrays* orbits) {
+    params = parameters;
+    seed = state.seed;
+    stepIndex = state.stepIndex;
+    explosionCount = state.explosionCount;
+    timeAccumulator = state.timeAccumulator;
+    explosionTimer = state.explosionTimer;
+    explosionActive = state.explosionActive;
+    deterministic = state.deterministic;
+    interpolationAlpha = 1.0f;
+
+    maxParticles = static_cast<int>(arrays.count);
+    particles.assign(arrays);
+    freeSlots.assign(slots, slots + slotCount);
+    freeSlotCount = slotCount;
+
+    previousX.clear();
+    previousY.clear();
+    previousZ.clear();
+    if (orbits) {
+        keplerOrbits.assign(*orbits, arrays.count, UpdateChunkSize);
+    }
+    else {
+        keplerOrbits.releaseAll();
+    }
+}
+
+RenderInterpolation ParticleSimulation::getRenderInterpolation() const {
+    RenderInterpolation interpolation;
+    const bool valid = previousX.size() == particles.count();
+    interpolation.previousX = valid ? previousX.data() : nullptr;
+    interpolation.previousY = valid ? previousY.data() : nullptr;
+    interpolation.previousZ = valid ? previousZ.data() : nullptr;
+    interpolation.alpha = interpolationAlpha;
+    return interpolation;
+}
+
+void ParticleSimulation::update(float deltaTime) {
+    if (explosionActive) {
+        updateExplosionParticles(deltaTime);
+        explosionTimer -= deltaTime;
+        if (explosionTimer <= 0.0f) {
+            explosionActive = false;
+        }
+    }
+
+    if (params.enableJet) {
+        spawnJetParticles(JetParticlesPerStep);
+    }
+
+    const size_t count = particles.count();
+    const size_t chunkCount = (count + UpdateChunkSize - 1) / UpdateChunkSize;
+    ++stepIndex;
+
+    chunkRespawnLists.resize(chunkCount);
+    chunkFreeLists.resize(chunkCount);
+
+    IntegrationBatch batch;
+    batch.posX = particles.posX.data();
+    batch.posY = particles.posY.data();
+    batch.posZ = particles.posZ.data();
+    batch.velX = particles.velX.data();
+    batch.velY = particles.velY.data();
+    batch.velZ = particles.velZ.data();
+    batch.life = particles.life.data();
+    batch.type = particles.type.data();
+    batch.colorR = particles.colorR.data();
+    batch.colorG = particles.colorG.data();
+    batch.colorB = particles.colorB.data();
+    batch.accelX = nullptr;
+    batch.accelY = nullptr;
+    batch.accelZ = nullptr;
+    batch.noiseIndex = nullptr;
+    batch.analytic = nullptr;
+
+    // 远场粒子按块保存为轨道根数，之后由解析推进代替积分内核；
+    // 捕获、推进与压缩都在下面的分块循环中完成，每块只触碰自己的分段
+    const bool keplerActive = isKeplerFastPathActive();
+    if (keplerActive) {
+        keplerOrbits.prepare(count, UpdateChunkSize);
+        batch.analytic = keplerOrbits.getMask();
+    }
+    else {
+        keplerOrbits.releaseAll();
+    }
+    const KeplerSettings keplerSettings = getKeplerSettings();
+    chunkKeplerMs.assign(chunkCount, 0.0);
+    integrationScratch.resize(threadPool.getThreadCount());
+
+    if (computeInteractions()) {
+        batch.accelX = externalAccelX.data();
+        batch.accelY = externalAccelY.data();
+        batch.accelZ = externalAccelZ.data();
+    }
+
+    IntegrationConstants constants;
+    constants.blackHoleMass = params.blackHoleMass;
+    constants.spiralStrength = params.spiralStrength;
+    constants.turbulenceStrength = params.turbulenceStrength;
+    constants.deltaTime = deltaTime;
+    constants.leapfrog = params.integrator == IntegratorType::Leapfrog ? 1u : 0u;
+    constants.noiseKey[0] = static_cast<uint32_t>(seed);
+    constants.noiseKey[1] = static_cast<uint32_t>(seed >> 32);
+    constants.noiseStream[0] = static_cast<uint32_t>(stepIndex);
+    constants.noiseStream[1] = static_cast<uint32_t>(stepIndex >> 32);
+
+    // 先记录要重生的粒子，积分内核会跳过它们
+    auto collectRespawns = [&](size_t begin, size_t end) {
+        std::vector<uint32_t>& respawnList = chunkRespawnLists[begin / UpdateChunkSize];
+        respawnList.clear();
+        for (size_t i = begin; i < end; ++i) {
+            if (particles.life[i] <= 0.0f && particles.type[i] == 0) { // 只重置正常粒子
+                respawnList.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    };
+
+    // 分档积分需要跨块重排粒子，这时登记、积分与重生分成几趟，保证只重生本步开始前已死亡的粒子
+    const bool blockSteps = params.adaptiveTimeSteps;
+    if (blockSteps) {
+        threadPool.parallelFor(0, count, UpdateChunkSize, [&](size_t begin, size_t end, int) {
+            collectRespawns(begin, end);
+        });
+
+        BlockTimeStepSettings settings;
+        settings.blackHoleMass = params.blackHoleMass;
+        settings.accuracy = params.timeStepAccuracy;
+        settings.maxBin = params.maxTimeBin;
+        blockStepper.integrate(batch, count, constants, settings, integrateKernel, threadPool);
+    }
+
+    // 每块粒子独立完成重生登记、积分、解析推进、重生与捕获，块之间没有共享写入。
+    // 随机数由(种子, 帧序号, 粒子下标)决定，结果与线程数和分块方式无关
+    threadPool.parallelFor(0, count, UpdateChunkSize, [&](size_t begin, size_t end, int worker) {
+        const size_t chunk = begin / UpdateChunkSize;
+        std::vector<uint32_t>& respawnList = chunkRespawnLists[chunk];
+        std::vector<uint32_t>& freeList = chunkFreeLists[chunk];
+
+        if (!blockSteps) {
+            collectRespawns(begin, end);
+            integrateChunk(batch, constants, begin, end, integrationScratch[worker]);
+        }
+
+        if (keplerActive) {
+            auto keplerStart = std::chrono::steady_clock::now();
+            keplerOrbits.propagate(particles, begin, deltaTime, keplerSettings);
+            chunkKeplerMs[chunk] = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - keplerStart).count();
+        }
+
+        for (uint32_t i : respawnList) {
+            RandomStream rng(seed, RandomDomain::Respawn, (stepIndex << 32) | i);
+            resetParticle(i, rng);
+        }
+
+        // 本帧死亡的粒子（被吞噬、寿命耗尽、或不会重生的特效粒子）成为空闲槽位
+        freeList.clear();
+        for (size_t i = begin; i < end; ++i) {
+            if (particles.life[i] <= 0.0f) {
+                freeList.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        // 捕获放在重生之后，新生成的粒子也能在轮到时转入；从下一步开始解析推进
+        if (keplerActive) {
+            auto captureStart = std::chrono::steady_clock::now();
+            keplerOrbits.capture(particles, begin, end, keplerSettings, stepIndex);
+            chunkKeplerMs[chunk] += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - captureStart).count();
+        }
+    });
+
+    keplerMs = 0.0;
+    for (double ms : chunkKeplerMs) {
+        keplerMs += ms;
+    }
+
+    // 按块顺序合并，保证空闲表内容与线程调度无关
+    freeSlots.clear();
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        freeSlots.insert(freeSlots.end(), chunkFreeLists[chunk].begin(), chunkFreeLists[chunk].end());
+    }
+    freeSlotCount = freeSlots.size();
+}
+
+void ParticleSimulation::integrateChunk(const IntegrationBatch& batch, const IntegrationConstants& constants,
+    size_t begin, size_t end, IntegrationScratch& scratch) {
+    // 解析粒子较少时按掩码跳过即可；较多时SIMD内核几乎每组都有要积分的粒子，
+    // 跳过省不下计算，改为把其余粒子收集到连续数组中只积分它们
+    const size_t analyticCount = keplerOrbits.getBlockAnalyticCount(begin);
+    if (analyticCount * 4 < end - begin) {
+        integrateKernel(batch, constants, begin, end);
+        return;
+    }
+
+    const size_t total = end - begin - analyticCount;
+    const bool hasAccel = batch.accelX != nullptr;
+    scratch.index.resize(total);
+    scratch.posX.resize(total); scratch.posY.resize(total); scratch.posZ.resize(total);
+    scratch.velX.resize(total); scratch.velY.resize(total); scratch.velZ.resize(total);
+    scratch.life.resize(total);
+    scratch.type.resize(total);
+    scratch.colorR.resize(total); scratch.colorG.resize(total); scratch.colorB.resize(total);
+    if (hasAccel) {
+        scratch.accelX.resize(total); scratch.accelY.resize(total); scratch.accelZ.resize(total);
+    }
+
+    size_t k = 0;
+    for (size_t i = begin; i < end; ++i) {
+        if (batch.analytic[i]) {
+            continue;
+        }
+        scratch.index[k] = static_cast<uint32_t>(i);
+        scratch.posX[k] = batch.posX[i]; scratch.posY[k] = batch.posY[i]; scratch.posZ[k] = batch.posZ[i];
+        scratch.velX[k] = batch.velX[i]; scratch.velY[k] = batch.velY[i]; scratch.velZ[k] = batch.velZ[i];
+        scratch.life[k] = batch.life[i];
+        scratch.type[k] = batch.type[i];
+        scratch.colorR[k] = batch.colorR[i]; scratch.colorG[k] = batch.colorG[i]; scratch.colorB[k] = batch.colorB[i];
+        if (hasAccel) {
+            scratch.accelX[k] = batch.accelX[i]; scratch.accelY[k] = batch.accelY[i]; scratch.accelZ[k] = batch.accelZ[i];
+        }
+        ++k;
+    }
+
+    IntegrationBatch gathered;
+    gathered.posX = scratch.posX.data(); gathered.posY = scratch.posY.data(); gathered.posZ = scratch.posZ.data();
+    gathered.velX = scratch.velX.data(); gathered.velY = scratch.velY.data(); gathered.velZ = scratch.velZ.data();
+    gathered.life = scratch.life.data();
+    gathered.type = scratch.type.data();
+    gathered.colorR = scratch.colorR.data(); gathered.colorG = scratch.colorG.data(); gathered.colorB = scratch.colorB.data();
+    gathered.accelX = hasAccel ? scratch.accelX.data() : nullptr;
+    gathered.accelY = hasAccel ? scratch.accelY.data() : nullptr;
+    gathered.accelZ = hasAccel ? scratch.accelZ.data() : nullptr;
+    gathered.noiseIndex = scratch.index.data();
+    gathered.analytic = nullptr;
+    integrateKernel(gathered, constants, 0, k);
+
+    for (size_t n = 0; n < k; ++n) {
+        const uint32_t i = scratch.index[n];
+        batch.posX[i] = scratch.posX[n]; batch.posY[i] = scratch.posY[n]; batch.posZ[i] = scratch.posZ[n];
+        batch.velX[i] = scratch.velX[n]; batch.velY[i] = scratch.velY[n]; batch.velZ[i] = scratch.velZ[n];
+        batch.life[i] = scratch.life[n];
+        batch.colorR[i] = scratch.colorR[n]; batch.colorG[i] = scratch.colorG[n]; batch.colorB[i] = scratch.colorB[n];
+    }
+}
+
+KeplerSettings ParticleSimulation::getKeplerSettings() const {
+    KeplerSettings settings;
+    settings.blackHoleMass = params.blackHoleMass;
+    settings.captureRadius = params.keplerCaptureRadius;
+    settings.innerRadius = params.keplerInnerRadius;
+    settings.maxEccentricity = 0.9f;
+    return settings;
+}
+
+bool ParticleSimulation::computeInteractions() {
+    using Clock = std::chrono::steady_clock;
+    treeBuildMs = treeTraversalMs = gridBuildMs = sphMs = 0.0;
+
+    if (!params.enableSelfGravity && !params.enableSph) {
+        return false;
+    }
+
+    // 解析推进的粒子忽略粒子间相互作用，只作为质量源与邻居，不求自身受力
+    const uint8_t* analytic = isKeplerFastPathActive() ? keplerOrbits.getMask() : nullptr;
+
+    // 在积分之前用本帧开始时的状态计算，所有粒子看到同一时刻的分布
+    if (params.enableSelfGravity) {
+        auto buildStart = Clock::now();
+        gravityTree.build(particles, params.particleMass, threadPool);
+        auto traversalStart = Clock::now();
+        gravityTree.computeAccelerations(params.openingAngle, params.gravitySoftening, threadPool,
+            externalAccelX, externalAccelY, externalAccelZ, analytic);
+        auto traversalEnd = Clock::now();
+
+        treeBuildMs = std::chrono::duration<double, std::milli>(traversalStart - buildStart).count();
+        treeTraversalMs = std::chrono::duration<double, std::milli>(traversalEnd - traversalStart).count();
+    }
+    else {
+        externalAccelX.assign(particles.count(), 0.0f);
+        externalAccelY.assign(particles.count(), 0.0f);
+        externalAccelZ.assign(particles.count(), 0.0f);
+    }
+
+    if (params.enableSph) {
+        auto gridStart = Clock::now();
+        neighborGrid.build(particles, params.sphSmoothingLength, threadPool);
+        auto sphStart = Clock::now();
+
+        SphSettings settings;
+        settings.particleMass = params.particleMass;
+        settings.smoothingLength = params.sphSmoothingLength;
+        settings.restDensity = params.sphRestDensity;
+        settings.stiffness = params.sphStiffness;
+        settings.viscosity = params.sphViscosity;
+        sphSolver.addAccelerations(neighborGrid, settings, threadPool, externalAccelX, externalAccelY, externalAccelZ,
+            analytic);
+        auto sphEnd = Clock::now();
+
+        gridBuildMs = std::chrono::duration<double, std::milli>(sphStart - gridStart).count();
+        sphMs = std::chrono::duration<double, std::milli>(sphEnd - sphStart).count();
+    }
+
+    return true;
+}
+
+ParticleSimulation::SlotRange ParticleSimulation::claimSlots(size_t count) {
+    // 从表尾整块取出，O(count)
+    count = std::min(count, freeSlotCount);
+    freeSlotCount -= count;
+
+    SlotRange range;
+    range.indices = freeSlots.data() + freeSlotCount;
+    range.count = count;
+    return range;
+}
+
+void ParticleSimulation::retireParticles(size_t first, size_t count) {
+    const size_t end = std::min(first + count, particles.count());
+    freeSlots.resize(freeSlotCount);
+    for (size_t i = first; i < end; ++i) {
+        if (particles.life[i] > 0.0f) {
+            particles.life[i] = 0.0f;
+            particles.type[i] = 1;
+            freeSlots.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    freeSlotCount = freeSlots.size();
+
+    // 被移出的粒子可能正由解析轨道推进，下一步重新捕获
+    keplerOrbits.releaseAll();
+}
+
+void ParticleSimulation::setKernelISA(KernelISA isa) {
+    if (!isKernelISASupported(isa)) {
+        isa = KernelISA::Scalar;
+    }
+    kernelISA = isa;
+    integrateKernel = getIntegrateKernel(isa);
+}
+
+void ParticleSimulation::setThreadCount(int threadCount) {
+    threadCount = std::max(threadCount, 1);
+    threadPool.setThreadCount(threadCount);
+}
+
+void ParticleSimulation::setSeed(uint64_t newSeed) {
+    seed = newSeed;
+    stepIndex = 0;
+    explosionCount = 0;
+    initializeParticles();
+}
+
+void ParticleSimulation::spawnJetParticles(size_t count) {
+    RandomStream rng(seed, RandomDomain::Jet, stepIndex);
+
+    // 在黑洞附近生成喷流粒子
+    SlotRange slots = claimSlots(count);
+    for (size_t i = 0; i < slots.count; ++i) {
+        const uint32_t j = slots.indices[i];
+
+        // 计算喷流方向（在锥形范围内随机）
+        float angle = params.jetAngle * M_PI / 180.0f;
+        float randomAngle = rng.nextFloat() * angle;
+        float randomRotation = rng.nextFloat() * 2.0f * M_PI;
+
+        glm::vec3 jetDir = params.jetDirection;
+
+        glm::vec3 axis = glm::vec3(cos(randomRotation), 0.0f, sin(randomRotation));
+        glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), randomAngle, axis);
+
+        glm::vec3 randomDir = glm::vec3(rotationMatrix * glm::vec4(jetDir, 1.0f));
+
+        // 在黑洞中心重置为喷流粒子
+        particles.setPosition(j, glm::vec3(0.0f));
+        particles.setVelocity(j, randomDir * params.jetParticleSpeed);
+        particles.life[j] = 2.0f;
+        particles.size[j] = params.particleSize * 0.3f;
+        particles.setColor(j, glm::vec3(1.0f, 0.8f, 0.2f));
+        particles.type[j] = 1; // 喷流粒子
+        syncPreviousPosition(j);
+    }
+}
+
+void ParticleSimulation::triggerExplosion() {
+    RandomStream rng(seed, RandomDomain::Explosion, explosionCount++);
+
+    // 爆炸半径内的解析粒子受到扰动，交还数值积分
+    keplerOrbits.releaseWithin(particles, params.explosionRadius);
+
+    // 重置爆炸状态
+    explosionActive = true;
+    explosionTimer = params.explosionDuration;
+
+    // 创建爆炸粒子
+    SlotRange slots = claimSlots(ExplosionParticles);
+    for (size_t i = 0; i < slots.count; ++i) {
+        const uint32_t j = slots.indices[i];
+
+        // 随机方向
+        float theta = rng.nextFloat() * 2.0f * M_PI;
+        float phi = acos(2.0f * rng.nextFloat() - 1.0f);
+
+        glm::vec3 velocity = glm::vec3(
+            sin(phi) * cos(theta),
+            sin(phi) * sin(theta),
+            cos(phi)
+        ) * params.explosionStrength * (0.8f + rng.nextFloat() * 0.4f);
+
+        // 在黑洞中心创建爆炸粒子
+        particles.setPosition(j, glm::vec3(0.0f));
+        particles.setVelocity(j, velocity);
+        particles.life[j] = 3.0f;
+        particles.size[j] = params.particleSize * (0.8f + rng.nextFloat() * 0.4f);
+        particles.setColor(j, glm::vec3(1.0f, 0.5f, 0.1f));
+        particles.type[j] = 2; // 爆炸粒子
+        syncPreviousPosition(j);
+    }
+}
+
+void ParticleSimulation::updateExplosionParticles(float deltaTime) {
+    // 爆炸粒子会自然衰减，不需要特殊更新
+    // 生命周期已经在主更新循环中处理
+}
+
+void ParticleSimulation::applyEffect(const ParticleEffect& effect) {
+    params.blackHoleMass = effect.blackHoleMass;
+    params.particleLifetime = effect.particleLifetime;
+    params.spiralStrength = effect.spiralStrength;
+    params.turbulenceStrength = effect.turbulenceStrength;
+    params.accretionDiskRadius = effect.accretionDiskRadius;
+    params.particleSize = effect.particleSize;
+    params.colorIntensity = effect.colorIntensity;
+    params.enableJet = effect.enableJet;
+    params.jetStrength = effect.jetStrength;
+    params.enableExplosion = effect.enableExplosion;
+    params.explosionStrength = effect.explosionStrength;
+}
+
+size_t ParticleSimulation::packInstances(ParticleInstance* out) const {
+    // 稳定划分：跳过已死亡的粒子，存活粒子保持相对顺序
+    const RenderInterpolation interpolation = getRenderInterpolation();
+    const size_t count = particles.count();
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (particles.life[i] <= 0.0f) {
+            continue;
+        }
+        ParticleInstance& instance = out[written++];
+        instance.position = interpolation.position(particles, i);
+        instance.color = glm::vec3(particles.colorR[i], particles.colorG[i], particles.colorB[i]);
+        instance.size = particles.size[i];
+    }
+    return written;
+}
\ No newline at end of file
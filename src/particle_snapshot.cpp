@@ -0,0 +1,618 @@
+#include "particle_snapshot.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+const char SnapshotMagic[4] = { 'B', 'H', 'S', 'N' };
+const uint32_t SnapshotVersion = 3;
+const size_t Alignment = 64;
+const size_t FileHeaderBytes = 64;
+const size_t ChunkHeaderBytes = 16;
+
+constexpr uint32_t makeTag(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(a))
+        | static_cast<uint32_t>(static_cast<unsigned char>(b)) << 8
+        | static_cast<uint32_t>(static_cast<unsigned char>(c)) << 16
+        | static_cast<uint32_t>(static_cast<unsigned char>(d)) << 24;
+}
+
+const uint32_t ParametersTag = makeTag('P', 'A', 'R', 'M');
+const uint32_t StateTag = makeTag('S', 'T', 'A', 'T');
+const uint32_t ParticlesTag = makeTag('P', 'A', 'R', 'T');
+const uint32_t FreeSlotsTag = makeTag('F', 'R', 'E', 'E');
+const uint32_t KeplerTag = makeTag('K', 'E', 'P', 'L');
+const uint32_t FrameTag = makeTag('F', 'R', 'A', 'M');
+
+size_t alignUp(size_t value) {
+    return (value + Alignment - 1) & ~(Alignment - 1);
+}
+
+// 追加到缓冲末尾；缓冲在文件中的起点总是64字节对齐，块内对齐按缓冲内偏移计算即可
+class ChunkWriter {
+public:
+    explicit ChunkWriter(std::vector<unsigned char>& data) : data(data) {}
+
+    void fileHeader(SnapshotKind kind) {
+        putBytes(SnapshotMagic, sizeof(SnapshotMagic));
+        put<uint32_t>(SnapshotVersion);
+        put<uint32_t>(static_cast<uint32_t>(kind));
+        data.resize(alignUp(data.size()), 0);
+    }
+
+    void beginChunk(uint32_t tag) {
+        chunkStart = data.size();
+        put<uint32_t>(tag);
+        put<uint32_t>(0);
+        put<uint64_t>(0);
+    }
+
+    // 回填负载长度并把块补齐到64字节
+    void endChunk() {
+        const uint64_t bytes = data.size() - chunkStart - ChunkHeaderBytes;
+        std::memcpy(data.data() + chunkStart + 8, &bytes, sizeof(bytes));
+        data.resize(alignUp(data.size()), 0);
+    }
+
+    template<typename T>
+    void put(const T& value) {
+        putBytes(&value, sizeof(T));
+    }
+
+    void putArray(const void* values, size_t bytes) {
+        align();
+        putBytes(values, bytes);
+    }
+
+    // 补齐到64字节，之后可用reserve分几段写入一个数组
+    void align() {
+        data.resize(alignUp(data.size()), 0);
+    }
+
+    // 预留空间，返回写入位置，供调用方直接填充（如打包实例）
+    unsigned char* reserve(size_t bytes) {
+        const size_t offset = data.size();
+        data.resize(offset + bytes);
+        return data.data() + offset;
+    }
+
+private:
+    void putBytes(const void* values, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(values);
+        data.insert(data.end(), p, p + bytes);
+    }
+
+    std::vector<unsigned char>& data;
+    size_t chunkStart = 0;
+};
+
+// 有边界检查的顺序读取
+struct ChunkReader {
+    const unsigned char* cursor;
+    const unsigned char* end;
+
+    template<typename T>
+    bool get(T& value) {
+        if (static_cast<size_t>(end - cursor) < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return true;
+    }
+
+    // 数组不复制，返回指向映射的指针。映射起点按页对齐，文件内偏移对齐即地址对齐
+    template<typename T>
+    bool getArray(const T*& values, size_t count) {
+        cursor += alignUp(reinterpret_cast<uintptr_t>(cursor)) - reinterpret_cast<uintptr_t>(cursor);
+        if (cursor > end || static_cast<size_t>(end - cursor) / sizeof(T) < count) {
+            return false;
+        }
+        values = reinterpret_cast<const T*>(cursor);
+        cursor += count * sizeof(T);
+        return true;
+    }
+};
+
+// 参数的字段表，读写共用，保证两边顺序一致；布尔按一字节、枚举按int32保存
+struct ParameterWriter {
+    ChunkWriter& out;
+    void operator()(float& v) { out.put(v); }
+    void operator()(int& v) { out.put<int32_t>(v); }
+    void operator()(bool& v) { out.put<uint8_t>(v ? 1 : 0); }
+    void operator()(glm::vec3& v) { out.put(v.x); out.put(v.y); out.put(v.z); }
+    void operator()(IntegratorType& v) { out.put<int32_t>(static_cast<int32_t>(v)); }
+};
+
+struct ParameterReader {
+    ChunkReader& in;
+    bool ok = true;
+    void operator()(float& v) { ok = in.get(v) && ok; }
+    void operator()(int& v) { int32_t x = 0; ok = in.get(x) && ok; v = x; }
+    void operator()(bool& v) { uint8_t x = 0; ok = in.get(x) && ok; v = x != 0; }
+    void operator()(glm::vec3& v) { ok = in.get(v.x) && in.get(v.y) && in.get(v.z) && ok; }
+    void operator()(IntegratorType& v) { int32_t x = 0; ok = in.get(x) && ok; v = static_cast<IntegratorType>(x); }
+};
+
+template<typename Visitor>
+void visitParameters(ParticleParameters& p, Visitor& visit) {
+    visit(p.blackHoleMass); visit(p.particleLifetime); visit(p.spiralStrength);
+    visit(p.turbulenceStrength); visit(p.accretionDiskRadius); visit(p.particleSize);
+    visit(p.colorIntensity); visit(p.lightColor); visit(p.lightIntensity);
+    visit(p.lightPosition); visit(p.lightDirection); visit(p.directionalLight);
+    visit(p.enableJet); visit(p.jetStrength); visit(p.jetAngle);
+    visit(p.jetDirection); visit(p.jetParticleSpeed);
+    visit(p.enableExplosion); visit(p.explosionStrength); visit(p.explosionDuration); visit(p.explosionRadius);
+    visit(p.enableSelfGravity); visit(p.particleMass); visit(p.openingAngle); visit(p.gravitySoftening);
+    visit(p.enableSph); visit(p.sphSmoothingLength); visit(p.sphRestDensity);
+    visit(p.sphStiffness); visit(p.sphViscosity);
+    visit(p.integrator); visit(p.fixedTimeStep); visit(p.substeps);
+    visit(p.adaptiveTimeSteps); visit(p.timeStepAccuracy); visit(p.maxTimeBin);
+    visit(p.enableKeplerFastPath); visit(p.keplerCaptureRadius); visit(p.keplerInnerRadius);
+}
+
+void writeHeaderChunks(ChunkWriter& out, const ParticleSimulation& simulation) {
+    ParticleParameters params = simulation.getParameters();
+    out.beginChunk(ParametersTag);
+    ParameterWriter parameterWriter{ out };
+    visitParameters(params, parameterWriter);
+    out.endChunk();
+
+    const SimulationState state = simulation.getState();
+    out.beginChunk(StateTag);
+    out.put<uint64_t>(simulation.getParticleCount());
+    out.put(state.seed);
+    out.put(state.stepIndex);
+    out.put(state.explosionCount);
+    out.put(state.timeAccumulator);
+    out.put(state.explosionTimer);
+    out.put<uint8_t>(state.explosionActive ? 1 : 0);
+    out.put<uint8_t>(state.deterministic ? 1 : 0);
+    out.endChunk();
+}
+
+} // namespace
+
+void serializeSnapshot(const ParticleSimulation& simulation, std::vector<unsigned char>& data) {
+    const ParticleArrays particles = simulation.getParticles().arrays();
+    const size_t n = particles.count;
+    data.clear();
+    data.reserve(FileHeaderBytes + 4 * Alignment + n * (11 * sizeof(float) + 1) + 13 * Alignment
+        + simulation.getFreeSlotCount() * sizeof(uint32_t)
+        + simulation.getKeplerOrbits().getAnalyticCount() * (sizeof(uint32_t) + 12 * sizeof(float)) + 15 * Alignment);
+
+    ChunkWriter out(data);
+    out.fileHeader(SnapshotKind::State);
+    writeHeaderChunks(out, simulation);
+
+    out.beginChunk(ParticlesTag);
+    out.put<uint64_t>(n);
+    const float* floatArrays[] = {
+        particles.posX, particles.posY, particles.posZ,
+        particles.velX, particles.velY, particles.velZ,
+        particles.life,
+        particles.colorR, particles.colorG, particles.colorB,
+        particles.size
+    };
+    for (const float* values : floatArrays) {
+        out.putArray(values, n * sizeof(float));
+    }
+    out.putArray(particles.type, n);
+    out.endChunk();
+
+    out.beginChunk(FreeSlotsTag);
+    out.put<uint64_t>(simulation.getFreeSlotCount());
+    out.putArray(simulation.getFreeSlots(), simulation.getFreeSlotCount() * sizeof(uint32_t));
+    out.endChunk();
+
+    // 轨道根数在传播器中按块分段存放，每个数组把各段首尾相接写成一段连续数据
+    const KeplerPropagator& orbits = simulation.getKeplerOrbits();
+    const size_t segmentCount = orbits.getSegmentCount();
+    auto putSegments = [&](auto field, size_t elementBytes) {
+        out.align();
+        for (size_t segment = 0; segment < segmentCount; ++segment) {
+            const KeplerOrbitArrays arrays = orbits.getSegment(segment);
+            const size_t bytes = arrays.count * elementBytes;
+            if (bytes > 0) {
+                std::memcpy(out.reserve(bytes), arrays.*field, bytes);
+            }
+        }
+    };
+    out.beginChunk(KeplerTag);
+    out.put<uint64_t>(orbits.getAnalyticCount());
+    putSegments(&KeplerOrbitArrays::slot, sizeof(uint32_t));
+    const float* KeplerOrbitArrays::* orbitArrays[] = {
+        &KeplerOrbitArrays::meanAnomaly, &KeplerOrbitArrays::meanMotion,
+        &KeplerOrbitArrays::eccentricAnomaly, &KeplerOrbitArrays::cosAnomaly,
+        &KeplerOrbitArrays::eccentricity, &KeplerOrbitArrays::semiMajor,
+        &KeplerOrbitArrays::periX, &KeplerOrbitArrays::periY, &KeplerOrbitArrays::periZ,
+        &KeplerOrbitArrays::normalX, &KeplerOrbitArrays::normalY, &KeplerOrbitArrays::normalZ
+    };
+    for (auto field : orbitArrays) {
+        putSegments(field, sizeof(float));
+    }
+    out.endChunk();
+}
+
+bool SnapshotFile::open(const std::string& path) {
+    close();
+    if (!file.open(path, true)) {
+        std::cerr << "Failed to map snapshot: " << path << std::endl;
+        return false;
+    }
+
+    const unsigned char* data = file.data();
+    const size_t size = file.size();
+    uint32_t version = 0, kindValue = 0;
+    if (size < FileHeaderBytes || std::memcmp(data, SnapshotMagic, sizeof(SnapshotMagic)) != 0) {
+        std::cerr << path << " is not a snapshot file" << std::endl;
+        close();
+        return false;
+    }
+    std::memcpy(&version, data + 4, sizeof(version));
+    std::memcpy(&kindValue, data + 8, sizeof(kindValue));
+    if (version != SnapshotVersion || kindValue > static_cast<uint32_t>(SnapshotKind::Recording)) {
+        std::cerr << path << ": unsupported snapshot version " << version << std::endl;
+        close();
+        return false;
+    }
+    kind = static_cast<SnapshotKind>(kindValue);
+
+    // 只读块头；录制文件最后一块可能因为中途退出而不完整，此时丢弃该块
+    size_t offset = FileHeaderBytes;
+    while (size - offset >= ChunkHeaderBytes) {
+        uint32_t tag = 0;
+        uint64_t bytes = 0;
+        std::memcpy(&tag, data + offset, sizeof(tag));
+        std::memcpy(&bytes, data + offset + 8, sizeof(bytes));
+        const size_t payload = offset + ChunkHeaderBytes;
+        if (bytes > size - payload) {
+            break;
+        }
+        if (!parseChunk(tag, data + payload, static_cast<size_t>(bytes))) {
+            std::cerr << path << ": corrupt chunk at offset " << offset << std::endl;
+            close();
+            return false;
+        }
+        offset = alignUp(payload + static_cast<size_t>(bytes));
+        if (offset > size) {
+            break;
+        }
+    }
+
+    const bool complete = hasParameters && hasState && (kind == SnapshotKind::Recording || hasParticles);
+    if (!complete) {
+        std::cerr << path << ": snapshot is missing required chunks" << std::endl;
+        close();
+        return false;
+    }
+    if (kind == SnapshotKind::State && !validateState()) {
+        std::cerr << path << ": snapshot particle counts or slot indices are inconsistent" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotFile::validateState() const {
+    // 恢复与创建渲染缓冲分别按PART与STAT中的粒子数，两者必须一致
+    const size_t n = arrays.count;
+    if (particleCount != n || freeSlotCount > n || orbits.count > n) {
+        return false;
+    }
+    for (size_t i = 0; i < freeSlotCount; ++i) {
+        if (freeSlots[i] >= n) {
+            return false;
+        }
+    }
+    for (size_t k = 0; k < orbits.count; ++k) {
+        if (orbits.slot[k] >= n) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SnapshotFile::parseChunk(uint32_t tag, const unsigned char* payload, size_t bytes) {
+    ChunkReader in = { payload, payload + bytes };
+
+    if (tag == ParametersTag) {
+        ParameterReader reader{ in };
+        visitParameters(params, reader);
+        hasParameters = reader.ok;
+        return reader.ok;
+    }
+    if (tag == StateTag) {
+        uint64_t count = 0;
+        uint8_t explosionActive = 0, deterministic = 0;
+        if (!in.get(count) || !in.get(state.seed) || !in.get(state.stepIndex) || !in.get(state.explosionCount)
+            || !in.get(state.timeAccumulator) || !in.get(state.explosionTimer)
+            || !in.get(explosionActive) || !in.get(deterministic)) {
+            return false;
+        }
+        particleCount = static_cast<size_t>(count);
+        state.explosionActive = explosionActive != 0;
+        state.deterministic = deterministic != 0;
+        hasState = true;
+        return true;
+    }
+    if (tag == ParticlesTag) {
+        uint64_t count = 0;
+        if (!in.get(count)) {
+            return false;
+        }
+        const size_t n = static_cast<size_t>(count);
+        arrays.count = n;
+        hasParticles = in.getArray(arrays.posX, n) && in.getArray(arrays.posY, n) && in.getArray(arrays.posZ, n)
+            && in.getArray(arrays.velX, n) && in.getArray(arrays.velY, n) && in.getArray(arrays.velZ, n)
+            && in.getArray(arrays.life, n)
+            && in.getArray(arrays.colorR, n) && in.getArray(arrays.colorG, n) && in.getArray(arrays.colorB, n)
+            && in.getArray(arrays.size, n) && in.getArray(arrays.type, n);
+        return hasParticles;
+    }
+    if (tag == FreeSlotsTag) {
+        uint64_t count = 0;
+        if (!in.get(count) || !in.getArray(freeSlots, static_cast<size_t>(count))) {
+            return false;
+        }
+        freeSlotCount = static_cast<size_t>(count);
+        return true;
+    }
+    if (tag == KeplerTag) {
+        uint64_t count = 0;
+        if (!in.get(count)) {
+            return false;
+        }
+        const size_t n = static_cast<size_t>(count);
+        orbits.count = n;
+        hasOrbits = in.getArray(orbits.slot, n)
+            && in.getArray(orbits.meanAnomaly, n) && in.getArray(orbits.meanMotion, n)
+            && in.getArray(orbits.eccentricAnomaly, n) && in.getArray(orbits.cosAnomaly, n)
+            && in.getArray(orbits.eccentricity, n) && in.getArray(orbits.semiMajor, n)
+            && in.getArray(orbits.periX, n) && in.getArray(orbits.periY, n) && in.getArray(orbits.periZ, n)
+            && in.getArray(orbits.normalX, n) && in.getArray(orbits.normalY, n) && in.getArray(orbits.normalZ, n);
+        return hasOrbits;
+    }
+    if (tag == FrameTag) {
+        Frame frame;
+        uint32_t count = 0, reserved = 0;
+        if (!in.get(frame.stepIndex) || !in.get(count) || !in.get(reserved)
+            || static_cast<size_t>(in.end - in.cursor) / sizeof(ParticleInstance) < count) {
+            return false;
+        }
+        frame.instances = reinterpret_cast<const ParticleInstance*>(in.cursor);
+        frame.count = count;
+        frames.push_back(frame);
+        return true;
+    }
+    return true;
+}
+
+void SnapshotFile::close() {
+    file.close();
+    kind = SnapshotKind::State;
+    particleCount = 0;
+    hasParameters = false;
+    hasState = false;
+    hasParticles = false;
+    arrays = ParticleArrays();
+    freeSlots = nullptr;
+    freeSlotCount = 0;
+    orbits = KeplerOrbitArrays();
+    hasOrbits = false;
+    frames.clear();
+}
+
+bool SnapshotFile::restore(ParticleSimulation& simulation) const {
+    if (!isOpen() || kind != SnapshotKind::State) {
+        return false;
+    }
+    simulation.restoreState(params, state, arrays, freeSlots, freeSlotCount, hasOrbits ? &orbits : nullptr);
+    return true;
+}
+
+AsyncFileWriter::AsyncFileWriter() {
+    writer = std::thread(&AsyncFileWriter::writerLoop, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopRequested = true;
+    }
+    changed.notify_all();
+    writer.join();
+}
+
+std::vector<unsigned char> AsyncFileWriter::acquireBuffer() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (spareBuffers.empty()) {
+        return std::vector<unsigned char>();
+    }
+    std::vector<unsigned char> buffer = std::move(spareBuffers.back());
+    spareBuffers.pop_back();
+    buffer.clear();
+    return buffer;
+}
+
+void AsyncFileWriter::writeFile(const std::string& path, std::vector<unsigned char> data) {
+    submit(Job{ JobType::WriteFile, path, std::move(data) });
+}
+
+void AsyncFileWriter::openStream(const std::string& path) {
+    submit(Job{ JobType::OpenStream, path, {} });
+}
+
+void AsyncFileWriter::append(std::vector<unsigned char> data) {
+    submit(Job{ JobType::Append, std::string(), std::move(data) });
+}
+
+void AsyncFileWriter::closeStream() {
+    submit(Job{ JobType::CloseStream, std::string(), {} });
+}
+
+void AsyncFileWriter::submit(Job job) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return jobs.size() < MaxPendingJobs; });
+        jobs.push_back(std::move(job));
+    }
+    changed.notify_all();
+}
+
+void AsyncFileWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return jobs.empty() && !busy; });
+}
+
+bool AsyncFileWriter::hasFailed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+uint64_t AsyncFileWriter::getBytesWritten() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesWritten;
+}
+
+void AsyncFileWriter::writerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return !jobs.empty() || stopRequested; });
+            if (jobs.empty()) {
+                break;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            busy = true;
+        }
+        changed.notify_all();
+
+        const bool ok = execute(job);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+            if (ok) {
+                bytesWritten += job.data.size();
+            }
+            failed = failed || !ok;
+            if (!job.data.empty() && spareBuffers.size() < MaxPendingJobs) {
+                spareBuffers.push_back(std::move(job.data));
+            }
+        }
+        changed.notify_all();
+    }
+
+    if (stream) {
+        std::fclose(stream);
+        stream = nullptr;
+    }
+}
+
+bool AsyncFileWriter::execute(Job& job) {
+    switch (job.type) {
+    case JobType::WriteFile: {
+        const std::string temporary = job.path + ".tmp";
+        FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Failed to write " << temporary << std::endl;
+            return false;
+        }
+        const bool written = std::fwrite(job.data.data(), 1, job.data.size(), file) == job.data.size();
+        const bool closed = std::fclose(file) == 0;
+        std::error_code error;
+        if (written && closed) {
+            std::filesystem::rename(temporary, job.path, error);
+        }
+        if (!written || !closed || error) {
+            std::cerr << "Failed to write " << job.path << std::endl;
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+        return true;
+    }
+    case JobType::OpenStream:
+        if (stream) {
+            std::fclose(stream);
+        }
+        streamPath = job.path;
+        stream = std::fopen(job.path.c_str(), "wb");
+        if (!stream) {
+            std::cerr << "Failed to open " << job.path << std::endl;
+        }
+        return stream != nullptr;
+    case JobType::Append:
+        if (!stream || std::fwrite(job.data.data(), 1, job.data.size(), stream) != job.data.size()) {
+            std::cerr << "Failed to append to " << streamPath << std::endl;
+            return false;
+        }
+        return true;
+    case JobType::CloseStream: {
+        const bool ok = !stream || std::fclose(stream) == 0;
+        stream = nullptr;
+        return ok;
+    }
+    }
+    return false;
+}
+
+void SnapshotWriter::save(const ParticleSimulation& simulation, const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<unsigned char> data = io.acquireBuffer();
+    serializeSnapshot(simulation, data);
+    lastCopyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    io.writeFile(path, std::move(data));
+}
+
+void SnapshotRecorder::start(const std::string& path, const ParticleSimulation& simulation) {
+    stop();
+
+    std::vector<unsigned char> data = io.acquireBuffer();
+    ChunkWriter out(data);
+    out.fileHeader(SnapshotKind::Recording);
+    writeHeaderChunks(out, simulation);
+
+    io.openStream(path);
+    io.append(std::move(data));
+    recording = true;
+    frameCount = 0;
+}
+
+void SnapshotRecorder::recordFrame(const ParticleSimulation& simulation) {
+    if (!recording) {
+        return;
+    }
+
+    // 直接打包进块的负载，录制只比渲染多一次打包
+    std::vector<unsigned char> data = io.acquireBuffer();
+    data.reserve(ChunkHeaderBytes + 16 + simulation.getParticleCount() * sizeof(ParticleInstance) + Alignment);
+    ChunkWriter out(data);
+    out.beginChunk(FrameTag);
+    out.put<uint64_t>(simulation.getStepIndex());
+    const size_t countOffset = data.size();
+    out.put<uint32_t>(0);
+    out.put<uint32_t>(0);
+    ParticleInstance* instances = reinterpret_cast<ParticleInstance*>(
+        out.reserve(simulation.getParticleCount() * sizeof(ParticleInstance)));
+    const uint32_t count = static_cast<uint32_t>(simulation.packInstances(instances));
+    data.resize(countOffset + 8 + count * sizeof(ParticleInstance));
+    std::memcpy(data.data() + countOffset, &count, sizeof(count));
+    out.endChunk();
+
+    io.append(std::move(data));
+    ++frameCount;
+}
+
+void SnapshotRecorder::stop() {
+    if (!recording) {
+        return;
+    }
+    io.closeStream();
+    io.wait();
+    recording = false;
+}
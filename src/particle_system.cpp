@@ -1,95 +1,81 @@
 #include "particle_system.h"
-#include <random>
 #include <algorithm>
 #include <cmath>
-#include <glm/gtc/matrix_transform.hpp>  
+#include <cstring>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846f
 #endif
 
-ParticleSystem::ParticleSystem(int maxParticles) : maxParticles(maxParticles) {
-    setupSphereGeometry();
+const char* getRenderModeName(ParticleRenderMode mode) {
+    switch (mode) {
+    case ParticleRenderMode::Impostor: return "impostor";
+    default: return "mesh";
+    }
+}
 
-    initializeParticles();
+ParticleSystem::ParticleSystem(int maxParticles)
+    : simulation(maxParticles), maxParticles(maxParticles),
+      instanceBuffer(maxParticles * sizeof(ParticleInstance)), instanceOffset(0), instanceCount(0),
+      boundInstanceBuffer(0), boundInstanceOffset(0), cullingEnabled(true), cullingStats(), backend(SimulationBackend::CPU),
+      renderMode(ParticleRenderMode::Mesh), rewindEnabled(false), scrubFrame(-1) {
+    setupSphereGeometry();
     setupBuffers();
-
-    params.blackHoleMass = 5000.0f;
-    params.particleLifetime = 10.0f;
-    params.spiralStrength = 1.5f;
-    params.turbulenceStrength = 0.3f;
-    params.accretionDiskRadius = 25.0f;
-    params.particleSize = 0.1f;
-    params.colorIntensity = 2.0f;
-    params.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-    params.lightIntensity = 1.0f;
-    params.lightPosition = glm::vec3(10.0f, 10.0f, 10.0f);
-    params.lightDirection = glm::vec3(-1.0f, -1.0f, -1.0f);
-    params.directionalLight = false;
-
-    // 喷流参数
-    params.enableJet = false;
-    params.jetStrength = 5.0f;
-    params.jetAngle = 15.0f;
-    params.jetDirection = glm::vec3(0.0f, 1.0f, 0.0f);
-    params.jetParticleSpeed = 20.0f;
-
-    // 爆炸参数
-    params.enableExplosion = false;
-    params.explosionStrength = 10.0f;
-    params.explosionDuration = 2.0f;
-    params.explosionRadius = 15.0f;
-
-    // 特效状态
-    explosionTimer = 0.0f;
-    explosionActive = false;
 }
 
 ParticleSystem::~ParticleSystem() {
     glDeleteVertexArrays(1, &sphereVAO);
     glDeleteBuffers(1, &sphereVBO);
     glDeleteBuffers(1, &sphereEBO);
-    glDeleteBuffers(1, &instanceVBO);
 }
 
 void ParticleSystem::setupSphereGeometry() {
-    int stacks = 8;
-    int slices = 8;
+    // 各级LOD的经纬分段数，最粗一级为八面体
+    const int lodStacks[ParticleLodCount] = { 8, 6, 4, 2 };
+    const int lodSlices[ParticleLodCount] = { 8, 6, 4, 4 };
 
     sphereVertices.clear();
     sphereNormals.clear();
     sphereIndices.clear();
 
-    for (int i = 0; i <= stacks; ++i) {
-        float phi = M_PI * i / stacks;
-        for (int j = 0; j <= slices; ++j) {
-            float theta = 2.0f * M_PI * j / slices;
+    // 所有LOD共用一个顶点/索引缓冲，索引已加上各自的顶点基址
+    for (int lod = 0; lod < ParticleLodCount; ++lod) {
+        int stacks = lodStacks[lod];
+        int slices = lodSlices[lod];
+        unsigned int baseVertex = static_cast<unsigned int>(sphereVertices.size());
+        sphereLods[lod].firstIndex = sphereIndices.size();
+
+        for (int i = 0; i <= stacks; ++i) {
+            float phi = M_PI * i / stacks;
+            for (int j = 0; j <= slices; ++j) {
+                float theta = 2.0f * M_PI * j / slices;
 
-            float x = sin(phi) * cos(theta);
-            float y = cos(phi);
-            float z = sin(phi) * sin(theta);
+                float x = sin(phi) * cos(theta);
+                float y = cos(phi);
+                float z = sin(phi) * sin(theta);
 
-            sphereVertices.push_back(glm::vec3(x, y, z));
-            sphereNormals.push_back(glm::vec3(x, y, z));
+                sphereVertices.push_back(glm::vec3(x, y, z));
+                sphereNormals.push_back(glm::vec3(x, y, z));
+            }
         }
-    }
 
-    for (int i = 0; i < stacks; ++i) {
-        for (int j = 0; j < slices; ++j) {
-            int first = i * (slices + 1) + j;
-            int second = first + slices + 1;
+        for (int i = 0; i < stacks; ++i) {
+            for (int j = 0; j < slices; ++j) {
+                unsigned int first = baseVertex + i * (slices + 1) + j;
+                unsigned int second = first + slices + 1;
 
-            sphereIndices.push_back(first);
-            sphereIndices.push_back(second);
-            sphereIndices.push_back(first + 1);
+                sphereIndices.push_back(first);
+                sphereIndices.push_back(second);
+                sphereIndices.push_back(first + 1);
 
-            sphereIndices.push_back(first + 1);
-            sphereIndices.push_back(second);
-            sphereIndices.push_back(second + 1);
+                sphereIndices.push_back(first + 1);
+                sphereIndices.push_back(second);
+                sphereIndices.push_back(second + 1);
+            }
         }
-    }
 
-    sphereIndexCount = sphereIndices.size();
+        sphereLods[lod].indexCount = static_cast<GLsizei>(sphereIndices.size() - sphereLods[lod].firstIndex);
+    }
 
     glGenVertexArrays(1, &sphereVAO);
     glGenBuffers(1, &sphereVBO);
@@ -127,303 +113,225 @@ void ParticleSystem::setupSphereGeometry() {
     glBindVertexArray(0);
 }
 
-void ParticleSystem::initializeParticles() {
-    particles.resize(maxParticles);
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-    std::uniform_real_distribution<float> distColor(0.5f, 1.0f);
-
-    for (int i = 0; i < maxParticles; ++i) {
-        resetParticle(particles[i], gen, dist, distColor);
-        particles[i].type = 0; 
-    }
-}
-
-void ParticleSystem::resetParticle(Particle& p, std::mt19937& gen,
-    std::uniform_real_distribution<float>& dist,
-    std::uniform_real_distribution<float>& distColor) {
-    // 在吸积盘平面内随机位置
-    float angle = dist(gen) * 2.0f * M_PI;
-    float radius = 5.0f + dist(gen) * params.accretionDiskRadius;
-    float height = (dist(gen) - 0.5f) * 2.0f;
-
-    p.position = glm::vec3(
-        cos(angle) * radius,
-        height,
-        sin(angle) * radius
-    );
-
-    // 初始速度（轨道速度 + 随机分量）
-    float orbitalSpeed = sqrt(params.blackHoleMass / radius) * 0.8f;
-    glm::vec3 tangent = glm::normalize(glm::vec3(-sin(angle), 0.0f, cos(angle)));
-    glm::vec3 orbitalVelocity = tangent * orbitalSpeed;
-
-    // 向黑洞的径向速度
-    glm::vec3 radialDir = glm::normalize(-p.position);
-    glm::vec3 inwardVelocity = radialDir * (0.1f + dist(gen) * 0.3f);
-
-    p.velocity = orbitalVelocity + inwardVelocity;
-    p.velocity.y += (dist(gen) - 0.5f) * 0.5f;
-
-    p.life = params.particleLifetime * (0.8f + dist(gen) * 0.4f);
-    p.size = params.particleSize * (0.5f + dist(gen));
-
-    // 颜色基于位置和速度
-    float colorFactor = glm::length(p.velocity) / 10.0f;
-    p.color = glm::vec3(
-        0.3f + distColor(gen) * 0.7f * colorFactor,
-        0.3f + distColor(gen) * 0.5f * colorFactor,
-        1.0f
-    );
-
-    p.mass = 0.01f;
-    p.type = 0; 
-}
-
 void ParticleSystem::setupBuffers() {
-    // 创建实例化VBO用于粒子数据
-    glGenBuffers(1, &instanceVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(Particle), nullptr, GL_DYNAMIC_DRAW);
-
     glBindVertexArray(sphereVAO);
 
     // 实例位置
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)0);
     glVertexAttribDivisor(2, 1);
 
     // 实例颜色
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, color));
     glVertexAttribDivisor(3, 1);
 
     // 实例大小
     glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, size));
     glVertexAttribDivisor(4, 1);
 
+    bindInstanceAttributes(instanceBuffer.getBuffer(), 0);
+
     glBindVertexArray(0);
 }
 
-void ParticleSystem::update(float deltaTime, const glm::vec3& cameraPosition) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-    std::uniform_real_distribution<float> distColor(0.5f, 1.0f);
-
-    if (explosionActive) {
-        updateExplosionParticles(deltaTime);
-        explosionTimer -= deltaTime;
-        if (explosionTimer <= 0.0f) {
-            explosionActive = false;
-        }
+void ParticleSystem::bindInstanceAttributes(GLuint buffer, size_t baseOffset) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    // CPU环形缓冲与GPU压缩结果都是紧凑的ParticleInstance流
+    bool packedLayout = backend == SimulationBackend::CPU || buffer == gpuSimulation->getCompactBuffer();
+    if (packedLayout) {
+        // 环形缓冲每帧写入不同的段，通过属性偏移指向当前段
+        const GLsizei stride = sizeof(ParticleInstance);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(baseOffset + offsetof(ParticleInstance, position)));
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(baseOffset + offsetof(ParticleInstance, color)));
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, (void*)(baseOffset + offsetof(ParticleInstance, size)));
     }
-
-    if (params.enableJet) {
-        updateJetParticles(deltaTime);
+    else {
+        // GPU后端直接从变换反馈结果中读取实例属性
+        const GLsizei stride = sizeof(GpuParticleState);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(baseOffset + offsetof(GpuParticleState, position)));
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)(baseOffset + offsetof(GpuParticleState, color)));
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, (void*)(baseOffset + offsetof(GpuParticleState, size)));
     }
 
-    for (auto& p : particles) {
-        if (p.life <= 0.0f && p.type == 0) { // 只重置正常粒子
-            resetParticle(p, gen, dist, distColor);
-            continue;
-        }
+    boundInstanceBuffer = buffer;
+    boundInstanceOffset = baseOffset;
+}
 
-        // 计算到黑洞的距离
-        float distance = glm::length(p.position);
+void ParticleSystem::setBackend(SimulationBackend newBackend) {
+    if (newBackend == backend) {
+        return;
+    }
 
-        if (distance < 0.5f && p.type == 0) {
-            // 粒子被黑洞吞噬
-            p.life = 0.0f;
-            continue;
+    if (newBackend == SimulationBackend::GPU) {
+        setRewindEnabled(false);
+        if (!gpuSimulation) {
+            gpuSimulation.reset(new GpuParticleSimulation(maxParticles));
         }
+        // 从CPU的当前状态继续；切回CPU时沿用CPU端切换前的状态
+        gpuSimulation->upload(simulation.getParticles());
+    }
+    backend = newBackend;
+}
 
-        glm::vec3 gravityDir = glm::normalize(-p.position);
-
-        // 牛顿引力 + 相对论经验修正
-        float gravity = params.blackHoleMass / (distance * distance);
-        float relFactor = 1.0f + 2.0f / (distance + 0.5f); 
-
-        // 螺旋吸积效应
-        glm::vec3 spiralForce = glm::cross(gravityDir, glm::vec3(0.0f, 1.0f, 0.0f)) * params.spiralStrength;
-
-        // 湍流效应
-        glm::vec3 turbulence = glm::vec3(
-            (dist(gen) - 0.5f) * 2.0f,
-            (dist(gen) - 0.5f) * 2.0f,
-            (dist(gen) - 0.5f) * 2.0f
-        ) * params.turbulenceStrength;
-
-        glm::vec3 acceleration = gravityDir * gravity * relFactor + spiralForce + turbulence;
+void ParticleSystem::setRewindEnabled(bool enabled) {
+    rewindEnabled = enabled && backend == SimulationBackend::CPU;
+    if (!rewindEnabled) {
+        scrubFrame = -1;
+        rewind.clear();
+    }
+}
 
-        // 只有正常粒子受黑洞引力影响
-        if (p.type == 0) {
-            p.velocity += acceleration * deltaTime;
-        }
+void ParticleSystem::setScrubFrame(int frame) {
+    const int frameCount = static_cast<int>(rewind.getFrameCount());
+    scrubFrame = rewindEnabled && frame >= 0 && frameCount > 0 ? std::min(frame, frameCount - 1) : -1;
+}
 
-        // 速度限制
-        float speed = glm::length(p.velocity);
-        if (speed > 100.0f) {
-            p.velocity = glm::normalize(p.velocity) * 100.0f;
-        }
+void ParticleSystem::triggerExplosionEffect() {
+    if (backend == SimulationBackend::GPU) {
+        gpuSimulation->triggerExplosion();
+    }
+    else {
+        simulation.triggerExplosion();
+    }
+}
 
-        p.position += p.velocity * deltaTime;
+void ParticleSystem::update(float deltaTime, const glm::vec3& cameraPosition) {
+    if (backend == SimulationBackend::GPU) {
+        gpuSimulation->update(deltaTime, simulation.getParameters(), simulation.getSeed());
+        return;
+    }
 
-        if (p.type == 0) {
-            // 正常粒子受潮汐力影响
-            float tidalFactor = 1.0f + 5.0f / (distance * distance + 0.1f);
-            p.life -= deltaTime * tidalFactor;
-        }
-        else if (p.type == 1 || p.type == 2) {
-            // 特效粒子固定寿命衰减
-            p.life -= deltaTime;
-        }
+    // 回看时模拟暂停，回到实时后从暂停处继续
+    if (scrubFrame >= 0) {
+        return;
+    }
 
-        if (p.type == 0) {
-            // 正常粒子颜色
-            float speedFactor = glm::length(p.velocity) / 50.0f;
-            float energyRelease = 1.0f / (distance + 0.5f);
+    // 固定步长推进；实例打包依赖相机矩阵与插值系数，推迟到render中进行
+    simulation.advance(deltaTime);
 
-            p.color.r = 0.5f + energyRelease * 0.5f;
-            p.color.g = 0.3f + speedFactor * 0.5f;
-            p.color.b = 1.0f - energyRelease * 0.3f;
+    if (rewindEnabled) {
+        if (rewind.getThreadCount() != simulation.getThreadCount()) {
+            rewind.setThreadCount(simulation.getThreadCount());
         }
-        else if (p.type == 1) {
-            // 喷流粒子 - 黄色/橙色
-            p.color = glm::vec3(1.0f, 0.8f, 0.2f);
-        }
-        else if (p.type == 2) {
-            // 爆炸粒子 - 红色/橙色
-            float lifeRatio = p.life / 3.0f;
-            p.color = glm::vec3(1.0f, 0.5f * lifeRatio, 0.1f * lifeRatio);
-        }
-
-        p.color = glm::clamp(p.color, 0.0f, 1.0f);
+        rewind.capture(simulation);
     }
-
-    updateBuffers();
 }
 
-void ParticleSystem::updateJetParticles(float deltaTime) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
-    // 在黑洞附近生成喷流粒子
-    int jetParticlesToCreate = 5;
-
-    for (int i = 0; i < jetParticlesToCreate; ++i) {
-        for (auto& p : particles) {
-            if (p.life <= 0.0f) {
-                // 在黑洞中心重置为喷流粒子
-                p.position = glm::vec3(0.0f);
+void ParticleSystem::updateBuffers(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos,
+    float viewportHeight) {
+    // 只上传着色器需要的位置、颜色和大小；持久映射时直接写入GPU可见内存
+    ParticleInstance* instances = static_cast<ParticleInstance*>(instanceBuffer.beginWrite());
 
-                // 计算喷流方向（在锥形范围内随机）
-                float angle = params.jetAngle * M_PI / 180.0f;
-                float randomAngle = dist(gen) * angle;
-                float randomRotation = dist(gen) * 2.0f * M_PI;
-
-                glm::vec3 jetDir = params.jetDirection;
-
-                glm::vec3 axis = glm::vec3(cos(randomRotation), 0.0f, sin(randomRotation));
-                glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), randomAngle, axis);
+    if (cullingEnabled) {
+        CullingView cullingView = CullingView::fromCamera(projection, view, viewPos,
+            viewportHeight, HorizonCullRadius);
+        instanceCount = cullAndPackInstances(simulation.getParticles(),
+            simulation.getRenderInterpolation(), cullingView, lodScratch, instances, cullingStats);
+    }
+    else {
+        instanceCount = simulation.packInstances(instances);
+        cullingStats = CullingStats();
+        cullingStats.deadSkipped = simulation.getParticles().count() - instanceCount;
+        cullingStats.drawn[0] = instanceCount;
+    }
 
-                glm::vec3 randomDir = glm::vec3(rotationMatrix * glm::vec4(jetDir, 1.0f));
+    instanceOffset = instanceBuffer.endWrite(instanceCount * sizeof(ParticleInstance));
+}
 
-                p.velocity = randomDir * params.jetParticleSpeed;
-                p.life = 2.0f;
-                p.size = params.particleSize * 0.3f;
-                p.color = glm::vec3(1.0f, 0.8f, 0.2f);
-                p.type = 1; // 喷流粒子
+void ParticleSystem::fillLightUniforms(FrameUniforms& frame) const {
+    const ParticleParameters& params = simulation.getParameters();
+    frame.lightColor = params.lightColor;
+    frame.lightIntensity = params.lightIntensity;
+    frame.lightPos = params.lightPosition;
+    frame.lightDir = params.lightDirection;
+    frame.directionalLight = params.directionalLight ? 1 : 0;
+    frame.colorIntensity = params.colorIntensity;
+}
 
-                break;
-            }
-        }
+void ParticleSystem::prepareRender(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos,
+    float viewportHeight) {
+    if (backend == SimulationBackend::CPU && scrubFrame >= 0) {
+        const std::vector<ParticleInstance>& instances = rewind.reconstruct(static_cast<size_t>(scrubFrame));
+        prepareReplay(instances.data(), instances.size());
+    }
+    else if (backend == SimulationBackend::CPU) {
+        updateBuffers(projection, view, viewPos, viewportHeight);
+    }
+    else if (gpuSimulation->hasCompaction()) {
+        // 计算着色器会切换当前程序，需在设置粒子着色器之前完成
+        GLuint drawCount = renderMode == ParticleRenderMode::Impostor ? 4 : sphereLods[0].indexCount;
+        gpuSimulation->compactLiveInstances(drawCount);
     }
 }
 
-void ParticleSystem::triggerExplosion() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-
-    // 重置爆炸状态
-    explosionActive = true;
-    explosionTimer = params.explosionDuration;
-
-    // 创建爆炸粒子
-    int explosionParticles = 500;
-
-    for (int i = 0; i < explosionParticles; ++i) {
-        for (auto& p : particles) {
-            if (p.life <= 0.0f) {
-                // 在黑洞中心创建爆炸粒子
-                p.position = glm::vec3(0.0f);
-
-                // 随机方向
-                float theta = dist(gen) * 2.0f * M_PI;
-                float phi = acos(2.0f * dist(gen) - 1.0f);
+void ParticleSystem::prepareReplay(const ParticleInstance* instances, size_t count) {
+    count = std::min(count, static_cast<size_t>(maxParticles));
+    ParticleInstance* out = static_cast<ParticleInstance*>(instanceBuffer.beginWrite());
+    std::memcpy(out, instances, count * sizeof(ParticleInstance));
+    instanceCount = count;
+    cullingStats = CullingStats();
+    cullingStats.drawn[0] = count;
+    instanceOffset = instanceBuffer.endWrite(count * sizeof(ParticleInstance));
+}
 
-                p.velocity = glm::vec3(
-                    sin(phi) * cos(theta),
-                    sin(phi) * sin(theta),
-                    cos(phi)
-                ) * params.explosionStrength * (0.8f + dist(gen) * 0.4f);
+void ParticleSystem::render(Shader& shader) {
+    shader.use();
 
-                p.life = 3.0f;
-                p.size = params.particleSize * (0.8f + dist(gen) * 0.4f);
-                p.color = glm::vec3(1.0f, 0.5f, 0.1f);
-                p.type = 2; // 爆炸粒子
+    // 两种渲染模式共用同一个VAO中的实例属性，impostor模式不读取球体顶点
+    glBindVertexArray(sphereVAO);
+    if (backend == SimulationBackend::GPU && gpuSimulation->hasCompaction()) {
+        // 存活数量由GPU写入间接命令，CPU不回读；GPU后端不做剔除，按最精细的LOD绘制
+        GLuint compactBuffer = gpuSimulation->getCompactBuffer();
+        if (compactBuffer != boundInstanceBuffer || boundInstanceOffset != 0) {
+            bindInstanceAttributes(compactBuffer, 0);
+        }
 
-                break;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gpuSimulation->getDrawCommandBuffer());
+        if (renderMode == ParticleRenderMode::Impostor) {
+            glDrawArraysIndirect(GL_TRIANGLE_STRIP, 0);
+        }
+        else {
+            glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else if (backend == SimulationBackend::GPU) {
+        // 不支持计算着色器时绘制全部槽位
+        drawInstances(0, 0, gpuSimulation->getParticleCount());
+    }
+    else if (renderMode == ParticleRenderMode::Impostor) {
+        // 四边形与LOD无关，各桶连续存放，一次绘制全部
+        drawInstances(0, instanceOffset, static_cast<GLsizei>(instanceCount));
+    }
+    else {
+        // 每个LOD一次实例化绘制，实例属性偏移指向该LOD的桶
+        for (int lod = 0; lod < ParticleLodCount; ++lod) {
+            if (cullingStats.drawn[lod] == 0) {
+                continue;
             }
+            drawInstances(lod, instanceOffset + cullingStats.lodOffset[lod] * sizeof(ParticleInstance),
+                static_cast<GLsizei>(cullingStats.drawn[lod]));
         }
     }
-}
-
-void ParticleSystem::updateExplosionParticles(float deltaTime) {
-    // 爆炸粒子会自然衰减，不需要特殊更新
-    // 生命周期已经在主更新循环中处理
-}
+    glBindVertexArray(0);
 
-void ParticleSystem::updateBuffers() {
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, particles.size() * sizeof(Particle), particles.data());
+    if (backend == SimulationBackend::CPU) {
+        instanceBuffer.fence();
+    }
 }
 
-void ParticleSystem::render(Shader& shader, const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos) {
-    shader.use();
-
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
-
-    shader.setVec3("lightColor", params.lightColor);
-    shader.setFloat("lightIntensity", params.lightIntensity);
-    shader.setVec3("lightPos", params.lightPosition);
-    shader.setVec3("lightDir", params.lightDirection);
-    shader.setBool("directionalLight", params.directionalLight);
-
-    shader.setFloat("colorIntensity", params.colorIntensity);
-    shader.setVec3("viewPos", viewPos);
+void ParticleSystem::drawInstances(int lod, size_t baseOffset, GLsizei count) {
+    // GPU后端的乒乓缓冲每帧交换，需要重新指向本帧的输出
+    GLuint buffer = backend == SimulationBackend::GPU ? gpuSimulation->getStateBuffer() : instanceBuffer.getBuffer();
+    if (buffer != boundInstanceBuffer || baseOffset != boundInstanceOffset) {
+        bindInstanceAttributes(buffer, baseOffset);
+    }
 
-    glBindVertexArray(sphereVAO);
-    glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0, particles.size());
-    glBindVertexArray(0);
+    if (renderMode == ParticleRenderMode::Impostor) {
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    }
+    else {
+        glDrawElementsInstanced(GL_TRIANGLES, sphereLods[lod].indexCount, GL_UNSIGNED_INT,
+            (void*)(sphereLods[lod].firstIndex * sizeof(unsigned int)), count);
+    }
 }
-
-void ParticleSystem::applyEffect(const ParticleEffect& effect) {
-    params.blackHoleMass = effect.blackHoleMass;
-    params.particleLifetime = effect.particleLifetime;
-    params.spiralStrength = effect.spiralStrength;
-    params.turbulenceStrength = effect.turbulenceStrength;
-    params.accretionDiskRadius = effect.accretionDiskRadius;
-    params.particleSize = effect.particleSize;
-    params.colorIntensity = effect.colorIntensity;
-    params.enableJet = effect.enableJet;
-    params.jetStrength = effect.jetStrength;
-    params.enableExplosion = effect.enableExplosion;
-    params.explosionStrength = effect.explosionStrength;
-}
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+Profiler::Profiler()
+    : sectionCount(0), frameIndex(0), epoch(Clock::now()), frameStart(epoch), gpuSection(-1),
+      droppedGpuSamples(0), waitForGpu(false) {
+    for (int s = 0; s < MaxSections; ++s) {
+        sectionNames[s] = nullptr;
+        for (int row = 0; row < HistoryFrames; ++row) {
+            cpuMs[s][row] = -1.0f;
+            gpuMs[s][row] = -1.0f;
+            sectionStartUs[s][row] = -1.0;
+            gpuDropped[s][row] = false;
+        }
+    }
+    for (int row = 0; row < HistoryFrames; ++row) {
+        frameMs[row] = -1.0f;
+        frameStartUs[row] = 0.0;
+    }
+
+    glGenQueries(QueryFrames * MaxSections, &queries[0][0]);
+    for (int slot = 0; slot < QueryFrames; ++slot) {
+        queryFrame[slot] = 0;
+        for (int s = 0; s < MaxSections; ++s) {
+            queryIssued[slot][s] = false;
+        }
+    }
+}
+
+Profiler::~Profiler() {
+    glDeleteQueries(QueryFrames * MaxSections, &queries[0][0]);
+}
+
+void Profiler::beginFrame() {
+    frameStart = Clock::now();
+
+    // 本帧要复用的查询组是QueryFrames帧之前发出的，先取回其中已经就绪的结果
+    const int slot = static_cast<int>(frameIndex % QueryFrames);
+    collectGpuResults(slot);
+    queryFrame[slot] = frameIndex;
+
+    const int row = static_cast<int>(frameIndex % HistoryFrames);
+    frameMs[row] = -1.0f;
+    frameStartUs[row] = microsecondsSince(frameStart);
+    for (int s = 0; s < MaxSections; ++s) {
+        cpuMs[s][row] = -1.0f;
+        gpuMs[s][row] = -1.0f;
+        sectionStartUs[s][row] = -1.0;
+        gpuDropped[s][row] = false;
+    }
+}
+
+void Profiler::endFrame() {
+    const int row = static_cast<int>(frameIndex % HistoryFrames);
+    frameMs[row] = static_cast<float>(std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+    ++frameIndex;
+}
+
+void Profiler::finish() {
+    glFinish();
+    for (int slot = 0; slot < QueryFrames; ++slot) {
+        const bool wait = waitForGpu;
+        waitForGpu = true;
+        collectGpuResults(slot);
+        waitForGpu = wait;
+    }
+}
+
+int Profiler::beginSection(const char* name) {
+    const int section = findSection(name);
+    if (section < 0) {
+        return -1;
+    }
+
+    sectionStart[section] = Clock::now();
+    const int row = static_cast<int>(frameIndex % HistoryFrames);
+    if (sectionStartUs[section][row] < 0.0) {
+        sectionStartUs[section][row] = microsecondsSince(sectionStart[section]);
+    }
+
+    // 一帧内同一段多次出现时只对第一次发出GPU查询
+    const int slot = static_cast<int>(frameIndex % QueryFrames);
+    if (gpuSection < 0 && !queryIssued[slot][section]) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot][section]);
+        queryIssued[slot][section] = true;
+        gpuSection = section;
+    }
+    return section;
+}
+
+void Profiler::endSection(int section) {
+    if (section < 0) {
+        return;
+    }
+    if (gpuSection == section) {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuSection = -1;
+    }
+
+    const float ms = static_cast<float>(
+        std::chrono::duration<double, std::milli>(Clock::now() - sectionStart[section]).count());
+    float& sample = cpuSample(section, frameIndex);
+    sample = sample < 0.0f ? ms : sample + ms;
+}
+
+int Profiler::findSection(const char* name) {
+    for (int s = 0; s < sectionCount; ++s) {
+        if (sectionNames[s] == name || std::strcmp(sectionNames[s], name) == 0) {
+            return s;
+        }
+    }
+    if (sectionCount == MaxSections) {
+        return -1;
+    }
+    sectionNames[sectionCount] = name;
+    return sectionCount++;
+}
+
+void Profiler::collectGpuResults(int slot) {
+    for (int s = 0; s < sectionCount; ++s) {
+        if (!queryIssued[slot][s]) {
+            continue;
+        }
+        queryIssued[slot][s] = false;
+
+        if (!waitForGpu) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[slot][s], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                ++droppedGpuSamples;
+                if (frameIndex - queryFrame[slot] < HistoryFrames) {
+                    gpuDropped[s][queryFrame[slot] % HistoryFrames] = true;
+                }
+                continue;
+            }
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[slot][s], GL_QUERY_RESULT, &nanoseconds);
+        if (frameIndex - queryFrame[slot] < HistoryFrames) {
+            gpuMs[s][queryFrame[slot] % HistoryFrames] = static_cast<float>(nanoseconds / 1.0e6);
+        }
+    }
+}
+
+double Profiler::microsecondsSince(Clock::time_point time) const {
+    return std::chrono::duration<double, std::micro>(time - epoch).count();
+}
+
+float Profiler::getSample(int section, bool gpu, uint64_t frame) const {
+    if (frame >= frameIndex || frameIndex - frame > HistoryFrames) {
+        return -1.0f;
+    }
+    const int row = static_cast<int>(frame % HistoryFrames);
+    return section < 0 ? frameMs[row] : (gpu ? gpuMs[section][row] : cpuMs[section][row]);
+}
+
+bool Profiler::isGpuSampleDropped(int section, uint64_t frame) const {
+    if (section < 0 || frame >= frameIndex || frameIndex - frame > HistoryFrames) {
+        return false;
+    }
+    return gpuDropped[section][frame % HistoryFrames];
+}
+
+Profiler::Stats Profiler::getStats(int section, bool gpu) const {
+    // 当前帧所在的行还没有写完，只统计之前已结束的帧
+    const uint64_t frames = std::min<uint64_t>(frameIndex, HistoryFrames - 1);
+    std::vector<float> values;
+    values.reserve(frames);
+    for (uint64_t frame = frameIndex - frames; frame < frameIndex; ++frame) {
+        const int row = static_cast<int>(frame % HistoryFrames);
+        const float value = section < 0 ? frameMs[row] : (gpu ? gpuMs[section][row] : cpuMs[section][row]);
+        if (value >= 0.0f) {
+            values.push_back(value);
+        }
+    }
+
+    Stats stats = { 0.0f, 0.0f, 0.0f, 0.0f, static_cast<int>(values.size()) };
+    if (values.empty()) {
+        return stats;
+    }
+    stats.last = values.back();
+    stats.min = *std::min_element(values.begin(), values.end());
+    double sum = 0.0;
+    for (float value : values) {
+        sum += value;
+    }
+    stats.avg = static_cast<float>(sum / values.size());
+
+    const size_t rank = static_cast<size_t>(std::ceil(values.size() * 0.99)) - 1;
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    stats.p99 = values[rank];
+    return stats;
+}
+
+void Profiler::copyHistory(int section, bool gpu, float* values) const {
+    for (int i = 0; i < HistoryFrames; ++i) {
+        const int64_t frame = static_cast<int64_t>(frameIndex) - HistoryFrames + i;
+        float value = -1.0f;
+        if (frame >= 0) {
+            const int row = static_cast<int>(frame % HistoryFrames);
+            value = section < 0 ? frameMs[row] : (gpu ? gpuMs[section][row] : cpuMs[section][row]);
+        }
+        values[i] = std::max(value, 0.0f);
+    }
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    // CPU段放在线程1，GPU段放在线程2。GL_TIME_ELAPSED只给出时长，
+    // GPU事件的起点取该段在CPU上提交的时刻，只表示先后顺序
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    const uint64_t frames = std::min<uint64_t>(frameIndex, HistoryFrames - 1);
+    for (uint64_t frame = frameIndex - frames; frame < frameIndex; ++frame) {
+        const int row = static_cast<int>(frame % HistoryFrames);
+        if (frameMs[row] < 0.0f) {
+            continue;
+        }
+        file << ",\n{\"name\":\"Frame " << frame << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+            << frameStartUs[row] << ",\"dur\":" << frameMs[row] * 1000.0 << "}";
+
+        for (int s = 0; s < sectionCount; ++s) {
+            if (sectionStartUs[s][row] < 0.0) {
+                continue;
+            }
+            if (cpuMs[s][row] >= 0.0f) {
+                file << ",\n{\"name\":\"" << sectionNames[s] << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+                    << sectionStartUs[s][row] << ",\"dur\":" << cpuMs[s][row] * 1000.0 << "}";
+            }
+            if (gpuMs[s][row] >= 0.0f) {
+                file << ",\n{\"name\":\"" << sectionNames[s] << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":"
+                    << sectionStartUs[s][row] << ",\"dur\":" << gpuMs[s][row] * 1000.0 << "}";
+            }
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,478 @@
+#include "rewind_buffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+const float InversePositionStep = 1.0f / RewindBuffer::PositionStep;
+const uint64_t InvalidSerial = ~0ull;
+const int8_t ColorEscape = -128;
+
+// 就近舍入到偶数的float转fp16，只用整数运算；溢出为无穷大，NaN保持为NaN
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    bits &= 0x7fffffffu;
+
+    if (bits >= 0x47800000u) {
+        // 超出fp16范围
+        return static_cast<uint16_t>(sign | (bits > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    }
+    if (bits < 0x38800000u) {
+        // 结果为非规格化数或零：借助浮点加法完成移位与舍入
+        float shifted;
+        std::memcpy(&shifted, &bits, sizeof(bits));
+        shifted += 0.5f;
+        uint32_t result;
+        std::memcpy(&result, &shifted, sizeof(result));
+        return static_cast<uint16_t>(sign | (result - 0x3f000000u));
+    }
+    const uint32_t mantissaOdd = (bits >> 13) & 1u;
+    bits += 0xc8000fffu + mantissaOdd;     // 指数减去112，加上舍入偏置
+    return static_cast<uint16_t>(sign | (bits >> 13));
+}
+
+// fp16解码查表，每个值只需一次查找
+const float* halfTable() {
+    static const std::vector<float> table = [] {
+        std::vector<float> values(65536);
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = glm::unpackHalf1x16(static_cast<uint16_t>(i));
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+// 残差取整到最近的量化格；超出范围时返回false，调用方改存原值
+bool quantize(float value, float predicted, float limit, int& residual) {
+    const float steps = (value - predicted) * InversePositionStep;
+    if (!(std::fabs(steps) <= limit)) {
+        return false;
+    }
+    residual = static_cast<int>(steps);
+    const float fraction = steps - static_cast<float>(residual);
+    residual += (fraction >= 0.5f) - (fraction <= -0.5f);
+    return true;
+}
+
+// fp16颜色通道：差值在8位范围内时只存差值，否则存转义标记与原值
+inline void encodeChannel(uint16_t value, uint16_t& previous, int8_t*& deltas, uint16_t*& colors) {
+    const int delta = static_cast<int>(value) - static_cast<int>(previous);
+    if (delta >= -127 && delta <= 127) {
+        *deltas++ = static_cast<int8_t>(delta);
+    }
+    else {
+        *deltas++ = ColorEscape;
+        *colors++ = value;
+    }
+    previous = value;
+}
+
+inline uint16_t decodeChannel(uint16_t& previous, const int8_t*& deltas, const uint16_t*& colors) {
+    const int8_t delta = *deltas++;
+    previous = delta == ColorEscape ? *colors++ : static_cast<uint16_t>(previous + delta);
+    return previous;
+}
+
+// 块内各段的起点，编码与解码共用；块长度按4字节对齐，下一块的float段仍然对齐
+struct BlockLayout {
+    size_t raw, colors, sizes, large, modes, small, colorDeltas, total;
+
+    BlockLayout(size_t slots, uint32_t rawCount, uint32_t colorCount, uint32_t largeCount, uint32_t smallCount) {
+        raw = 0;
+        colors = raw + rawCount * 3 * sizeof(float);
+        sizes = colors + colorCount * sizeof(uint16_t);
+        large = sizes + rawCount * sizeof(uint16_t);
+        modes = large + largeCount * 3 * sizeof(int16_t);
+        small = modes + (slots + 3) / 4;
+        colorDeltas = small + smallCount * 3;
+        total = (colorDeltas + (smallCount + largeCount) * 3 + 3) & ~size_t(3);
+    }
+};
+
+} // namespace
+
+RewindBuffer::RewindBuffer(size_t budgetBytes, int keyframeInterval)
+    : budgetBytes(budgetBytes), keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1) {
+    clear();
+}
+
+void RewindBuffer::clear() {
+    frames.clear();
+    spareData.clear();
+    slotCount = 0;
+    firstSerial = 0;
+    lastStep = InvalidSerial;
+    framesSinceKeyframe = keyframeInterval;
+    memoryBytes = 0;
+    rawBytes = 0;
+    lastEncodeMs = 0.0;
+    lastDecodeMs = 0.0;
+    decodedSerial = InvalidSerial;
+    decoded.clear();
+}
+
+void RewindBuffer::capture(const ParticleSimulation& simulation) {
+    const uint64_t step = simulation.getStepIndex();
+    if (step == lastStep) {
+        return;
+    }
+    const ParticleStore& particles = simulation.getParticles();
+    const size_t count = particles.count();
+    if (count != slotCount || lastStep == InvalidSerial || step < lastStep) {
+        // 旧帧不再能与当前状态接上
+        clear();
+        slotCount = count;
+        encoder.assign(count, Predictor());
+        rawScratch.resize(count * 3);
+        colorScratch.resize(count * 3);
+        sizeScratch.resize(count);
+        largeScratch.resize(count * 3);
+        modeScratch.resize((count + 3) / 4);
+        smallScratch.resize(count * 3);
+        colorDeltaScratch.resize(count * 3);
+    }
+    lastStep = step;
+
+    auto start = std::chrono::steady_clock::now();
+    frames.emplace_back();
+    EncodedFrame& frame = frames.back();
+    frame.stepIndex = step;
+    frame.keyframe = framesSinceKeyframe >= keyframeInterval;
+    framesSinceKeyframe = frame.keyframe ? 1 : framesSinceKeyframe + 1;
+
+    const size_t blockCount = (count + BlockSize - 1) / BlockSize;
+    frame.blocks.resize(blockCount);
+    threadPool.parallelFor(0, blockCount, 1, [&](size_t begin, size_t end, int) {
+        for (size_t block = begin; block < end; ++block) {
+            encodeBlock(particles, frame.keyframe, block, frame.blocks[block]);
+        }
+    });
+
+    size_t total = 0;
+    frame.liveCount = 0;
+    for (size_t block = 0; block < blockCount; ++block) {
+        Block& info = frame.blocks[block];
+        info.offset = total;
+        total += BlockLayout(std::min(BlockSize, count - block * BlockSize),
+            info.raw, info.colors, info.large, info.small).total;
+        frame.liveCount += info.live;
+    }
+
+    // 暂存区按实际大小复制进帧
+    frame.data = acquireData(total);
+    threadPool.parallelFor(0, blockCount, 1, [&](size_t begin, size_t end, int) {
+        for (size_t block = begin; block < end; ++block) {
+            const Block& info = frame.blocks[block];
+            const size_t first = block * BlockSize;
+            const size_t slots = std::min(BlockSize, count - first);
+            const BlockLayout layout(slots, info.raw, info.colors, info.large, info.small);
+            unsigned char* data = frame.data.data() + info.offset;
+            std::memcpy(data + layout.raw, rawScratch.data() + first * 3, info.raw * 3 * sizeof(float));
+            std::memcpy(data + layout.colors, colorScratch.data() + first * 3, info.colors * sizeof(uint16_t));
+            std::memcpy(data + layout.sizes, sizeScratch.data() + first, info.raw * sizeof(uint16_t));
+            std::memcpy(data + layout.large, largeScratch.data() + first * 3, info.large * 3 * sizeof(int16_t));
+            std::memcpy(data + layout.modes, modeScratch.data() + first / 4, (slots + 3) / 4);
+            std::memcpy(data + layout.small, smallScratch.data() + first * 3, info.small * 3);
+            std::memcpy(data + layout.colorDeltas, colorDeltaScratch.data() + first * 3, (info.small + info.large) * 3);
+        }
+    });
+
+    memoryBytes += frame.bytes();
+    rawBytes += frame.liveCount * sizeof(ParticleInstance);
+    evict();
+    lastEncodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<unsigned char> RewindBuffer::acquireData(size_t bytes) {
+    // 取容量够用且浪费不超过四分之一的最小缓冲，否则重新分配
+    size_t best = spareData.size();
+    for (size_t i = 0; i < spareData.size(); ++i) {
+        const size_t capacity = spareData[i].capacity();
+        if (capacity >= bytes && capacity - bytes <= bytes / 4
+            && (best == spareData.size() || capacity < spareData[best].capacity())) {
+            best = i;
+        }
+    }
+    if (best == spareData.size()) {
+        return std::vector<unsigned char>(bytes);
+    }
+    std::vector<unsigned char> data = std::move(spareData[best]);
+    spareData[best] = std::move(spareData.back());
+    spareData.pop_back();
+    data.resize(bytes);
+    return data;
+}
+
+void RewindBuffer::evict() {
+    // 只能整组丢弃：最旧的关键帧被丢弃后，依赖它的差分帧也无法解码
+    while (memoryBytes > budgetBytes) {
+        size_t groupEnd = 1;
+        while (groupEnd < frames.size() && !frames[groupEnd].keyframe) {
+            ++groupEnd;
+        }
+        if (groupEnd == frames.size()) {
+            // 只剩一组时提前开始新的一组，下次记录后即可丢弃这一组
+            framesSinceKeyframe = keyframeInterval;
+            return;
+        }
+        for (size_t i = 0; i < groupEnd; ++i) {
+            memoryBytes -= frames.front().bytes();
+            rawBytes -= frames.front().liveCount * sizeof(ParticleInstance);
+            spareData.push_back(std::move(frames.front().data));
+            frames.pop_front();
+            ++firstSerial;
+        }
+        // 保留一组的缓冲供复用即可
+        while (spareData.size() > static_cast<size_t>(keyframeInterval)) {
+            spareData.pop_back();
+        }
+    }
+}
+
+void RewindBuffer::encodeBlock(const ParticleStore& particles, bool keyframe, size_t block, Block& info) {
+    const size_t first = block * BlockSize;
+    const size_t last = std::min(first + BlockSize, slotCount);
+
+    // 输出经由字节指针写入，可能与任何对象重叠；输入数组的指针先取到局部变量，避免每次写入后重新加载
+    const float* posX = particles.posX.data();
+    const float* posY = particles.posY.data();
+    const float* posZ = particles.posZ.data();
+    const float* life = particles.life.data();
+    const float* colorR = particles.colorR.data();
+    const float* colorG = particles.colorG.data();
+    const float* colorB = particles.colorB.data();
+    const float* sizeIn = particles.size.data();
+    Predictor* predictors = encoder.data();
+
+    float* raw = rawScratch.data() + first * 3;
+    uint16_t* colors = colorScratch.data() + first * 3;
+    uint16_t* sizes = sizeScratch.data() + first;
+    int16_t* large = largeScratch.data() + first * 3;
+    uint8_t* modes = modeScratch.data() + first / 4;
+    int8_t* small = smallScratch.data() + first * 3;
+    int8_t* colorDeltas = colorDeltaScratch.data() + first * 3;
+    const float* rawBegin = raw;
+    const uint16_t* colorBegin = colors;
+    const int16_t* largeBegin = large;
+    const int8_t* smallBegin = small;
+    uint32_t live = 0;
+    std::memset(modes, 0, (last - first + 3) / 4);
+
+    for (size_t i = first; i < last; ++i) {
+        Predictor& p = predictors[i];
+        if (life[i] <= 0.0f) {
+            p.alive = 0;
+            continue;
+        }
+
+        const float x = posX[i];
+        const float y = posY[i];
+        const float z = posZ[i];
+        const uint16_t size = floatToHalf(sizeIn[i]);
+        const uint16_t r = floatToHalf(colorR[i]);
+        const uint16_t g = floatToHalf(colorG[i]);
+        const uint16_t b = floatToHalf(colorB[i]);
+        uint8_t mode = Raw;
+        if (!keyframe && p.alive && p.size == size) {
+            // 先试8位残差，再试16位残差
+            const float px = p.x + p.dx;
+            const float py = p.y + p.dy;
+            const float pz = p.z + p.dz;
+            int rx, ry, rz;
+            if (quantize(x, px, 127.0f, rx) && quantize(y, py, 127.0f, ry) && quantize(z, pz, 127.0f, rz)) {
+                mode = SmallResidual;
+                small[0] = static_cast<int8_t>(rx);
+                small[1] = static_cast<int8_t>(ry);
+                small[2] = static_cast<int8_t>(rz);
+                small += 3;
+            }
+            else if (quantize(x, px, 32767.0f, rx) && quantize(y, py, 32767.0f, ry) && quantize(z, pz, 32767.0f, rz)) {
+                mode = LargeResidual;
+                large[0] = static_cast<int16_t>(rx);
+                large[1] = static_cast<int16_t>(ry);
+                large[2] = static_cast<int16_t>(rz);
+                large += 3;
+            }
+
+            if (mode != Raw) {
+                // 与解码端相同的运算，两边的预测保持一致
+                const float qx = px + static_cast<float>(rx) * PositionStep;
+                const float qy = py + static_cast<float>(ry) * PositionStep;
+                const float qz = pz + static_cast<float>(rz) * PositionStep;
+                p.dx = qx - p.x;
+                p.dy = qy - p.y;
+                p.dz = qz - p.z;
+                p.x = qx;
+                p.y = qy;
+                p.z = qz;
+                encodeChannel(r, p.r, colorDeltas, colors);
+                encodeChannel(g, p.g, colorDeltas, colors);
+                encodeChannel(b, p.b, colorDeltas, colors);
+            }
+        }
+
+        if (mode == Raw) {
+            raw[0] = x;
+            raw[1] = y;
+            raw[2] = z;
+            raw += 3;
+            *sizes++ = size;
+            colors[0] = r;
+            colors[1] = g;
+            colors[2] = b;
+            colors += 3;
+            p.x = x;
+            p.y = y;
+            p.z = z;
+            p.dx = 0.0f;
+            p.dy = 0.0f;
+            p.dz = 0.0f;
+            p.r = r;
+            p.g = g;
+            p.b = b;
+            p.size = size;
+            p.alive = 1;
+        }
+
+        modes[(i - first) >> 2] |= static_cast<uint8_t>(mode << (((i - first) & 3) * 2));
+        ++live;
+    }
+
+    info.live = live;
+    info.raw = static_cast<uint32_t>((raw - rawBegin) / 3);
+    info.colors = static_cast<uint32_t>(colors - colorBegin);
+    info.large = static_cast<uint32_t>((large - largeBegin) / 3);
+    info.small = static_cast<uint32_t>((small - smallBegin) / 3);
+}
+
+void RewindBuffer::decodeBlock(const EncodedFrame& frame, size_t block, ParticleInstance* out) {
+    const Block& info = frame.blocks[block];
+    const size_t first = block * BlockSize;
+    const size_t last = std::min(first + BlockSize, slotCount);
+    const BlockLayout layout(last - first, info.raw, info.colors, info.large, info.small);
+    const unsigned char* data = frame.data.data() + info.offset;
+    const float* raw = reinterpret_cast<const float*>(data + layout.raw);
+    const uint16_t* colors = reinterpret_cast<const uint16_t*>(data + layout.colors);
+    const uint16_t* rawSize = reinterpret_cast<const uint16_t*>(data + layout.sizes);
+    const int16_t* large = reinterpret_cast<const int16_t*>(data + layout.large);
+    const uint8_t* modes = data + layout.modes;
+    const int8_t* small = reinterpret_cast<const int8_t*>(data + layout.small);
+    const int8_t* colorDeltas = reinterpret_cast<const int8_t*>(data + layout.colorDeltas);
+    const float* half = halfTable();
+
+    for (size_t i = first; i < last; ++i) {
+        Predictor& p = decoder[i];
+        const uint8_t mode = (modes[(i - first) >> 2] >> (((i - first) & 3) * 2)) & 3;
+        if (mode == Dead) {
+            p.alive = 0;
+            continue;
+        }
+
+        if (mode == Raw) {
+            p.x = raw[0];
+            p.y = raw[1];
+            p.z = raw[2];
+            raw += 3;
+            p.dx = 0.0f;
+            p.dy = 0.0f;
+            p.dz = 0.0f;
+            p.size = *rawSize++;
+            p.alive = 1;
+            p.r = *colors++;
+            p.g = *colors++;
+            p.b = *colors++;
+        }
+        else {
+            int rx, ry, rz;
+            if (mode == SmallResidual) {
+                rx = small[0];
+                ry = small[1];
+                rz = small[2];
+                small += 3;
+            }
+            else {
+                rx = large[0];
+                ry = large[1];
+                rz = large[2];
+                large += 3;
+            }
+            const float px = p.x + p.dx;
+            const float py = p.y + p.dy;
+            const float pz = p.z + p.dz;
+            const float x = px + static_cast<float>(rx) * PositionStep;
+            const float y = py + static_cast<float>(ry) * PositionStep;
+            const float z = pz + static_cast<float>(rz) * PositionStep;
+            p.dx = x - p.x;
+            p.dy = y - p.y;
+            p.dz = z - p.z;
+            p.x = x;
+            p.y = y;
+            p.z = z;
+            decodeChannel(p.r, colorDeltas, colors);
+            decodeChannel(p.g, colorDeltas, colors);
+            decodeChannel(p.b, colorDeltas, colors);
+        }
+
+        if (out) {
+            out->position = glm::vec3(p.x, p.y, p.z);
+            out->color = glm::vec3(half[p.r], half[p.g], half[p.b]);
+            out->size = half[p.size];
+            ++out;
+        }
+    }
+}
+
+void RewindBuffer::decode(const EncodedFrame& frame, std::vector<ParticleInstance>* out) {
+    // 各块输出的起点为之前各块存活数之和
+    std::vector<size_t> outputOffsets(frame.blocks.size());
+    size_t live = 0;
+    for (size_t block = 0; block < frame.blocks.size(); ++block) {
+        outputOffsets[block] = live;
+        live += frame.blocks[block].live;
+    }
+    if (out) {
+        out->resize(live);
+    }
+
+    threadPool.parallelFor(0, frame.blocks.size(), 1, [&](size_t begin, size_t end, int) {
+        for (size_t block = begin; block < end; ++block) {
+            decodeBlock(frame, block, out ? out->data() + outputOffsets[block] : nullptr);
+        }
+    });
+}
+
+const std::vector<ParticleInstance>& RewindBuffer::reconstruct(size_t index) {
+    const uint64_t target = firstSerial + index;
+    if (decodedSerial == target) {
+        return decoded;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t keyframe = index;
+    while (!frames[keyframe].keyframe) {
+        --keyframe;
+    }
+
+    // 解码端已处在同一组内较早的帧时接着解码
+    size_t from = keyframe;
+    if (decodedSerial != InvalidSerial && decodedSerial >= firstSerial + keyframe && decodedSerial < target) {
+        from = static_cast<size_t>(decodedSerial - firstSerial) + 1;
+    }
+    if (decoder.size() != slotCount) {
+        decoder.assign(slotCount, Predictor());
+    }
+
+    for (size_t i = from; i < index; ++i) {
+        decode(frames[i], nullptr);
+    }
+    decode(frames[index], &decoded);
+    decodedSerial = target;
+    lastDecodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return decoded;
+}
@@ -0,0 +1,177 @@
+#include "scene_benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace {
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+    }
+    return escaped;
+}
+
+// 最近秩百分位数，values会被重排
+float nearestRank(std::vector<float>& values, float percentile) {
+    const double rank = std::ceil(values.size() * percentile / 100.0);
+    const size_t index = static_cast<size_t>(std::max(rank, 1.0)) - 1;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void writeStats(std::ofstream& file, std::vector<float>& values) {
+    if (values.empty()) {
+        file << "null";
+        return;
+    }
+
+    double sum = 0.0;
+    for (float value : values) {
+        sum += value;
+    }
+    const float minValue = *std::min_element(values.begin(), values.end());
+    const float maxValue = *std::max_element(values.begin(), values.end());
+    file << "{\"samples\": " << values.size()
+        << ", \"min\": " << minValue
+        << ", \"mean\": " << sum / values.size()
+        << ", \"p50\": " << nearestRank(values, 50.0f)
+        << ", \"p90\": " << nearestRank(values, 90.0f)
+        << ", \"p95\": " << nearestRank(values, 95.0f)
+        << ", \"p99\": " << nearestRank(values, 99.0f)
+        << ", \"max\": " << maxValue << "}";
+}
+
+void writeCell(std::ofstream& file, float value) {
+    file << ",";
+    if (value >= 0.0f) {
+        file << value;
+    }
+}
+
+} // namespace
+
+void SceneBenchmark::collect(const Profiler& profiler, bool final) {
+    // GPU查询在发出QueryFrames帧之后才取回，之前的帧GPU数据还不完整
+    const uint64_t frameIndex = profiler.getFrameIndex();
+    const uint64_t end = final ? frameIndex
+        : (frameIndex > Profiler::QueryFrames ? frameIndex - Profiler::QueryFrames : 0);
+
+    for (; nextFrame < end; ++nextFrame) {
+        FrameSample sample;
+        sample.cpuFrameMs = profiler.getSample(-1, false, nextFrame);
+        sample.gpuFrameMs = -1.0f;
+        for (int s = 0; s < Profiler::MaxSections; ++s) {
+            const bool known = s < profiler.getSectionCount();
+            sample.cpuMs[s] = known ? profiler.getSample(s, false, nextFrame) : -1.0f;
+            sample.gpuMs[s] = known ? profiler.getSample(s, true, nextFrame) : -1.0f;
+            sample.gpuDropped[s] = known && profiler.isGpuSampleDropped(s, nextFrame);
+            if (sample.gpuMs[s] >= 0.0f) {
+                sample.gpuFrameMs = std::max(sample.gpuFrameMs, 0.0f) + sample.gpuMs[s];
+            }
+        }
+        samples.push_back(sample);
+    }
+}
+
+void SceneBenchmark::gatherColumn(int column, bool gpu, std::vector<float>& values) const {
+    values.clear();
+    for (const FrameSample& sample : samples) {
+        const float value = column < 0 ? (gpu ? sample.gpuFrameMs : sample.cpuFrameMs)
+            : (gpu ? sample.gpuMs[column] : sample.cpuMs[column]);
+        if (value >= 0.0f) {
+            values.push_back(value);
+        }
+    }
+}
+
+size_t SceneBenchmark::countDropped(int column) const {
+    size_t dropped = 0;
+    for (const FrameSample& sample : samples) {
+        for (int s = 0; s < Profiler::MaxSections; ++s) {
+            if ((column < 0 || column == s) && sample.gpuDropped[s]) {
+                ++dropped;
+            }
+        }
+    }
+    return dropped;
+}
+
+float SceneBenchmark::getPercentile(int column, bool gpu, float percentile) const {
+    std::vector<float> values;
+    gatherColumn(column, gpu, values);
+    return values.empty() ? -1.0f : nearestRank(values, percentile);
+}
+
+bool SceneBenchmark::writeCsv(const std::string& path, const Profiler& profiler, const SceneBenchmarkInfo& info) const {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    // 缺失的样本留空
+    const int sections = profiler.getSectionCount();
+    file << "frame,time,frame_cpu_ms,frame_gpu_ms";
+    for (int s = 0; s < sections; ++s) {
+        file << "," << profiler.getSectionName(s) << " cpu_ms," << profiler.getSectionName(s) << " gpu_ms";
+    }
+    file << "\n";
+
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const FrameSample& sample = samples[i];
+        file << i << "," << i * info.deltaTime;
+        writeCell(file, sample.cpuFrameMs);
+        writeCell(file, sample.gpuFrameMs);
+        for (int s = 0; s < sections; ++s) {
+            writeCell(file, sample.cpuMs[s]);
+            writeCell(file, sample.gpuMs[s]);
+        }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool SceneBenchmark::writeJson(const std::string& path, const Profiler& profiler, const SceneBenchmarkInfo& info) const {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    file << "{\n"
+        << "  \"benchmark\": \"scene\",\n"
+        << "  \"effect\": \"" << escapeJson(info.effect) << "\",\n"
+        << "  \"camera_path\": \"" << escapeJson(info.cameraPath) << "\",\n"
+        << "  \"renderer\": \"" << escapeJson(info.renderer) << "\",\n"
+        << "  \"backend\": \"" << info.backend << "\",\n"
+        << "  \"render_mode\": \"" << info.renderMode << "\",\n"
+        << "  \"width\": " << info.width << ",\n"
+        << "  \"height\": " << info.height << ",\n"
+        << "  \"particles\": " << info.particles << ",\n"
+        << "  \"frames\": " << samples.size() << ",\n"
+        << "  \"warmup_frames\": " << info.warmupFrames << ",\n"
+        << "  \"delta_time\": " << info.deltaTime << ",\n"
+        << "  \"seed\": " << info.seed << ",\n"
+        << "  \"gpu_query_frames\": " << Profiler::QueryFrames << ",\n"
+        << "  \"sections\": [";
+
+    // 第一项是整帧：CPU为墙钟时间，GPU为各段GPU时间之和。
+    // gpu_dropped是因查询结果未及时就绪而缺失的GPU样本数，用于解释gpu_ms样本数少于帧数的情况
+    std::vector<float> values;
+    for (int column = -1; column < profiler.getSectionCount(); ++column) {
+        file << (column < 0 ? "\n" : ",\n")
+            << "    {\"name\": \"" << (column < 0 ? "Frame" : escapeJson(profiler.getSectionName(column))) << "\", \"cpu_ms\": ";
+        gatherColumn(column, false, values);
+        writeStats(file, values);
+        file << ", \"gpu_ms\": ";
+        gatherColumn(column, true, values);
+        writeStats(file, values);
+        file << ", \"gpu_dropped\": " << countDropped(column) << "}";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
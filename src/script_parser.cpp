@@ -1,34 +1,382 @@
 #include "script_parser.h"
-#include "particle_effect.h" 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <fstream>
-#include <sstream>
 #include <filesystem>
 #include <iostream>
+#include <set>
 
-void ScriptParser::loadScripts(const std::string& directory) {
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // 缓存格式变化时增大CacheVersion使旧文件失效
+    const uint32_t CacheMagic = 0x58464842; // "BHFX"
+    const uint32_t CacheVersion = 1;
+    const char* const CacheFileName = ".effect_cache";
+
+    std::string cachePath(const std::string& directory) {
+        return (std::filesystem::path(directory) / CacheFileName).string();
+    }
+
+    bool isEffectFile(const std::filesystem::path& path) {
+        return path.extension() == ".effect";
+    }
+
+    std::string trim(const std::string& text) {
+        const size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            return std::string();
+        }
+        return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+    }
+
+    template <typename T>
+    void put(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(std::string& out, const std::string& text) {
+        put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    // 带边界检查的顺序读取，文件被截断或损坏时返回false
+    struct CacheReader {
+        const char* cursor;
+        const char* end;
+
+        template <typename T>
+        bool get(T& value) {
+            if (static_cast<size_t>(end - cursor) < sizeof(T)) {
+                return false;
+            }
+            std::copy(cursor, cursor + sizeof(T), reinterpret_cast<char*>(&value));
+            cursor += sizeof(T);
+            return true;
+        }
+
+        bool getString(std::string& text) {
+            uint32_t length = 0;
+            if (!get(length) || static_cast<size_t>(end - cursor) < length) {
+                return false;
+            }
+            text.assign(cursor, length);
+            cursor += length;
+            return true;
+        }
+    };
+
+    bool lessByName(const ParticleEffect& a, const ParticleEffect& b) {
+        return a.name < b.name;
+    }
+}
+
+bool EffectUpdateQueue::push(EffectUpdate& update) {
+    const size_t position = tail.load(std::memory_order_relaxed);
+    if (position - head.load(std::memory_order_acquire) == Capacity) {
+        return false;
+    }
+    slots[position % Capacity] = std::move(update);
+    tail.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool EffectUpdateQueue::pop(EffectUpdate& update) {
+    const size_t position = head.load(std::memory_order_relaxed);
+    if (position == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    update = std::move(slots[position % Capacity]);
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+ScriptParser::~ScriptParser() {
+    stopWatching();
+}
+
+void ScriptParser::loadScripts(const std::string& scriptDirectory) {
     namespace fs = std::filesystem;
+    auto start = std::chrono::steady_clock::now();
+
+    stopWatching();
+    EffectUpdate stale;
+    while (updates.pop(stale)) {
+    }
+    directory = scriptDirectory;
 
     if (!fs::exists(directory)) {
         fs::create_directories(directory);
         createDefaultScripts(directory);
-        return;
     }
 
+    Catalog cached;
+    readCache(cachePath(directory), cached);
+
+    catalog.clear();
+    cachedCount = 0;
+    parsedCount = 0;
     for (const auto& entry : fs::directory_iterator(directory)) {
-        if (entry.path().extension() == ".effect") {
-            parseEffectScript(entry.path().string());
+        if (!isEffectFile(entry.path())) {
+            continue;
+        }
+
+        std::error_code error;
+        const std::string filename = entry.path().filename().string();
+        ScriptEntry script;
+        script.modified = static_cast<int64_t>(entry.last_write_time(error).time_since_epoch().count());
+        script.size = static_cast<uint64_t>(entry.file_size(error));
+        script.valid = false;
+
+        auto it = cached.find(filename);
+        if (it != cached.end() && it->second.modified == script.modified && it->second.size == script.size) {
+            script.effect = std::move(it->second.effect);
+            script.valid = true;
+            ++cachedCount;
+        }
+        else {
+            script.valid = parseEffectScript(entry.path().string(), script.effect);
+            ++parsedCount;
+            if (script.valid) {
+                std::cout << "Loaded effect: " << script.effect.name << " - " << script.effect.description << std::endl;
+            }
+        }
+        catalog[filename] = std::move(script);
+    }
+
+    if (parsedCount > 0 || cached.size() != cachedCount) {
+        writeCache(cachePath(directory), catalog);
+    }
+
+    effects.clear();
+    effects.reserve(catalog.size());
+    for (const auto& item : catalog) {
+        if (item.second.valid) {
+            effects.push_back(item.second.effect);
         }
     }
+    std::sort(effects.begin(), effects.end(), lessByName);
+
+    loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded " << effects.size() << " effects (" << cachedCount << " cached, "
+        << parsedCount << " parsed) in " << loadMs << " ms" << std::endl;
 }
 
-void ScriptParser::parseEffectScript(const std::string& filename) {
+void ScriptParser::startWatching() {
+    if (watcher.joinable() || directory.empty()) {
+        return;
+    }
+    stopRequested = false;
+    watcher = std::thread(&ScriptParser::watchLoop, this);
+}
+
+void ScriptParser::stopWatching() {
+    if (!watcher.joinable()) {
+        return;
+    }
+    stopRequested = true;
+    watcher.join();
+}
+
+void ScriptParser::pollUpdates(std::vector<std::string>& changed) {
+    changed.clear();
+
+    EffectUpdate update;
+    while (updates.pop(update)) {
+        const std::string name = update.effect.name;
+        auto it = std::lower_bound(effects.begin(), effects.end(), update.effect, lessByName);
+        const bool exists = it != effects.end() && it->name == name;
+
+        if (update.removed) {
+            if (!exists) {
+                continue;
+            }
+            effects.erase(it);
+            std::cout << "Removed effect: " << name << std::endl;
+        }
+        else {
+            if (exists) {
+                *it = std::move(update.effect);
+            }
+            else {
+                effects.insert(it, std::move(update.effect));
+            }
+            std::cout << "Reloaded effect: " << name << std::endl;
+        }
+        changed.push_back(name);
+        ++reloadCount;
+    }
+}
+
+const ParticleEffect* ScriptParser::findEffect(const std::string& name) const {
+    ParticleEffect key;
+    key.name = name;
+    auto it = std::lower_bound(effects.begin(), effects.end(), key, lessByName);
+    return it != effects.end() && it->name == name ? &*it : nullptr;
+}
+
+void ScriptParser::watchLoop() {
+    std::set<std::string> pending;
+
+#ifdef __linux__
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+    if (fd >= 0 && inotify_add_watch(fd, directory.c_str(), mask) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        std::cerr << "inotify unavailable, polling " << directory << " for effect changes" << std::endl;
+    }
+#endif
+
+    while (!stopRequested) {
+#ifdef __linux__
+        if (fd >= 0) {
+            // 收到事件后继续等待一小段安静期，合并编辑器保存时产生的多个事件
+            pollfd descriptor = { fd, POLLIN, 0 };
+            if (poll(&descriptor, 1, pending.empty() ? 200 : 50) > 0) {
+                alignas(inotify_event) char buffer[4096];
+                ssize_t length;
+                while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+                    for (const char* p = buffer; p < buffer + length; ) {
+                        const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                        if (event->len > 0 && isEffectFile(event->name)) {
+                            pending.insert(event->name);
+                        }
+                        p += sizeof(inotify_event) + event->len;
+                    }
+                }
+                continue;
+            }
+        }
+        else
+#endif
+        {
+            for (int i = 0; i < 5 && !stopRequested; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            findChangedFiles(pending);
+        }
+
+        bool changed = false;
+        for (const std::string& filename : pending) {
+            changed = rescanFile(filename) || changed;
+        }
+        pending.clear();
+        if (changed) {
+            writeCache(cachePath(directory), catalog);
+        }
+    }
+
+#ifdef __linux__
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+void ScriptParser::findChangedFiles(std::set<std::string>& pending) const {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    std::set<std::string> seen;
+
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        if (!isEffectFile(entry.path())) {
+            continue;
+        }
+        const std::string filename = entry.path().filename().string();
+        seen.insert(filename);
+
+        auto it = catalog.find(filename);
+        const int64_t modified = static_cast<int64_t>(entry.last_write_time(error).time_since_epoch().count());
+        const uint64_t size = static_cast<uint64_t>(entry.file_size(error));
+        if (it == catalog.end() || it->second.modified != modified || it->second.size != size) {
+            pending.insert(filename);
+        }
+    }
+    for (const auto& item : catalog) {
+        if (seen.count(item.first) == 0) {
+            pending.insert(item.first);
+        }
+    }
+}
+
+bool ScriptParser::rescanFile(const std::string& filename) {
+    namespace fs = std::filesystem;
+    const fs::path path = fs::path(directory) / filename;
+    std::error_code error;
+    auto it = catalog.find(filename);
+
+    if (!fs::exists(path, error)) {
+        if (it == catalog.end()) {
+            return false;
+        }
+        // 最后一次修改无效时渲染线程仍持有上一个有效版本，同样需要移除
+        EffectUpdate update;
+        update.effect.name = std::filesystem::path(filename).stem().string();
+        update.removed = true;
+        catalog.erase(it);
+        publish(update);
+        return true;
+    }
+
+    ScriptEntry script;
+    script.modified = static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+    script.size = static_cast<uint64_t>(fs::file_size(path, error));
+    if (error) {
+        return false;
+    }
+    if (it != catalog.end() && it->second.modified == script.modified && it->second.size == script.size) {
+        return false;
+    }
+
+    script.valid = parseEffectScript(path.string(), script.effect);
+    if (!script.valid) {
+        // 渲染线程继续使用上一个有效版本；记下新的时间戳，文件再次修改前不再重复解析
+        std::cerr << "Keeping previous version of effect script: " << filename << std::endl;
+        if (it != catalog.end()) {
+            it->second.modified = script.modified;
+            it->second.size = script.size;
+            it->second.valid = false;
+        }
+        else {
+            catalog[filename] = std::move(script);
+        }
+        return true;
+    }
+
+    EffectUpdate update;
+    update.effect = script.effect;
+    catalog[filename] = std::move(script);
+    publish(update);
+    return true;
+}
+
+void ScriptParser::publish(EffectUpdate& update) {
+    // 渲染线程每帧清空队列，队列满只会在短时间内大量修改时出现
+    while (!updates.push(update)) {
+        if (stopRequested) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool ScriptParser::parseEffectScript(const std::string& filename, ParticleEffect& effect) {
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "Failed to open effect script: " << filename << std::endl;
-        return;
+        return false;
     }
 
-    ParticleEffect effect;
+    effect = ParticleEffect();
     effect.name = std::filesystem::path(filename).stem().string();
 
     effect.blackHoleMass = 5000.0f;
@@ -43,53 +391,170 @@ void ScriptParser::parseEffectScript(const std::string& filename) {
     effect.enableExplosion = false;
     effect.explosionStrength = 10.0f;
 
+    bool parsed = true;
     std::string line;
     while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
         if (line.empty() || line[0] == '#') continue;
 
-        std::istringstream iss(line);
-        std::string key;
-        if (std::getline(iss, key, '=')) {
-            std::string value;
-            if (std::getline(iss, value)) {
-                key.erase(0, key.find_first_not_of(" \t"));
-                key.erase(key.find_last_not_of(" \t") + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
-
-                parseParameter(key, value, effect);
+        const size_t equals = line.find('=');
+        if (equals != std::string::npos) {
+            const std::string value = trim(line.substr(equals + 1));
+            if (!value.empty()) {
+                parsed = parseParameter(trim(line.substr(0, equals)), value, effect) && parsed;
             }
         }
         else if (line.find("description:") != std::string::npos) {
-            effect.description = line.substr(12);
-            effect.description.erase(0, effect.description.find_first_not_of(" \t"));
-            effect.description.erase(effect.description.find_last_not_of(" \t") + 1);
+            effect.description = trim(line.substr(line.find("description:") + 12));
         }
     }
 
-    effects.push_back(effect);
-    std::cout << "Loaded effect: " << effect.name << " - " << effect.description << std::endl;
+    std::string error;
+    if (!parsed) {
+        return false;
+    }
+    if (!validateEffect(effect, error)) {
+        std::cerr << "Invalid effect script " << filename << ": " << error << std::endl;
+        return false;
+    }
+    return true;
 }
 
-void ScriptParser::parseParameter(const std::string& key, const std::string& value, ParticleEffect& effect) {
-    try {
-        if (key == "blackHoleMass") effect.blackHoleMass = std::stof(value);
-        else if (key == "particleLifetime") effect.particleLifetime = std::stof(value);
-        else if (key == "spiralStrength") effect.spiralStrength = std::stof(value);
-        else if (key == "turbulenceStrength") effect.turbulenceStrength = std::stof(value);
-        else if (key == "accretionDiskRadius") effect.accretionDiskRadius = std::stof(value);
-        else if (key == "particleSize") effect.particleSize = std::stof(value);
-        else if (key == "colorIntensity") effect.colorIntensity = std::stof(value);
-        else if (key == "enableJet") effect.enableJet = (std::stof(value) > 0.5f);
-        else if (key == "jetStrength") effect.jetStrength = std::stof(value);
-        else if (key == "enableExplosion") effect.enableExplosion = (std::stof(value) > 0.5f);
-        else if (key == "explosionStrength") effect.explosionStrength = std::stof(value);
-        else {
-            std::cerr << "Unknown parameter in effect script: " << key << std::endl;
+bool ScriptParser::parseParameter(const std::string& key, const std::string& value, ParticleEffect& effect) {
+    char* end = nullptr;
+    const float number = std::strtof(value.c_str(), &end);
+    if (end == value.c_str() || *end != '\0') {
+        std::cerr << "Error parsing parameter " << key << " with value " << value << std::endl;
+        return false;
+    }
+
+    if (key == "blackHoleMass") effect.blackHoleMass = number;
+    else if (key == "particleLifetime") effect.particleLifetime = number;
+    else if (key == "spiralStrength") effect.spiralStrength = number;
+    else if (key == "turbulenceStrength") effect.turbulenceStrength = number;
+    else if (key == "accretionDiskRadius") effect.accretionDiskRadius = number;
+    else if (key == "particleSize") effect.particleSize = number;
+    else if (key == "colorIntensity") effect.colorIntensity = number;
+    else if (key == "enableJet") effect.enableJet = (number > 0.5f);
+    else if (key == "jetStrength") effect.jetStrength = number;
+    else if (key == "enableExplosion") effect.enableExplosion = (number > 0.5f);
+    else if (key == "explosionStrength") effect.explosionStrength = number;
+    else {
+        std::cerr << "Unknown parameter in effect script: " << key << std::endl;
+    }
+    return true;
+}
+
+bool ScriptParser::validateEffect(const ParticleEffect& effect, std::string& error) {
+    const float values[] = {
+        effect.blackHoleMass, effect.particleLifetime, effect.spiralStrength, effect.turbulenceStrength,
+        effect.accretionDiskRadius, effect.particleSize, effect.colorIntensity, effect.jetStrength,
+        effect.explosionStrength
+    };
+    for (float value : values) {
+        if (!std::isfinite(value) || value < 0.0f) {
+            error = "parameters must be finite and non-negative";
+            return false;
+        }
+    }
+    if (effect.blackHoleMass <= 0.0f || effect.particleLifetime <= 0.0f
+        || effect.accretionDiskRadius <= 0.0f || effect.particleSize <= 0.0f) {
+        error = "blackHoleMass, particleLifetime, accretionDiskRadius and particleSize must be positive";
+        return false;
+    }
+    return true;
+}
+
+bool ScriptParser::readCache(const std::string& path, Catalog& catalog) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::string data(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    if (!file.read(&data[0], data.size())) {
+        return false;
+    }
+
+    CacheReader reader = { data.data(), data.data() + data.size() };
+    uint32_t magic = 0, version = 0, count = 0;
+    if (!reader.get(magic) || !reader.get(version) || !reader.get(count)
+        || magic != CacheMagic || version != CacheVersion) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string filename;
+        ScriptEntry script;
+        ParticleEffect& effect = script.effect;
+        uint8_t enableJet = 0, enableExplosion = 0;
+        if (!reader.getString(filename) || !reader.get(script.modified) || !reader.get(script.size)
+            || !reader.getString(effect.name) || !reader.getString(effect.description)
+            || !reader.get(effect.blackHoleMass) || !reader.get(effect.particleLifetime)
+            || !reader.get(effect.spiralStrength) || !reader.get(effect.turbulenceStrength)
+            || !reader.get(effect.accretionDiskRadius) || !reader.get(effect.particleSize)
+            || !reader.get(effect.colorIntensity) || !reader.get(effect.jetStrength)
+            || !reader.get(effect.explosionStrength) || !reader.get(enableJet) || !reader.get(enableExplosion)) {
+            catalog.clear();
+            return false;
+        }
+        effect.enableJet = enableJet != 0;
+        effect.enableExplosion = enableExplosion != 0;
+        script.valid = true;
+        catalog[filename] = std::move(script);
+    }
+    return true;
+}
+
+void ScriptParser::writeCache(const std::string& path, const Catalog& catalog) {
+    std::string data;
+    put<uint32_t>(data, CacheMagic);
+    put<uint32_t>(data, CacheVersion);
+    size_t countOffset = data.size();
+    put<uint32_t>(data, 0);
+
+    uint32_t count = 0;
+    for (const auto& item : catalog) {
+        // 无效的脚本不进缓存，下次启动时重新解析并报告错误
+        if (!item.second.valid) {
+            continue;
+        }
+        const ParticleEffect& effect = item.second.effect;
+        putString(data, item.first);
+        put<int64_t>(data, item.second.modified);
+        put<uint64_t>(data, item.second.size);
+        putString(data, effect.name);
+        putString(data, effect.description);
+        put<float>(data, effect.blackHoleMass);
+        put<float>(data, effect.particleLifetime);
+        put<float>(data, effect.spiralStrength);
+        put<float>(data, effect.turbulenceStrength);
+        put<float>(data, effect.accretionDiskRadius);
+        put<float>(data, effect.particleSize);
+        put<float>(data, effect.colorIntensity);
+        put<float>(data, effect.jetStrength);
+        put<float>(data, effect.explosionStrength);
+        put<uint8_t>(data, effect.enableJet ? 1 : 0);
+        put<uint8_t>(data, effect.enableExplosion ? 1 : 0);
+        ++count;
+    }
+    std::copy(reinterpret_cast<const char*>(&count), reinterpret_cast<const char*>(&count) + sizeof(count),
+        data.begin() + countOffset);
+
+    // 先写临时文件再改名，另一个实例不会读到写了一半的缓存
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(data.data(), data.size())) {
+            return;
         }
     }
-    catch (const std::exception& e) {
-        std::cerr << "Error parsing parameter " << key << " with value " << value << ": " << e.what() << std::endl;
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
     }
 }
 
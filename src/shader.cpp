@@ -1,85 +1,366 @@
 #include "shader.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+    std::string binaryCacheDirectory;
+    bool parallelCompile = false;
+
+    // 缓存文件头，格式变化时增大BinaryCacheVersion使旧文件失效
+    const uint32_t BinaryCacheMagic = 0x48534842; // "BHSH"
+    const uint32_t BinaryCacheVersion = 1;
+
+    struct BinaryCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    // FNV-1a 64位
+    uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    uint64_t hashString(uint64_t hash, const char* text) {
+        // 连同结尾的'\0'一起哈希，避免相邻字符串拼接后产生相同的键
+        return hashBytes(hash, text ? text : "", (text ? std::char_traits<char>::length(text) : 0) + 1);
+    }
+
+    bool hasProgramBinary() {
+        if (binaryCacheDirectory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+            return false;
+        }
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+
+    const char* stageName(GLenum type) {
+        switch (type) {
+        case GL_VERTEX_SHADER: return "VERTEX";
+        case GL_FRAGMENT_SHADER: return "FRAGMENT";
+        case GL_COMPUTE_SHADER: return "COMPUTE";
+        default: return "UNKNOWN";
+        }
+    }
+}
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    
-    try {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        
-        vShaderFile.close();
-        fShaderFile.close();
-        
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch (std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-    }
-    
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-    
-    unsigned int vertex, fragment;
-    
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
-    
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
-    
+    const Stage stages[] = { { GL_VERTEX_SHADER, vertexPath }, { GL_FRAGMENT_SHADER, fragmentPath } };
+    build(stages, 2, nullptr, 0);
+}
+
+Shader::Shader(const char* vertexPath, const char* const* feedbackVaryings, int varyingCount) {
+    const Stage stages[] = { { GL_VERTEX_SHADER, vertexPath } };
+    build(stages, 1, feedbackVaryings, varyingCount);
+}
+
+Shader::Shader(const char* computePath) {
+    const Stage stages[] = { { GL_COMPUTE_SHADER, computePath } };
+    build(stages, 1, nullptr, 0);
+}
+
+void Shader::initialize(const std::string& cacheDirectory) {
+    binaryCacheDirectory = cacheDirectory;
+    if (!binaryCacheDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(binaryCacheDirectory, error);
+        if (error) {
+            std::cout << "Shader binary cache disabled: " << error.message() << std::endl;
+            binaryCacheDirectory.clear();
+        }
+    }
+
+    // 0xFFFFFFFF表示由驱动决定线程数
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        parallelCompile = true;
+    }
+    else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        parallelCompile = true;
+    }
+}
+
+void Shader::build(const Stage* stages, int stageCount, const char* const* feedbackVaryings, int varyingCount) {
+    std::string sources[2];
+    for (int i = 0; i < stageCount; ++i) {
+        sources[i] = readFile(stages[i].path);
+    }
+
+    // 键包含驱动信息：换显卡或升级驱动后旧的二进制不会被误用
+    uint64_t key = 0xCBF29CE484222325ull;
+    key = hashString(key, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    key = hashString(key, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    key = hashString(key, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    for (int i = 0; i < stageCount; ++i) {
+        key = hashBytes(key, &stages[i].type, sizeof(GLenum));
+        key = hashString(key, sources[i].c_str());
+    }
+    for (int i = 0; i < varyingCount; ++i) {
+        key = hashString(key, feedbackVaryings[i]);
+    }
+    cacheKey = key;
+    fromBinaryCache = false;
+    linkPending = false;
+    pendingCount = 0;
+
     ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
+    if (loadBinary()) {
+        fromBinaryCache = true;
+        reflectUniforms();
+        return;
+    }
+
+    for (int i = 0; i < stageCount; ++i) {
+        const char* code = sources[i].c_str();
+        GLuint shader = glCreateShader(stages[i].type);
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        glAttachShader(ID, shader);
+        pendingShaders[pendingCount] = shader;
+        pendingTypes[pendingCount] = stages[i].type;
+        ++pendingCount;
+    }
+
+    if (varyingCount > 0) {
+        // 输出变量必须在链接前声明
+        glTransformFeedbackVaryings(ID, varyingCount, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
+    }
+    if (hasProgramBinary()) {
+        glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // 不查询编译与链接状态，支持并行编译的驱动此时在后台线程上工作
     glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
-    
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    linkPending = true;
+}
+
+bool Shader::isReady() const {
+    if (!linkPending || !parallelCompile) {
+        return true;
+    }
+    GLint done = GL_FALSE;
+    glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+void Shader::finishLink() {
+    if (!linkPending) {
+        return;
+    }
+    linkPending = false;
+
+    for (int i = 0; i < pendingCount; ++i) {
+        checkCompileErrors(pendingShaders[i], stageName(pendingTypes[i]));
+    }
+    bool linked = checkCompileErrors(ID, "PROGRAM");
+
+    for (int i = 0; i < pendingCount; ++i) {
+        glDetachShader(ID, pendingShaders[i]);
+        glDeleteShader(pendingShaders[i]);
+    }
+    pendingCount = 0;
+
+    if (linked) {
+        saveBinary();
+    }
+    reflectUniforms();
+}
+
+bool Shader::loadBinary() {
+    if (!hasProgramBinary()) {
+        return false;
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(cacheKey));
+    std::ifstream file(std::filesystem::path(binaryCacheDirectory) / name, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    BinaryCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != BinaryCacheMagic
+        || header.version != BinaryCacheVersion || header.key != cacheKey || header.length == 0) {
+        return false;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) {
+        return false;
+    }
+
+    // 驱动可以拒绝自己早先生成的二进制，此时退回源码编译
+    glProgramBinary(ID, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success = GL_FALSE;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    return success == GL_TRUE;
+}
+
+void Shader::saveBinary() const {
+    if (!hasProgramBinary()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    BinaryCacheHeader header = { BinaryCacheMagic, BinaryCacheVersion, cacheKey, 0, 0 };
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    header.format = format;
+    header.length = static_cast<uint32_t>(written);
+
+    // 先写临时文件再改名，同时启动的多个实例不会读到写了一半的缓存
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(cacheKey));
+    std::filesystem::path path = std::filesystem::path(binaryCacheDirectory) / name;
+    std::filesystem::path temporary = path;
+    temporary += ".tmp" + std::to_string(std::random_device()());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(binary.data(), written)) {
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+std::string Shader::readFile(const char* path) {
+    // 按文件大小一次读入，不经过stringstream
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        return std::string();
+    }
+
+    std::string code(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&code[0], code.size());
+    return code;
 }
 
 void Shader::use() {
+    finishLink();
     glUseProgram(ID);
 }
 
 void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(findUniform(name), (int)value);
 }
 
 void Shader::setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(findUniform(name), value);
+}
+
+void Shader::setUInt(const std::string &name, unsigned int value) const {
+    glUniform1ui(findUniform(name), value);
 }
 
 void Shader::setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(findUniform(name), value);
 }
 
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(findUniform(name), 1, &value[0]);
 }
 
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(findUniform(name), 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::set(Uniform<bool> uniform, bool value) const {
+    glUniform1i(uniform.location, (int)value);
+}
+
+void Shader::set(Uniform<int> uniform, int value) const {
+    glUniform1i(uniform.location, value);
+}
+
+void Shader::set(Uniform<unsigned int> uniform, unsigned int value) const {
+    glUniform1ui(uniform.location, value);
+}
+
+void Shader::set(Uniform<float> uniform, float value) const {
+    glUniform1f(uniform.location, value);
+}
+
+void Shader::set(Uniform<glm::vec3> uniform, const glm::vec3& value) const {
+    glUniform3fv(uniform.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::mat4> uniform, const glm::mat4& value) const {
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &value[0][0]);
+}
+
+void Shader::bindUniformBlock(const char* blockName, GLuint binding) {
+    finishLink();
+    GLuint index = glGetUniformBlockIndex(ID, blockName);
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(ID, index, binding);
+    }
+}
+
+void Shader::reflectUniforms() {
+    uniformLocations.clear();
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(std::max(maxLength, 1));
+
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+
+        GLint location = glGetUniformLocation(ID, name.data());
+        if (location < 0) {
+            continue;
+        }
+
+        // 数组报告为"name[0]"，同时按不带下标的名字登记
+        std::string key(name.data(), length);
+        uniformLocations[key] = location;
+        if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0) {
+            uniformLocations[key.substr(0, key.size() - 3)] = location;
+        }
+    }
+}
+
+GLint Shader::findUniform(const std::string& name) const {
+    auto it = uniformLocations.find(name);
+    return it != uniformLocations.end() ? it->second : -1;
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
+bool Shader::checkCompileErrors(unsigned int shader, std::string type) {
     int success;
     char infoLog[1024];
     if (type != "PROGRAM") {
@@ -95,4 +376,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type) {
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success != 0;
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "spatial_hash_grid.h"
+#include "particle_simulation.h"
+#include <cmath>
+
+int32_t SpatialHashGrid::cellCoord(float v) const {
+    return static_cast<int32_t>(std::floor(v * inverseCellSize));
+}
+
+void SpatialHashGrid::build(const ParticleStore& particles, float size, ThreadPool& pool) {
+    cellSize = size;
+    inverseCellSize = 1.0f / size;
+
+    unsortedIndex.clear();
+    const size_t count = particles.count();
+    for (size_t i = 0; i < count; ++i) {
+        if (particles.type[i] == 0 && particles.life[i] > 0.0f) {
+            unsortedIndex.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    const size_t n = unsortedIndex.size();
+
+    // 桶数取不小于2N的2的幂，平均每桶不到一个粒子
+    uint32_t bucketCount = 1;
+    while (bucketCount < 2 * n) {
+        bucketCount <<= 1;
+    }
+    bucketMask = bucketCount - 1;
+
+    unsortedBucket.resize(n);
+    unsortedCell.resize(n);
+    pool.parallelFor(0, n, 4096, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = unsortedIndex[k];
+            const int32_t ix = cellCoord(particles.posX[i]);
+            const int32_t iy = cellCoord(particles.posY[i]);
+            const int32_t iz = cellCoord(particles.posZ[i]);
+            unsortedBucket[k] = bucketOf(ix, iy, iz);
+            unsortedCell[k] = packCell(ix, iy, iz);
+        }
+    });
+
+    // 计数排序：统计 -> 前缀和 -> 散射，O(N + 桶数)，桶内保持粒子下标顺序
+    bucketStart.assign(bucketCount + 1, 0);
+    for (size_t k = 0; k < n; ++k) {
+        ++bucketStart[unsortedBucket[k] + 1];
+    }
+    for (uint32_t b = 0; b < bucketCount; ++b) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+
+    particleIndex.resize(n);
+    cellKeys.resize(n);
+    std::vector<uint32_t>& cursor = unsortedBucket; // 散射时复用为写入位置
+    for (size_t k = 0; k < n; ++k) {
+        const uint32_t slot = bucketStart[cursor[k]]++;
+        particleIndex[slot] = unsortedIndex[k];
+        cellKeys[slot] = unsortedCell[k];
+    }
+    // 散射把每个桶的起点推进到了下一个桶的起点，整体右移一位还原
+    for (uint32_t b = bucketCount; b > 0; --b) {
+        bucketStart[b] = bucketStart[b - 1];
+    }
+    bucketStart[0] = 0;
+
+    posX.resize(n); posY.resize(n); posZ.resize(n);
+    velX.resize(n); velY.resize(n); velZ.resize(n);
+    pool.parallelFor(0, n, 4096, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = particleIndex[k];
+            posX[k] = particles.posX[i];
+            posY[k] = particles.posY[i];
+            posZ[k] = particles.posZ[i];
+            velX[k] = particles.velX[i];
+            velY[k] = particles.velY[i];
+            velZ[k] = particles.velZ[i];
+        }
+    });
+}
@@ -0,0 +1,88 @@
+#include "sph_solver.h"
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846f
+#endif
+
+void SphSolver::addAccelerations(const SpatialHashGrid& grid, const SphSettings& settings, ThreadPool& pool,
+    std::vector<float>& accelX, std::vector<float>& accelY, std::vector<float>& accelZ,
+    const uint8_t* skipTargets) {
+    const size_t n = grid.getCount();
+    density.resize(n);
+    pressure.resize(n);
+    neighborCounts.resize(n);
+    if (n == 0) {
+        averageNeighbors = 0.0;
+        return;
+    }
+
+    const float h = settings.smoothingLength;
+    const float hSq = h * h;
+    const float mass = settings.particleMass;
+    const float poly6 = 315.0f / (64.0f * static_cast<float>(M_PI) * std::pow(h, 9.0f));
+    const float spikyGrad = -45.0f / (static_cast<float>(M_PI) * std::pow(h, 6.0f));
+    const float viscLaplacian = 45.0f / (static_cast<float>(M_PI) * std::pow(h, 6.0f));
+
+    // 第一趟：密度与压强（包含自身贡献）
+    pool.parallelFor(0, n, 1024, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            float rho = 0.0f;
+            unsigned neighbors = 0;
+            grid.forEachNeighbor(grid.posX[k], grid.posY[k], grid.posZ[k], h,
+                [&](size_t, float, float, float, float distSq) {
+                    const float w = hSq - distSq;
+                    rho += mass * poly6 * w * w * w;
+                    ++neighbors;
+                });
+            density[k] = rho;
+            pressure[k] = std::max(settings.stiffness * (rho - settings.restDensity), 0.0f);
+            neighborCounts[k] = neighbors;
+        }
+    });
+
+    // 第二趟：对称化的压强梯度与黏性项
+    pool.parallelFor(0, n, 1024, [&](size_t begin, size_t end, int) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t i = grid.getParticleIndex(k);
+            if (skipTargets && skipTargets[i]) {
+                continue;
+            }
+            const float rhoK = density[k];
+            const float pK = pressure[k];
+            float ax = 0.0f, ay = 0.0f, az = 0.0f;
+
+            grid.forEachNeighbor(grid.posX[k], grid.posY[k], grid.posZ[k], h,
+                [&](size_t j, float rx, float ry, float rz, float distSq) {
+                    if (j == k || distSq <= 0.0f) {
+                        return;
+                    }
+                    const float r = std::sqrt(distSq);
+                    const float rhoJ = density[j];
+
+                    // rx/ry/rz指向邻居，压强把粒子推离邻居
+                    const float pressureTerm = -mass * (pK + pressure[j]) / (2.0f * rhoJ)
+                        * spikyGrad * (h - r) * (h - r) / r;
+                    ax -= pressureTerm * rx;
+                    ay -= pressureTerm * ry;
+                    az -= pressureTerm * rz;
+
+                    const float viscTerm = settings.viscosity * mass / rhoJ * viscLaplacian * (h - r);
+                    ax += viscTerm * (grid.velX[j] - grid.velX[k]);
+                    ay += viscTerm * (grid.velY[j] - grid.velY[k]);
+                    az += viscTerm * (grid.velZ[j] - grid.velZ[k]);
+                });
+
+            accelX[i] += ax / rhoK;
+            accelY[i] += ay / rhoK;
+            accelZ[i] += az / rhoK;
+        }
+    });
+
+    unsigned long long total = 0;
+    for (unsigned count : neighborCounts) {
+        total += count;
+    }
+    averageNeighbors = static_cast<double>(total) / n;
+}
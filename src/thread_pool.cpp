@@ -0,0 +1,120 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount)
+    : stopping(false), generation(0), activeWorkers(0),
+      job(nullptr), jobBegin(0), jobEnd(0), jobChunkSize(1), nextChunk(0) {
+    startWorkers(std::max(threadCount, 1) - 1);
+}
+
+ThreadPool::~ThreadPool() {
+    stopWorkers();
+}
+
+void ThreadPool::setThreadCount(int threadCount) {
+    threadCount = std::max(threadCount, 1);
+    if (threadCount == getThreadCount()) {
+        return;
+    }
+
+    stopWorkers();
+    startWorkers(threadCount - 1);
+}
+
+int ThreadPool::getHardwareThreadCount() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? static_cast<int>(count) : 1;
+}
+
+void ThreadPool::startWorkers(int workerCount) {
+    stopping = false;
+    workers.reserve(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        // 0号留给调用线程
+        workers.emplace_back(&ThreadPool::workerLoop, this, i + 1, generation);
+    }
+}
+
+void ThreadPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t chunkSize, const ChunkFunction& body) {
+    if (begin >= end) {
+        return;
+    }
+
+    chunkSize = std::max<size_t>(chunkSize, 1);
+
+    // 单线程或只有一个块时直接在调用线程执行，省去唤醒开销
+    if (workers.empty() || end - begin <= chunkSize) {
+        for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize) {
+            body(chunkBegin, std::min(chunkBegin + chunkSize, end), 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        jobBegin = begin;
+        jobEnd = end;
+        jobChunkSize = chunkSize;
+        nextChunk.store(0, std::memory_order_relaxed);
+        activeWorkers = static_cast<int>(workers.size());
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::runChunks(int workerIndex) {
+    const size_t chunkCount = (jobEnd - jobBegin + jobChunkSize - 1) / jobChunkSize;
+
+    for (;;) {
+        size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= chunkCount) {
+            break;
+        }
+
+        size_t chunkBegin = jobBegin + chunk * jobChunkSize;
+        size_t chunkEnd = std::min(chunkBegin + jobChunkSize, jobEnd);
+        (*job)(chunkBegin, chunkEnd, workerIndex);
+    }
+}
+
+void ThreadPool::workerLoop(int workerIndex, unsigned long long seenGeneration) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runChunks(workerIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--activeWorkers == 0) {
+                doneCondition.notify_one();
+            }
+        }
+    }
+}